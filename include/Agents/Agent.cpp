@@ -27,6 +27,7 @@ SOFTWARE.
 *******************************************************************************/
 
 #include "Agent.h"
+#include "Utilities/PhaseTimer.h"
 
 Agent::Agent(size_t n, size_t nPop, size_t nInput, size_t nHidden, size_t
 	     nOutput, Fitness f) : nSteps(n), popSize(nPop), numIn(nInput),
@@ -63,8 +64,12 @@ State Agent::getNextState(size_t i, vector<State> jointState) const {
     justPos.push_back(s.pos());
   }
 
+  easytime::ScopedTimer sense(easytime::SENSE);
   VectorXd inp = ComputeNNInput(justPos);
+  sense.Stop();
+  easytime::ScopedTimer policy(easytime::POLICY);
   VectorXd out = AgentNE->GetNNIndex(i)->EvaluateNN(inp).normalized();
+  policy.Stop();
 
   // Transform to global frame
   Matrix2d Body2Global = RotationMatrix(getCurrentPsi());
@@ -185,6 +190,25 @@ void Agent::SetEpochPerformance(double G, size_t i) {
   }
 }
 
+void Agent::WriteBinary(std::ostream& out) {
+  easyio::write_binary(out, epochEvals);
+  AgentNE->WriteBinary(out);
+}
+
+bool Agent::ReadBinary(std::istream& in) {
+  vector<double> evals;
+  if (!easyio::read_binary(in, evals)) {
+    return false;
+  }
+
+  if (!AgentNE->ReadBinary(in)) {
+    return false;
+  }
+
+  epochEvals = evals;
+  return true;
+}
+
 void Agent::openOutputFile(std::string filename) {
   std::string uniqueFilename = filename + std::to_string(id);
   if (outputFile.is_open()) {
@@ -115,6 +115,12 @@ class Agent {
   void SetEpochPerformance(double G, size_t i);
 
   vector<double> GetEpochEvals() const{ return epochEvals; }
+
+  // Writes the learning state of the agent (epoch evaluations and the full
+  //   NeuroEvo population) for checkpointing. Reading restores it and returns
+  //   false if the stored agent does not match this one's network sizes.
+  void WriteBinary(std::ostream&);
+  bool ReadBinary(std::istream&);
   
   double getCurrentPsi() const { return currentState.psi(); }
   double getInitialPsi() const { return initialState.psi(); }
@@ -25,6 +25,7 @@ SOFTWARE.
 *******************************************************************************/
 
 #include "NeuralRover.h"
+#include "Utilities/PhaseTimer.h"
 
 NeuralRover::NeuralRover(size_t n, size_t nPop, Fitness f, vector<NeuralNet*> ns, vector<vector<size_t> > indices, size_t nOut)
   : Rover(n, nPop, 8, 16, nOut, f), netsX(ns), index(indices) {}
@@ -35,10 +36,14 @@ State NeuralRover::getNextState(size_t i, vector<State> jointState) const {
     justPos.push_back(s.pos());
   }
 
+  easytime::ScopedTimer sense(easytime::SENSE);
   VectorXd inp = ComputeNNInput(justPos);
+  sense.Stop();
   NeuroEvo* AgentNE = GetNEPopulation();
   
+  easytime::ScopedTimer policy(easytime::POLICY);
   VectorXd out = AgentNE->GetNNIndex(i)->EvaluateNN(inp).normalized();
+  policy.Stop();
 
 
   int max_index = 0;
@@ -26,6 +26,7 @@ SOFTWARE.
 *******************************************************************************/
 
 #include "Env.h"
+#include "Utilities/PhaseTimer.h"
 
 Env::Env(vector<double> w, vector<Agent*> team, vector<Target> pois, size_t nPop)
   : Env(w, team, pois, nPop, "Default") {}
@@ -56,6 +57,7 @@ void Env::applyStep(vector<State> jointStates) {
 }
 
 vector<State> Env::step(vector< size_t > teamIndex)  {
+  easytime::ScopedTimer timer(easytime::STEP);
   vector<State> nextStates = nextStep(teamIndex);
   applyStep(nextStates);
   return nextStates;
@@ -160,13 +162,23 @@ void Env::randomStep() {
   applyStep(perturbedStates);
 }
 
+vector< vector<State> > Env::randomSteps(size_t n) const {
+  vector< vector<State> > steps(n);
+  for (size_t k = 0; k < n; k++) {
+    steps[k].reserve(currentStates.size());
+    for (const auto& s : currentStates) {
+      steps[k].push_back(perturbState(s));
+    }
+  }
+
+  return steps;
+}
+
 State Env::perturbState(const State s) const {
-    std::random_device rd;
-    std::mt19937 e2(rd());
     std::normal_distribution<> dist(0,1);
 
-    double dx = dist(e2);
-    double dy = dist(e2);
+    double dx = dist(easymath::generator());
+    double dy = dist(easymath::generator());
 
     Vector2d newXY = s.pos();
     newXY(0) += dx;
@@ -79,6 +79,10 @@ class Env {
   void setTargetLocations(vector< Target > locs);
 
   void randomStep();
+
+  // A block of n joint states, each the current joint state with every agent
+  //   perturbed as in randomStep. Does not step the simulation.
+  vector< vector<State> > randomSteps(size_t n) const;
  private:
   size_t teamSize;
   vector< double > world;
@@ -69,3 +69,38 @@ double G::reward(Env* env) {
 
   return reward;
 }
+
+// Each target observes the history once, then a copy of it observes each step
+vector<double> G::rewardAfterSteps(Env* env, const vector< vector<State> >& steps) {
+  vector< Target > targets = env->getTargets(); // copied
+  vector< vector<State> > history = env->getHistoryStates();
+  vector<double> rewards(steps.size(), 0.0);
+
+  for (auto& target : targets) {
+    target.ResetTarget();
+
+    if (coupling != -1) {
+      target.setCoupling(coupling);
+    }
+
+    if (observationRadius != -1) {
+      target.setObservationRadius(observationRadius);
+    }
+
+    for (const auto& ss : history) {
+      for (const auto& s : ss) {
+	target.ObserveTarget(s.pos());
+      }
+    }
+
+    for (size_t k = 0; k < steps.size(); k++) {
+      Target extended = target;
+      for (const auto& s : steps[k]) {
+	extended.ObserveTarget(s.pos());
+      }
+      rewards[k] += extended.rewardAtCoupling(coupling);
+    }
+  }
+
+  return rewards;
+}
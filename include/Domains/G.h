@@ -55,6 +55,9 @@ class G : public Objective {
     Returns the reward of the current state of the environment.
    **/
   virtual double reward(Env* env);
+  virtual std::vector<double> rewardAfterSteps(Env* env, const std::vector< std::vector<State> >& steps);
+
+  virtual Objective* copyObjective() const { return new G(*this); }
 
  private:
   int coupling;
@@ -1,6 +1,8 @@
 #include "MAPElitesRover.h"
 
 MAPElitesRover::MAPElitesRover(vector<double> wLims, size_t nPOIs, size_t n, MatrixXd bins): worldLimits(wLims), numPOIs(nPOIs), nSteps(n), outputTraj(false){
+  pool = new ThreadPool(1) ;
+  deterministicInsert = false ;
   input_size = 4 ; // hard coded for 4 element input (body frame quadrant decomposition)
   output_size = 2 ; // hard coded for 2 element output [dx,dy]
   hidden_size = 2*input_size ; // hard coded for 2*input_size hidden nodes
@@ -8,6 +10,30 @@ MAPElitesRover::MAPElitesRover(vector<double> wLims, size_t nPOIs, size_t n, Mat
   minPOIVal = 1.0 ;
   maxPOIVal = 10.0 ;
   bpMap = new MAPElites(bins, input_size, output_size, hidden_size) ;
+  actionBehaviour = false ;
+  numWorlds = 0 ;
+  
+  // Use same world every time to create behaviour performance map
+  InitialiseSimulationWorld() ;
+}
+
+// CVT map constructor: 4 dimensional behaviours are the observation quadrants, 8 dimensional behaviours add the action quadrants
+MAPElitesRover::MAPElitesRover(vector<double> wLims, size_t nPOIs, size_t n, size_t numCells, size_t bDim): worldLimits(wLims), numPOIs(nPOIs), nSteps(n), outputTraj(false){
+  pool = new ThreadPool(1) ;
+  deterministicInsert = false ;
+  input_size = 4 ;
+  output_size = 2 ;
+  hidden_size = 2*input_size ;
+  
+  minPOIVal = 1.0 ;
+  maxPOIVal = 10.0 ;
+  if (bDim != 4 && bDim != 8){
+    std::cout << "Error: rover behaviours must have 4 or 8 elements! Using 4.\n" ;
+    bDim = 4 ;
+  }
+  actionBehaviour = (bDim == 8) ;
+  bpMap = new CVTMAPElites(CVTMAPElites::ComputeCentroids(bDim, numCells), input_size, output_size, hidden_size) ;
+  numWorlds = 0 ;
   
   // Use same world every time to create behaviour performance map
   InitialiseSimulationWorld() ;
@@ -16,6 +42,14 @@ MAPElitesRover::MAPElitesRover(vector<double> wLims, size_t nPOIs, size_t n, Mat
 MAPElitesRover::~MAPElitesRover(){
   delete(bpMap) ;
   bpMap = 0 ;
+  delete(pool) ;
+  pool = 0 ;
+}
+
+void MAPElitesRover::SetThreads(size_t numThreads, bool deterministic){
+  delete(pool) ;
+  pool = new ThreadPool(numThreads) ;
+  deterministicInsert = deterministic ;
 }
 
 void MAPElitesRover::InitialiseMap(size_t n){
@@ -32,7 +66,7 @@ void MAPElitesRover::InitialiseMap(size_t n){
     // Simulate controller in world
     VectorXd bVec ;
     bVec.setZero(bpMap->GetBDim(),1) ;
-    double eval = SimulateController(curNN, bVec) ;
+    double eval = EvaluateController(curNN, bVec, POIs) ;
     
     // Update MAPElites behaviour-performance map
     bpMap->UpdateMap(curNN, bVec, eval) ;
@@ -44,26 +78,21 @@ void MAPElitesRover::InitialiseMap(size_t n){
 }
 
 void MAPElitesRover::EvolveMap(size_t n){
+  if (bpMap->GetNumFilled() == 0){
+    std::cout << "Error: map must be initialised before it can be evolved!\n" ;
+    return ;
+  }
+  
   NeuralNet * curNN = new NeuralNet(input_size, output_size, hidden_size) ;
   
   for (size_t i = 0; i < n; i++){
     if ( fmod(i,(n/10)) == 0 )
       std::cout << i << " controllers tested...\n" ;
     
-    // Select a random behaviour and find corresponding NN in bpMap
+    // Select a random filled behaviour and find corresponding NN in bpMap
     VectorXd bVec ;
     bVec.setZero(bpMap->GetBDim(),1) ;
-    for (int j = 0; j < bVec.size(); j++)
-      bVec(j) = rand_interval(0.0,1.0) ;
-    
-    bool isTested = bpMap->IsVisited(bVec) ;
-    while (!isTested){
-      for (int j = 0; j < bVec.size(); j++)
-        bVec(j) = rand_interval(0.0,1.0) ;
-      isTested = bpMap->IsVisited(bVec) ;
-    }
-    
-    NeuralNet * tempNN = bpMap->GetNeuralNet(bVec) ;
+    NeuralNet * tempNN = bpMap->GetNeuralNet(bpMap->GetRandomFilledIndex()) ;
     
     // Copy weight matrices to current NN controller
     curNN->SetWeights(tempNN->GetWeightsA(),tempNN->GetWeightsB()) ;
@@ -75,7 +104,7 @@ void MAPElitesRover::EvolveMap(size_t n){
 //    InitialiseSimulationWorld() ; // commented out so that behaviour performance map is generated using the same simulation world
     
     // Simulate controller in world
-    double eval = SimulateController(curNN, bVec) ;
+    double eval = EvaluateController(curNN, bVec, POIs) ;
     
     // Update MAPElites behaviour-performance map
     bpMap->UpdateMap(curNN, bVec, eval) ;
@@ -87,23 +116,92 @@ void MAPElitesRover::EvolveMap(size_t n){
   std::cout << "Map evolution complete!\n" ;
 }
 
+// Simulate a batch of controllers in parallel and enter them into the map
+void MAPElitesRover::SimulateBatch(vector<NeuralNet *> & batch, size_t b){
+  vector<VectorXd> bVecs(b) ;
+  vector<double> evals(b) ;
+  size_t firstRank = bpMap->ReserveRanks(b) ;
+  vector< vector<Target> > worlds(pool->NumWorkers(), POIs) ; // per thread copy of the world
+  
+  pool->ParallelFor(b, [&](size_t k, size_t w){
+    bVecs[k].setZero(bpMap->GetBDim(),1) ;
+    evals[k] = EvaluateController(batch[k], bVecs[k], worlds[w]) ;
+    if (!deterministicInsert)
+      bpMap->UpdateMapConcurrent(batch[k], bVecs[k], evals[k], firstRank+k) ;
+  }) ;
+  
+  if (deterministicInsert)
+    for (size_t k = 0; k < b; k++)
+      bpMap->UpdateMapConcurrent(batch[k], bVecs[k], evals[k], firstRank+k) ;
+}
+
+void MAPElitesRover::InitialiseMapBatched(size_t n, size_t batchSize){
+  batchSize = max(batchSize, (size_t)1) ;
+  vector<NeuralNet *> batch ;
+  for (size_t done = 0; done < n; ){
+    size_t b = std::min(batchSize, n - done) ;
+    
+    // Create random NN controllers
+    for (size_t k = 0; k < b; k++)
+      batch.push_back(new NeuralNet(input_size, output_size, hidden_size)) ;
+    
+    SimulateBatch(batch, b) ;
+    
+    for (size_t k = 0; k < batch.size(); k++)
+      delete(batch[k]) ;
+    batch.clear() ;
+    done += b ;
+    std::cout << done << " controllers tested...\n" ;
+  }
+  std::cout << "Map initialisation complete!\n" ;
+}
+
+void MAPElitesRover::EvolveMapBatched(size_t n, size_t batchSize){
+  if (bpMap->GetNumFilled() == 0){
+    std::cout << "Error: map must be initialised before it can be evolved!\n" ;
+    return ;
+  }
+  
+  batchSize = max(batchSize, (size_t)1) ;
+  vector<NeuralNet *> batch ;
+  for (size_t k = 0; k < batchSize; k++)
+    batch.push_back(new NeuralNet(input_size, output_size, hidden_size)) ;
+  
+  for (size_t done = 0; done < n; ){
+    size_t b = std::min(batchSize, n - done) ;
+    
+    // Select random filled behaviours and mutate copies of their NNs
+    for (size_t k = 0; k < b; k++){
+      NeuralNet * tempNN = bpMap->GetNeuralNet(bpMap->GetRandomFilledIndex()) ;
+      batch[k]->SetWeights(tempNN->GetWeightsA(),tempNN->GetWeightsB()) ;
+      batch[k]->MutateWeights() ;
+    }
+    
+    SimulateBatch(batch, b) ;
+    
+    done += b ;
+    std::cout << done << " controllers tested...\n" ;
+  }
+  
+  // Release memory
+  for (size_t k = 0; k < batch.size(); k++)
+    delete(batch[k]) ;
+  
+  std::cout << "Map evolution complete!\n" ;
+}
+
 double MAPElitesRover::PercentageFilled(){
-  vector<bool> fLog = bpMap->GetFilledLog() ;
-  double filled = 0.0 ;
-  for (size_t i = 0; i < fLog.size(); i++)
-    if (fLog[i])
-      filled += 1.0 ;
-  filled /= ((double)fLog.size()) ;
-  return filled ;
+  return ((double)bpMap->GetNumFilled())/((double)bpMap->GetNumCells()) ;
 }
 
 double MAPElitesRover::BestPerformance(NeuralNet * bestNN, VectorXd & bVec){
-  vector<double> pLog = bpMap->GetPerformanceLog() ;
   double maxEval = 0.0 ;
   size_t maxInd = 0 ;
-  for (size_t i = 0; i < pLog.size(); i++){
-    if (pLog[i] > maxEval){
-      maxEval = pLog[i] ;
+  for (size_t k = 0; k < bpMap->GetNumFilled(); k++){
+    size_t i = bpMap->GetFilledIndex(k) ;
+    double p = bpMap->GetPerformance(i) ;
+    if (p > maxEval || (p == maxEval && p > 0.0 && i < maxInd)){ // lowest cell index wins ties, as in a dense scan
+      maxEval = p ;
       maxInd = i ;
     }
   }
@@ -116,6 +214,11 @@ double MAPElitesRover::BestPerformance(NeuralNet * bestNN, VectorXd & bVec){
   return maxEval ;
 }
 
+// Runtime policy lookup for a desired behaviour, never lands on an empty cell
+NeuralNet * MAPElitesRover::GetNearestController(VectorXd bVec){
+  return bpMap->GetNearestNeuralNet(bVec) ;
+}
+
 // Initial simulation parameters, includes setting initial rover position, POI positions and values
 void MAPElitesRover::InitialiseSimulationWorld(){
   // Clear initial world properties
@@ -149,7 +252,156 @@ void MAPElitesRover::InitialiseSimulationWorld(){
   }
 }
 
+// Evaluation used to build the map: mean over the evaluation worlds if they are set, otherwise the fixed world
+double MAPElitesRover::EvaluateController(NeuralNet * NN, VectorXd & bVec, vector<Target> & POIs){
+  if (numWorlds == 0)
+    return SimulateController(NN, bVec, POIs) ;
+  double variance ;
+  return SimulateControllerBatch(NN, bVec, variance) ;
+}
+
+void MAPElitesRover::SetEvaluationWorlds(size_t W){
+  numWorlds = W ;
+  
+  // Keep the fixed world to restore it as world 0
+  Vector2d fixedXY = initialXY ;
+  double fixedPsi = initialPsi ;
+  vector<Target> fixedPOIs = POIs ;
+  double fixedMaxEval = maxPossibleEval ;
+  
+  poiX.setZero(W, numPOIs) ;
+  poiY.setZero(W, numPOIs) ;
+  poiV.setZero(W, numPOIs) ;
+  worldX.setZero(W) ;
+  worldY.setZero(W) ;
+  worldPsi.setZero(W) ;
+  worldMaxEval.setZero(W) ;
+  obsRadius = fixedPOIs.empty() ? 0.0 : fixedPOIs[0].getObservationRadius() ;
+  
+  for (size_t w = 0; w < W; w++){
+    if (w > 0)
+      InitialiseSimulationWorld() ;
+    worldX(w) = initialXY(0) ;
+    worldY(w) = initialXY(1) ;
+    worldPsi(w) = initialPsi ;
+    worldMaxEval(w) = maxPossibleEval ;
+    for (size_t i = 0; i < numPOIs; i++){
+      poiX(w,i) = POIs[i].GetLocation()(0) ;
+      poiY(w,i) = POIs[i].GetLocation()(1) ;
+      poiV(w,i) = POIs[i].GetValue() ;
+    }
+  }
+  
+  initialXY = fixedXY ;
+  initialPsi = fixedPsi ;
+  POIs = fixedPOIs ;
+  maxPossibleEval = fixedMaxEval ;
+}
+
+// Simulate the controller in all evaluation worlds at once, matches SimulateController world by world
+double MAPElitesRover::SimulateControllerBatch(NeuralNet * NN, VectorXd & bVec, double & variance){
+  if (numWorlds == 0){
+    std::cout << "Error: evaluation worlds have not been set!\n" ;
+    variance = 0.0 ;
+    return 0.0 ;
+  }
+  size_t W = numWorlds ;
+  double stepFrac = 1.0/((double) nSteps) ;
+  
+  // Observation threshold as in ComputeBehaviourObservations
+  double thresholdObsVal = (maxPOIVal+minPOIVal)/2.0*numPOIs/4.0 ;
+  thresholdObsVal /= max(worldLimits[1]/2.0,worldLimits[3]/2.0) ;
+  
+  VectorXd bSum ;
+  bSum.setZero(bpMap->GetBDim()) ;
+  ArrayXd x = worldX ;
+  ArrayXd y = worldY ;
+  ArrayXd psi = worldPsi ;
+  ArrayXXd nearest = ArrayXXd::Constant(W, numPOIs, DBL_MAX) ;
+  MatrixXd s(4, W) ;
+  
+  for (size_t t = 0; t < nSteps; t++){
+    // Body frame NN input state in every world
+    s.setZero() ;
+    ArrayXd c = psi.cos() ;
+    ArrayXd sn = psi.sin() ;
+    for (size_t i = 0; i < numPOIs; i++){
+      ArrayXd vx = poiX.col(i) - x ;
+      ArrayXd vy = poiY.col(i) - y ;
+      ArrayXd bx = c*vx + sn*vy ;
+      ArrayXd by = c*vy - sn*vx ;
+      ArrayXd val = poiV.col(i)/((x - bx).square() + (y - by).square()).sqrt().max(1.0) ;
+      for (size_t w = 0; w < W; w++){
+        double theta = atan2(by(w),bx(w)) ;
+        size_t q ;
+        if (theta >= PI/2.0)
+          q = 3 ;
+        else if (theta >= 0.0)
+          q = 0 ;
+        else if (theta >= -PI/2.0)
+          q = 1 ;
+        else
+          q = 2 ;
+        s(q,w) += val(w) ;
+      }
+    }
+    
+    // Body frame actions for all worlds in one NN evaluation
+    MatrixXd a = NN->EvaluateNNBatch(s) ;
+    for (size_t w = 0; w < W; w++){
+      double n = a.col(w).norm() ;
+      if (n > 0.0)
+        a.col(w) /= n ;
+    }
+    ArrayXd ax = a.row(0).transpose().array() ;
+    ArrayXd ay = a.row(1).transpose().array() ;
+    
+    // Behaviour vector contributions
+    for (size_t w = 0; w < W; w++){
+      double deltaPsi = atan2(ay(w),ax(w)) ;
+      if (actionBehaviour){
+        size_t q ;
+        if (deltaPsi >= PI/2.0)
+          q = 3 ;
+        else if (deltaPsi >= 0.0)
+          q = 0 ;
+        else if (deltaPsi >= -PI/2.0)
+          q = 1 ;
+        else
+          q = 2 ;
+        bSum(bSum.size()-4+q) += stepFrac ;
+      }
+      for (size_t q = 0; q < 4; q++)
+        if (s(q,w) >= thresholdObsVal)
+          bSum(q) += stepFrac ;
+      psi(w) = pi_2_pi(psi(w) + deltaPsi) ;
+    }
+    
+    // Move in global frame
+    x += c*ax - sn*ay ;
+    y += sn*ax + c*ay ;
+    
+    // Record nearest observations within the observation radius
+    for (size_t i = 0; i < numPOIs; i++){
+      ArrayXd d = ((x - poiX.col(i)).square() + (y - poiY.col(i)).square()).sqrt() ;
+      nearest.col(i) = (d <= obsRadius).select(d.min(nearest.col(i)), nearest.col(i)) ;
+    }
+  }
+  
+  // Evaluate NN in each world
+  ArrayXd evals = ((nearest < DBL_MAX).select(poiV/nearest.max(1.0), 0.0)).rowwise().sum()/worldMaxEval ;
+  double mean = evals.mean() ;
+  variance = (evals - mean).square().mean() ;
+  bVec = bSum/((double) W) ;
+  
+  return mean ;
+}
+
 double MAPElitesRover::SimulateController(NeuralNet * NN, VectorXd & bVec, bool write){
+  return SimulateController(NN, bVec, POIs, write) ;
+}
+
+double MAPElitesRover::SimulateController(NeuralNet * NN, VectorXd & bVec, vector<Target> & POIs, bool write){
   // Write POI configuration to file
   if (write && outputTraj)
     for (size_t i = 0; i < numPOIs; i++)
@@ -168,7 +420,7 @@ double MAPElitesRover::SimulateController(NeuralNet * NN, VectorXd & bVec, bool
   
   for (size_t t = 0; t < nSteps; t++){
     // Calculate body frame NN input state
-    VectorXd s = ComputeNNInput(xy, psi) ;
+    VectorXd s = ComputeNNInput(xy, psi, POIs) ;
     
     // Calculate body frame action
     VectorXd a = NN->EvaluateNN(s).normalized() ;
@@ -179,7 +431,8 @@ double MAPElitesRover::SimulateController(NeuralNet * NN, VectorXd & bVec, bool
     double deltaPsi = atan2(a(1),a(0)) ;
     
     // Compute action motion quadrant for behaviour vector
-//    ComputeBehaviourActions(bVec, deltaPsi) ;
+    if (actionBehaviour)
+      ComputeBehaviourActions(bVec, deltaPsi) ;
     
     // Compute observation thresholds for behaviour vector
     ComputeBehaviourObservations(bVec, s) ;
@@ -239,8 +492,17 @@ void MAPElitesRover::ReadFromBinary(char * bpName, char * pName, char * fName){
   bpMap->ReadVisitedBinary(fName) ;
 }
 
+// Wrappers for the single file behaviour performance map archive
+bool MAPElitesRover::WriteArchive(const char * fName){
+  return bpMap->WriteArchive(fName) ;
+}
+
+bool MAPElitesRover::ReadArchive(const char * fName){
+  return bpMap->ReadArchive(fName) ;
+}
+
 // Compute the NN input state given the rover location and the POI locations and values in the world
-VectorXd MAPElitesRover::ComputeNNInput(Vector2d xy, double psi){
+VectorXd MAPElitesRover::ComputeNNInput(Vector2d xy, double psi, const vector<Target> & POIs){
   VectorXd s ;
   s.setZero(4,1) ;
   MatrixXd Global2Body = RotationMatrix(-psi) ;
@@ -291,7 +553,7 @@ void MAPElitesRover::ComputeBehaviourActions(VectorXd & bVec, double delta){
     q = 1 ;
   else
     q = 2 ;
-  bVec(q) += 1.0/((double) nSteps) ;
+  bVec(bVec.size()-4+q) += 1.0/((double) nSteps) ; // action quadrants follow any observation quadrants
 }
 
 void MAPElitesRover::ComputeBehaviourObservations(VectorXd & bVec, VectorXd s){
@@ -299,7 +561,7 @@ void MAPElitesRover::ComputeBehaviourObservations(VectorXd & bVec, VectorXd s){
   thresholdObsVal *= numPOIs ; // scaled by number of POIs
   thresholdObsVal /= ((double)s.size()) ; // divided by number of observation quadrants
   thresholdObsVal /= max(worldLimits[1]/2.0,worldLimits[3]/2.0) ; // divided by half the longest length scale of world
-  for (int i = 0; i < bVec.size(); i++)
+  for (int i = 0; i < s.size(); i++)
     if (s(i) >= thresholdObsVal)
       bVec(i) += 1.0/((double) nSteps) ;
 }
@@ -6,6 +6,8 @@
 #include <math.h>
 #include <Eigen/Eigen>
 #include "Learning/MAPElites.h"
+#include "Learning/CVTMAPElites.h"
+#include "Utilities/ThreadPool.h"
 #include "Target.h"
 
 #ifndef PI
@@ -19,20 +21,51 @@ using std::max ;
 
 class MAPElitesRover{
   public:
-    MAPElitesRover(vector<double>, size_t, size_t, MatrixXd) ;
+    MAPElitesRover(vector<double>, size_t, size_t, MatrixXd) ; // world limits, number of POIs, number of steps, bin limits
+    MAPElitesRover(vector<double>, size_t, size_t, size_t, size_t) ; // CVT map with the given number of cells and behaviour size (4 or 8)
     ~MAPElitesRover() ;
     
     void InitialiseMap(size_t) ;
     void EvolveMap(size_t) ;
     double SimulateController(NeuralNet *, VectorXd &, bool write = false) ;
+    double SimulateController(NeuralNet *, VectorXd &, vector<Target> &, bool write = false) ; // in a given copy of the POIs
+    
+    // Multi-world evaluation: world 0 is the fixed map world and the others
+    // are generated once here, so every controller sees the same set. World
+    // data is stored one row per world so that each step senses, acts and
+    // observes in all worlds at once, with a single batched NN evaluation.
+    // Once set, the map is built from the mean performance and the mean
+    // behaviour over the worlds. Zero worlds returns to the single world.
+    void SetEvaluationWorlds(size_t) ;
+    size_t GetNumEvaluationWorlds() {return numWorlds ;}
+    double SimulateControllerBatch(NeuralNet *, VectorXd &, double &) ; // returns mean, sets mean behaviour and performance variance
+    
+    // Batched MAP-Elites: each batch of controllers is created on the calling
+    // thread (so random draws do not depend on the number of threads) and
+    // simulated across the thread pool, each thread in its own copy of the
+    // world. Parents are selected from the map as it was at the start of the
+    // batch. Results enter the map as they finish, or in batch order once the
+    // whole batch is done if deterministic is set. Either way a batch leaves
+    // the same elites in the map, but only the deterministic mode also fixes
+    // the order in which new cells are filled, which later parent draws use,
+    // so only it reproduces a run exactly for any number of threads.
+    void SetThreads(size_t numThreads, bool deterministic = false) ;
+    void InitialiseMapBatched(size_t, size_t) ; // number of controllers, batch size
+    void EvolveMapBatched(size_t, size_t) ;
     
     double PercentageFilled() ;
     double BestPerformance(NeuralNet *, VectorXd &) ;
+    NeuralNet * GetNearestController(VectorXd) ; // elite of the nearest filled cell, owned by the map
     void OutputTrajectories(char *, char *) ;
     void WriteToBinary(char *, char *, char *) ;
     void ReadFromBinary(char *, char *, char *) ;
+    bool WriteArchive(const char *) ; // single file archive, see MAPElitesArchive.h
+    bool ReadArchive(const char *) ;
   private:
     MAPElites * bpMap ;
+    bool actionBehaviour ; // behaviour includes the action quadrants
+    ThreadPool * pool ;
+    bool deterministicInsert ;
     
     // NN controller properties
     size_t input_size ;
@@ -50,6 +83,17 @@ class MAPElitesRover{
     double maxPOIVal ;
     double maxPossibleEval ;
     
+    // Evaluation worlds, one row per world
+    size_t numWorlds ;
+    ArrayXXd poiX ;
+    ArrayXXd poiY ;
+    ArrayXXd poiV ;
+    ArrayXd worldX ;
+    ArrayXd worldY ;
+    ArrayXd worldPsi ;
+    ArrayXd worldMaxEval ;
+    double obsRadius ;
+    
     // Write variables
     bool outputTraj ;
     std::ofstream trajFile ;
@@ -57,7 +101,10 @@ class MAPElitesRover{
     
     void InitialiseSimulationWorld() ;
     
-    VectorXd ComputeNNInput(Vector2d, double) ;
+    void SimulateBatch(vector<NeuralNet *> &, size_t) ;
+    double EvaluateController(NeuralNet *, VectorXd &, vector<Target> &) ;
+    
+    VectorXd ComputeNNInput(Vector2d, double, const vector<Target> &) ;
     Matrix2d RotationMatrix(double) ;
     void ComputeBehaviourActions(VectorXd &, double) ;
     void ComputeBehaviourObservations(VectorXd &, VectorXd) ;
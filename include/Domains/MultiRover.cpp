@@ -1,11 +1,17 @@
 #include "MultiRover.h"
+#include "Utilities/PhaseTimer.h"
+
+// Checkpoint file header
+static const char checkpointMagic[8] = {'A','A','D','I','L','C','K','P'};
+static const unsigned checkpointVersion = 1;
 
 MultiRover::MultiRover(vector<double> w, size_t numSteps, size_t numPop, size_t
 		       numPOIs, Fitness f, size_t rovs, int c, AgentType t)
   : world(w), nSteps(numSteps), nPop(numPop), nPOIs(numPOIs), nRovers(rovs),
     coupling(c), fitness(f), outputEvals(false), outputTrajs(false),
     outputQury(false), outputBlf(false), gPOIObs(false), type(t), verbose(true),
-    biasStart(true) {
+    biasStart(true), recordTrajs(false), archiveTrajs(false), binaryTrajs(0), recordEpoch(0),
+    recordTeam(0), lastMaxEval(0.0) {
 
   initRovers();
 }
@@ -17,7 +23,8 @@ MultiRover::MultiRover(vector<double> w, size_t numSteps, size_t numPop, size_t
   : world(w), nSteps(numSteps), nPop(numPop), nPOIs(numPOIs), nRovers(rovs),
     coupling(c), fitness(f), outputEvals(false), outputTrajs(false),
     outputQury(false), outputBlf(false), gPOIObs(false), verbose(true),
-    biasStart(true) {
+    biasStart(true), recordTrajs(false), archiveTrajs(false), binaryTrajs(0), recordEpoch(0),
+    recordTeam(0), lastMaxEval(0.0) {
 
   size_t nOut = inds.size();
   for (size_t i = 0; i < nRovers; i++) {
@@ -47,6 +54,11 @@ MultiRover::~MultiRover() {
     trajFile.close() ;
     POIFile.close() ;
   }
+  if (recordTrajs || archiveTrajs){
+    trajRecorder.Close() ;
+    trajArchive.Close() ;
+    POIFile.close() ;
+  }
 }
 
 void MultiRover::initRovers() {
@@ -122,16 +134,15 @@ void MultiRover::InitialiseEpochFromVectors(vector<Target> targets,
 
 
 vector< vector<size_t> > MultiRover::RandomiseTeams(size_t n){
+  easytime::ScopedTimer timer(easytime::TEAMS) ;
   vector< vector<size_t> > teams ;
   vector<size_t> order ;
   for (size_t i = 0; i < n; i++) {
     order.push_back(i) ;
   }
   
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count() ;
-
   for (size_t j = 0; j < nRovers; j++){
-    shuffle (order.begin(), order.end(), std::default_random_engine(seed)) ;
+    shuffle (order.begin(), order.end(), easymath::generator()) ;
     teams.push_back(order) ;
   }
   
@@ -175,14 +186,29 @@ vector< Agent* > MultiRover::duplicate(vector< Agent* > agents, size_t n) {
 }
 
 double MultiRover::runSim(Env* env, vector< size_t > teamIndex, Objective* o) {
+  easytime::ScopedTimer timer(easytime::ROLLOUT);
   for (size_t t = 0; t < nSteps; t++) {
     vector< State > jointState = env->step(teamIndex);
 
     if (outputTrajs) {
       printJointState(jointState);
     }
+    if (recordTrajs || archiveTrajs) {
+      for (size_t j = 0; j < jointState.size(); j++) {
+	Vector2d xy = jointState[j].pos();
+	TrajectoryRecord r = {(unsigned) recordEpoch, (unsigned) recordTeam,
+			      (unsigned) t, (unsigned) j, xy(0), xy(1),
+			      jointState[j].psi()};
+	if (recordTrajs) {
+	  trajRecorder.Append(r);
+	} else {
+	  teamTrajectory.push_back(r);
+	}
+      }
+    }
   }
 
+  easytime::ScopedTimer rewardTimer(easytime::REWARD);
   return o->reward(env);
 }
 
@@ -200,12 +226,13 @@ Env* MultiRover::createSim(size_t teamSize) {
   return env;
 }
 void MultiRover::SimulateEpoch(bool train, Objective* o){
+  easytime::ScopedTimer timer(easytime::SIMULATE);
   size_t teamSize = train ? 2*nPop : nPop;
     
   // each row is the population for a single agent
   vector< vector<size_t> > teams = RandomiseTeams(teamSize) ; 
 
-  if (outputTrajs) {
+  if (outputTrajs || recordTrajs || archiveTrajs) {
     printPOIs();
   }
 
@@ -227,9 +254,14 @@ void MultiRover::SimulateEpoch(bool train, Objective* o){
       printJointState(jointState);
       toggleAgentOutput(true);
     }
-    
+
+    recordTeam = i;
     double eval = runSim(env, netEachAgentUses, o);
     env->reset();
+    if (archiveTrajs) {
+      trajArchive.AddTrajectory(recordEpoch, recordTeam, teamTrajectory);
+      teamTrajectory.clear();
+    }
     maxEval = max(eval, maxEval);
     
     // Assign fitness
@@ -243,9 +275,13 @@ void MultiRover::SimulateEpoch(bool train, Objective* o){
   }
 
   delete env;
+  lastMaxEval = maxEval;
   if (outputEvals) {
     evalFile << std::endl;
   }
+  if (recordTrajs || archiveTrajs) {
+    recordEpoch++;
+  }
 
   if (verbose) {
     std::cout << "max achieved value: " << maxEval << "..." << std::endl;
@@ -253,6 +289,7 @@ void MultiRover::SimulateEpoch(bool train, Objective* o){
 }
 
 void MultiRover::EvolvePolicies(bool init){
+  easytime::ScopedTimer timer(easytime::EVOLVE);
   for (auto& rov : roverTeam) {
     rov->EvolvePolicies(init);
   }
@@ -295,6 +332,38 @@ void MultiRover::OutputTrajectories(std::string tFile, std::string poiFile,
   outputTrajs = true ;
 }
 
+void MultiRover::RecordTrajectories(std::string tFile, std::string poiFile) {
+  if (!trajRecorder.Open(tFile)) {
+    return;
+  }
+  
+  if (POIFile.is_open()) {
+    POIFile.close();
+  }
+  POIFile.open(poiFile.c_str(),std::ios::app) ;
+
+  recordEpoch = 0;
+  recordTrajs = true;
+  archiveTrajs = false;
+}
+
+void MultiRover::ArchiveTrajectories(std::string tFile, std::string poiFile,
+				     double quantum) {
+  if (!trajArchive.Open(tFile, quantum)) {
+    return;
+  }
+  
+  if (POIFile.is_open()) {
+    POIFile.close();
+  }
+  POIFile.open(poiFile.c_str(),std::ios::app) ;
+
+  recordEpoch = 0;
+  teamTrajectory.clear();
+  archiveTrajs = true;
+  recordTrajs = false;
+}
+
 // Wrapper for writing final control policies to specified file
 void MultiRover::OutputControlPolicies(std::string nnFile) {
   for (auto const& rover : roverTeam) {
@@ -370,8 +439,8 @@ void MultiRover::loadNNs(string nnFile, size_t numIn, size_t numHidden,
   for (auto& rov : roverTeam) {
     NeuroEvo* rovNE = rov->GetNEPopulation();
     for (size_t i = 0; i < getNPop(); i++) {
-      rovNE->GetNNIndex(i)->SetWeights(loadedNN[k]->GetWeightsA(),
-				       loadedNN[k]->GetWeightsB());
+      rovNE->SetNNWeights(i, loadedNN[k]->GetWeightsA(),
+			  loadedNN[k]->GetWeightsB());
       k++;
     }
   }
@@ -436,13 +505,13 @@ void MultiRover::ExecutePolicies(string expFile, string novFile,
     NeuroEvo * rovNE = roverTeam[i]->GetNEPopulation() ;
     if (k == 0){
       for (size_t j = 0; j < nPop; j++){
-        rovNE->GetNNIndex(j)->SetWeights(novLoadedNN[k]->GetWeightsA(),novLoadedNN[k]->GetWeightsB()) ;
+        rovNE->SetNNWeights(j, novLoadedNN[k]->GetWeightsA(), novLoadedNN[k]->GetWeightsB()) ;
         k++ ;
       }
     }
     else {
       for (size_t j = 0; j < nPop; j++){
-        rovNE->GetNNIndex(j)->SetWeights(expLoadedNN[k]->GetWeightsA(),expLoadedNN[k]->GetWeightsB()) ;
+        rovNE->SetNNWeights(j, expLoadedNN[k]->GetWeightsA(), expLoadedNN[k]->GetWeightsB()) ;
         k++ ;
       }
     }
@@ -466,10 +535,10 @@ void MultiRover::ExecutePolicies(string expFile, string novFile,
   }
 }
 
-vector<NeuralNet*> MultiRover::getNNTeam() {
-  std::vector<NeuralNet*> nets;
+vector< std::shared_ptr<NeuralNet> > MultiRover::getNNTeam() {
+  vector< std::shared_ptr<NeuralNet> > nets;
   for (auto& rov : roverTeam) {
-    nets.push_back(rov->GetNEPopulation()->GetNNIndex(0));
+    nets.push_back(rov->GetNEPopulation()->GetSharedNN(0));
   }
   return nets;
 }
@@ -643,3 +712,132 @@ vector< State > MultiRover::getInitialStates() {
 
   return states;
 }
+
+string MultiRover::serializeCheckpoint(size_t epoch) {
+  std::ostringstream out(std::ios::out | std::ios::binary);
+  out.write(checkpointMagic, sizeof(checkpointMagic));
+  easyio::write_binary(out, checkpointVersion);
+  easyio::write_binary(out, static_cast<unsigned long long>(epoch));
+  easyio::write_binary(out, static_cast<unsigned long long>(nRovers));
+  easyio::write_binary(out, static_cast<unsigned long long>(nPop));
+  easyio::write_binary(out, static_cast<int>(type));
+
+  easyio::write_binary(out, world);
+
+  easyio::write_binary(out, static_cast<unsigned long long>(initialXYs.size()));
+  for (const auto& xy : initialXYs) {
+    easyio::write_binary(out, xy(0));
+    easyio::write_binary(out, xy(1));
+  }
+  easyio::write_binary(out, initialPsis);
+
+  easyio::write_binary(out, static_cast<unsigned long long>(POIs.size()));
+  for (const auto& poi : POIs) {
+    Vector2d loc = poi.GetLocation();
+    easyio::write_binary(out, loc(0));
+    easyio::write_binary(out, loc(1));
+    easyio::write_binary(out, poi.GetValue());
+    easyio::write_binary(out, poi.getCoupling());
+    easyio::write_binary(out, poi.getObservationRadius());
+  }
+
+  easyio::write_binary(out, easymath::get_generator_state());
+
+  for (auto& rov : roverTeam) {
+    rov->WriteBinary(out);
+  }
+
+  return out.str();
+}
+
+void MultiRover::WriteCheckpoint(string fileName, size_t epoch) {
+  checkpointWriter.Write(fileName, serializeCheckpoint(epoch));
+}
+
+bool MultiRover::ReadCheckpoint(string fileName, size_t& epoch) {
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+
+  char magic[sizeof(checkpointMagic)];
+  unsigned version;
+  in.read(magic, sizeof(magic));
+  if (!in.good() || !std::equal(magic, magic + sizeof(magic), checkpointMagic) ||
+      !easyio::read_binary(in, version) || version != checkpointVersion) {
+    std::cout << "Error: " << fileName << " is not a checkpoint file!" << std::endl;
+    return false;
+  }
+
+  unsigned long long storedEpoch, storedRovers, storedPop;
+  int storedType;
+  easyio::read_binary(in, storedEpoch);
+  easyio::read_binary(in, storedRovers);
+  easyio::read_binary(in, storedPop);
+  easyio::read_binary(in, storedType);
+  if (!in.good() || storedRovers != nRovers || storedPop != nPop ||
+      storedType != static_cast<int>(type) || roverTeam.size() != nRovers) {
+    std::cout << "Error: checkpoint " << fileName << " does not match the domain!"
+	      << std::endl;
+    return false;
+  }
+
+  vector<double> storedWorld;
+  easyio::read_binary(in, storedWorld);
+
+  unsigned long long n;
+  vector<Vector2d> storedXYs;
+  easyio::read_binary(in, n);
+  for (size_t i = 0; i < n && in.good(); i++) {
+    Vector2d xy;
+    easyio::read_binary(in, xy(0));
+    easyio::read_binary(in, xy(1));
+    storedXYs.push_back(xy);
+  }
+
+  vector<double> storedPsis;
+  easyio::read_binary(in, storedPsis);
+
+  vector<Target> storedPOIs;
+  easyio::read_binary(in, n);
+  for (size_t i = 0; i < n && in.good(); i++) {
+    Vector2d loc;
+    double value, obsR;
+    int c;
+    easyio::read_binary(in, loc(0));
+    easyio::read_binary(in, loc(1));
+    easyio::read_binary(in, value);
+    easyio::read_binary(in, c);
+    easyio::read_binary(in, obsR);
+    storedPOIs.push_back(Target(loc, value, c, obsR, false));
+  }
+
+  string rngState;
+  if (!easyio::read_binary(in, rngState)) {
+    std::cout << "Error: checkpoint " << fileName << " is truncated!" << std::endl;
+    return false;
+  }
+
+  for (auto& rov : roverTeam) {
+    if (!rov->ReadBinary(in)) {
+      std::cout << "Error: unable to restore agents from " << fileName << std::endl;
+      return false;
+    }
+  }
+
+  easymath::set_generator_state(rngState);
+  world = storedWorld;
+  initialXYs = storedXYs;
+  initialPsis = storedPsis;
+  POIs = storedPOIs;
+  nPOIs = POIs.size();
+  epoch = storedEpoch;
+
+  return true;
+}
+
+void MultiRover::setGenomeStorage(size_t cacheSize, size_t maxDepth) {
+  for (auto& rov : roverTeam) {
+    rov->GetNEPopulation()->CompressPopulation(cacheSize, maxDepth);
+  }
+}
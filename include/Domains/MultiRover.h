@@ -23,6 +23,11 @@
 #include "Objective.h"
 #include "G.h"
 
+#include "Utilities/AsyncFileWriter.h"
+#include "Utilities/TrajectoryRecorder.h"
+#include "Utilities/TrajectoryArchive.h"
+#include "Utilities/BinaryIO.h"
+
 using std::string ;
 using std::vector ;
 using std::shuffle ;
@@ -51,8 +56,9 @@ class MultiRover{
     ~MultiRover();
 
 
-    // Gets each agent's first neural net. Does not get the best net.
-    vector<NeuralNet*> getNNTeam();
+    // Gets each agent's first neural net. Does not get the best net. The nets
+    //   stay valid while held, even with compressed populations.
+    vector< std::shared_ptr<NeuralNet> > getNNTeam();
     void initRovers();
     
     void InitialiseEpoch();
@@ -77,6 +83,18 @@ class MultiRover{
 
     void OutputPerformance(std::string) ;
     void OutputTrajectories(std::string, std::string, std::string) ;
+    // Binary alternative to OutputTrajectories: every agent's position and
+    //   heading at every step of every team is appended to a
+    //   TrajectoryRecorder file (first input) and written by a background
+    //   thread. POIs are written as text to the second input. Epochs are
+    //   counted from 0 by the calls to SimulateEpoch after this one.
+    void RecordTrajectories(std::string, std::string) ;
+    // As RecordTrajectories, but each team's trajectory is quantised (third
+    //   input), delta encoded and compressed into a TrajectoryArchive that is
+    //   indexed by epoch and team. The archive is complete once the domain
+    //   is destroyed or CloseTrajectoryArchive is called.
+    void ArchiveTrajectories(std::string, std::string, double quantum = 1e-3) ;
+    void CloseTrajectoryArchive() { trajArchive.Close(); }
     void OutputControlPolicies(std::string) ;
     void OutputQueries(char *) ;
     void OutputBeliefs(char *) ;
@@ -102,6 +120,27 @@ class MultiRover{
     void loadNNsNeuralRover(vector<string>, vector<size_t>, vector<size_t>,
 			    vector<size_t>, vector<vector<size_t>>);
     
+    // A checkpoint holds everything needed to continue training after an
+    //   epoch: world, POIs and initial rover states, every agent's population
+    //   and epoch evaluations, the random engine state and the epoch index.
+    //   The domain is serialised in memory and the file is written by a
+    //   background thread, so training continues immediately.
+    void WriteCheckpoint(string fileName, size_t epoch);
+
+    // Restores a checkpoint written by a domain with the same number of
+    //   rovers, population size and agent type. The stored epoch index is
+    //   returned in the second argument. Returns false if the file is missing
+    //   or does not match this domain.
+    bool ReadCheckpoint(string fileName, size_t& epoch);
+
+    // Blocks until all queued checkpoints are on disk
+    void FlushCheckpoints() { checkpointWriter.Flush(); }
+
+    // Store every rover's population as seed chains (see GenomeStore),
+    //   keeping at most cacheSize materialised NNs per rover and chains of
+    //   at most maxDepth mutations.
+    void setGenomeStorage(size_t cacheSize, size_t maxDepth);
+    
     void setNSteps(size_t n)        { nSteps = n; }
     void setNPop(size_t n)          { nPop = n; }
     void setNPOIs(size_t n)         { nPOIs = n; }
@@ -113,6 +152,7 @@ class MultiRover{
     void setWorld(vector<double> w) { world = w; }
     void setVerbose(bool toggle)    { verbose = toggle; }
     void setBias(bool bias)         { biasStart = bias; }
+    void setBinaryTrajectories(int b) { binaryTrajs = b; } // 1 recorder, 2 archive
     
     size_t         getNSteps()   { return nSteps; }
     size_t         getNPop()     { return nPop; }
@@ -127,6 +167,8 @@ class MultiRover{
     vector< Target > getPOIs()   { return POIs; }
     bool           getVerbose()  { return verbose; }
     bool           getBias()     { return biasStart; }
+    int            getBinaryTrajectories() { return binaryTrajs; }
+    double         getMaxEval()  { return lastMaxEval; } // best team in the last SimulateEpoch
 
     friend std::ostream& operator<<(std::ostream&, const MultiRover&);
 
@@ -179,6 +221,9 @@ class MultiRover{
     bool outputQury ;
     bool outputBlf ;
     bool outputAvgStepR ;
+    bool recordTrajs ;
+    bool archiveTrajs ;
+    int binaryTrajs ;
     
     std::ofstream evalFile ;
     std::ofstream trajFile ;
@@ -188,8 +233,18 @@ class MultiRover{
     std::ofstream blfFile ;
     std::ofstream avgStepRFile ;
     std::ofstream trajChoiceFile;
+
+    TrajectoryRecorder trajRecorder;
+    TrajectoryArchiveWriter trajArchive;
+    vector<TrajectoryRecord> teamTrajectory;
+    size_t recordEpoch;
+    size_t recordTeam;
+    double lastMaxEval;
     
     vector< vector<size_t> > RandomiseTeams(size_t) ;
+
+    AsyncFileWriter checkpointWriter;
+    string serializeCheckpoint(size_t epoch);
 } ;
 
 #endif // MULTIROVER_H_
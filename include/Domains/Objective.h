@@ -31,7 +31,14 @@ SOFTWARE.
 
 class Objective {
 public:
+  virtual ~Objective() {}
   virtual double reward(Env* e) = 0;
+
+  // Rewards of the environment's history extended by each of the given joint
+  //   states in turn, as if each were applied with Env::applyStep. The shared
+  //   history is only evaluated once and the environment is not changed.
+  virtual std::vector<double> rewardAfterSteps(Env* e, const std::vector< std::vector<State> >& steps) = 0;
   virtual std::string getName() { return "Objective"; }
+  virtual Objective* copyObjective() const = 0; // caller owns the copy
 };
 #endif//OBJ_H_
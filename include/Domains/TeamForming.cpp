@@ -69,3 +69,41 @@ double TeamForming::reward(Env* env) {
 
   return reward / maxR;
 }
+
+// Each agent's target follows the history once, then a copy of it follows each step
+vector<double> TeamForming::rewardAfterSteps(Env* env, const vector< vector<State> >& steps) {
+  size_t numAgents = env->getAgents().size();
+  vector< vector< State > > allJointStates = env->getHistoryStates();
+  size_t t = allJointStates.size(); // time of the extra step
+  vector<double> rewards(steps.size(), 0.0);
+
+  double maxR = 0;
+  for (size_t agent = 0; agent < numAgents; agent++) {
+    Target currentAgent(allJointStates[0][agent].pos(), 10, coupling, observationRadius, false);
+    maxR += 10;
+    for (size_t h = 0; h < allJointStates.size(); h++) {
+      currentAgent.setLocation(allJointStates[h][agent].pos());
+      for (size_t other = 0; other < numAgents; other++) {
+	if (other != agent) {
+	  currentAgent.ObserveTarget(allJointStates[h][other].pos(), h);
+	}
+      }
+    }
+
+    for (size_t k = 0; k < steps.size(); k++) {
+      Target extended = currentAgent;
+      extended.setLocation(steps[k][agent].pos());
+      for (size_t other = 0; other < numAgents; other++) {
+	if (other != agent) {
+	  extended.ObserveTarget(steps[k][other].pos(), t);
+	}
+      }
+      rewards[k] += extended.rewardAtCoupling(coupling);
+    }
+  }
+
+  for (auto& r : rewards) {
+    r /= maxR;
+  }
+  return rewards;
+}
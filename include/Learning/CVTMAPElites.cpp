@@ -0,0 +1,56 @@
+#include "CVTMAPElites.h"
+
+CVTMAPElites::CVTMAPElites(MatrixXd centroids, size_t nIn, size_t nOut, size_t nHid): MAPElites(CVT, centroids, centroids.cols(), nIn, nOut, nHid), centroidTree(centroids.rows()){
+  std::vector<double> points(centroids.data(), centroids.data() + centroids.size()) ; // columns are contiguous
+  centroidTree.Build(points) ;
+}
+
+// Returns the index of the nearest centroid
+size_t CVTMAPElites::GetIndex(VectorXd behaviour){
+  if (behaviour.size() != bDim){
+    std::cout << "Error: input behaviour vector has the wrong number of elements!\n" ;
+    return 0 ;
+  }
+  size_t n ;
+  double sqDist ;
+  if (!centroidTree.Nearest(behaviour.data(), n, sqDist)){
+    std::cout << "Error: behaviour map has no cells!\n" ;
+    return 0 ;
+  }
+  return n ;
+}
+
+VectorXd CVTMAPElites::GetBehaviour(size_t n){
+  return binLimits.col(n) ;
+}
+
+MatrixXd CVTMAPElites::ComputeCentroids(size_t bDim, size_t numCells, size_t samplesPerCell, size_t iterations){
+  size_t numSamples = numCells*std::max(samplesPerCell, (size_t)1) ;
+  MatrixXd samples(bDim, numSamples) ;
+  for (size_t i = 0; i < numSamples; i++)
+    for (size_t j = 0; j < bDim; j++)
+      samples(j,i) = rand_interval(0.0, 1.0) ;
+  
+  // Start from the first numCells samples
+  MatrixXd centroids = samples.leftCols(numCells) ;
+  
+  for (size_t it = 0; it < iterations; it++){
+    KdTree tree(bDim) ;
+    tree.Build(std::vector<double>(centroids.data(), centroids.data() + centroids.size())) ;
+    
+    // Move each centroid to the mean of the samples closest to it
+    MatrixXd sums = MatrixXd::Zero(bDim, numCells) ;
+    VectorXd counts = VectorXd::Zero(numCells) ;
+    for (size_t i = 0; i < numSamples; i++){
+      size_t n ;
+      double sqDist ;
+      tree.Nearest(samples.col(i).data(), n, sqDist) ;
+      sums.col(n) += samples.col(i) ;
+      counts(n) += 1.0 ;
+    }
+    for (size_t n = 0; n < numCells; n++)
+      if (counts(n) > 0.0) // empty cells keep their centroid
+        centroids.col(n) = sums.col(n)/counts(n) ;
+  }
+  return centroids ;
+}
@@ -0,0 +1,27 @@
+#ifndef CVT_MAP_ELITES_H_
+#define CVT_MAP_ELITES_H_
+
+#include <vector>
+#include <Eigen/Eigen>
+#include "Learning/MAPElites.h"
+#include "Utilities/KdTree.h"
+
+// MAP-Elites over a centroidal Voronoi tessellation of the behaviour space.
+// Each cell is the region closest to one centroid, so the number of cells is
+// fixed by the caller instead of growing exponentially with the behaviour
+// dimension. Cell lookup is a nearest centroid query on a kd-tree.
+class CVTMAPElites : public MAPElites{
+  public:
+    CVTMAPElites(MatrixXd, size_t, size_t, size_t) ; // centroids (one per column), nIn, nOut, nHidden
+    ~CVTMAPElites(){}
+    
+    size_t GetIndex(VectorXd) ;
+    VectorXd GetBehaviour(size_t) ; // centroid of the cell
+    
+    // Lloyd's algorithm on uniform samples of the unit hypercube, returns
+    // numCells centroids of dimension bDim, one per column
+    static MatrixXd ComputeCentroids(size_t bDim, size_t numCells, size_t samplesPerCell = 20, size_t iterations = 20) ;
+  private:
+    KdTree centroidTree ;
+} ;
+#endif // CVT_MAP_ELITES_H_
@@ -0,0 +1,140 @@
+#include <iostream>
+#include "GenomeStore.h"
+
+GenomeStore::GenomeStore(size_t nIn, size_t nOut, size_t nHidden, size_t cSize, size_t depth): numIn(nIn), numOut(nOut), numHidden(nHidden), cacheSize(cSize), maxDepth(depth), numRoots(0), numReplays(0){
+  if (cacheSize < 1)
+    cacheSize = 1 ;
+}
+
+GenomeStore::~GenomeStore(){}
+
+size_t GenomeStore::NewGenome(){
+  size_t i ;
+  if (freeIds.empty()){
+    i = genomes.size() ;
+    genomes.push_back(Genome()) ;
+  }
+  else {
+    i = freeIds.back() ;
+    freeIds.pop_back() ;
+  }
+  genomes[i].refs = 1 ;
+  return i ;
+}
+
+size_t GenomeStore::AddRoot(MatrixXd A, MatrixXd B){
+  size_t i = NewGenome() ;
+  genomes[i].parent = i ;
+  genomes[i].seed = 0 ;
+  genomes[i].depth = 0 ;
+  genomes[i].weightsA = A ;
+  genomes[i].weightsB = B ;
+  numRoots++ ;
+  return i ;
+}
+
+size_t GenomeStore::AddChild(size_t parent, unsigned seed){
+  // Collapse chains that would exceed the depth limit into a new root
+  if (genomes[parent].depth + 1 > maxDepth){
+    std::shared_ptr<NeuralNet> p = Materialise(parent) ;
+    NeuralNet child(numIn, numOut, numHidden) ;
+    child.SetWeights(p->GetWeightsA(), p->GetWeightsB()) ;
+    child.MutateWeights(seed) ;
+    return AddRoot(child.GetWeightsA(), child.GetWeightsB()) ;
+  }
+  
+  size_t i = NewGenome() ;
+  genomes[i].parent = parent ;
+  genomes[i].seed = seed ;
+  genomes[i].depth = genomes[parent].depth + 1 ;
+  genomes[i].weightsA.resize(0,0) ;
+  genomes[i].weightsB.resize(0,0) ;
+  Retain(parent) ;
+  return i ;
+}
+
+void GenomeStore::Retain(size_t i){
+  genomes[i].refs++ ;
+}
+
+void GenomeStore::Release(size_t i){
+  // Walk up the chain iteratively, parents may be freed in turn
+  while (true){
+    if (genomes[i].refs == 0){
+      std::cout << "Error: releasing a genome that is not stored!\n" ;
+      return ;
+    }
+    genomes[i].refs-- ;
+    if (genomes[i].refs > 0)
+      return ;
+    
+    Evict(i) ;
+    freeIds.push_back(i) ;
+    if (genomes[i].depth == 0){
+      genomes[i].weightsA.resize(0,0) ;
+      genomes[i].weightsB.resize(0,0) ;
+      numRoots-- ;
+      return ;
+    }
+    i = genomes[i].parent ;
+  }
+}
+
+std::shared_ptr<NeuralNet> GenomeStore::Materialise(size_t i){
+  std::shared_ptr<NeuralNet> NN = Cached(i) ;
+  if (NN)
+    return NN ;
+  
+  // Collect the seeds back to the nearest root or cached ancestor
+  vector<unsigned> seeds ;
+  size_t j = i ;
+  std::shared_ptr<NeuralNet> base ;
+  while (genomes[j].depth > 0){
+    if (j != i){
+      base = Cached(j) ;
+      if (base)
+        break ;
+    }
+    seeds.push_back(genomes[j].seed) ;
+    j = genomes[j].parent ;
+  }
+  
+  NN = std::make_shared<NeuralNet>(numIn, numOut, numHidden) ;
+  if (base)
+    NN->SetWeights(base->GetWeightsA(), base->GetWeightsB()) ;
+  else
+    NN->SetWeights(genomes[j].weightsA, genomes[j].weightsB) ;
+  
+  // Replay mutations oldest first
+  for (size_t k = seeds.size(); k > 0; k--)
+    NN->MutateWeights(seeds[k-1]) ;
+  numReplays += seeds.size() ;
+  
+  Insert(i, NN) ;
+  return NN ;
+}
+
+std::shared_ptr<NeuralNet> GenomeStore::Cached(size_t i){
+  auto found = cacheIndex.find(i) ;
+  if (found == cacheIndex.end())
+    return std::shared_ptr<NeuralNet>() ;
+  cache.splice(cache.begin(), cache, found->second) ; // mark as most recent
+  return found->second->second ;
+}
+
+void GenomeStore::Insert(size_t i, const std::shared_ptr<NeuralNet> & NN){
+  cache.push_front(std::make_pair(i, NN)) ;
+  cacheIndex[i] = cache.begin() ;
+  while (cache.size() > cacheSize){
+    cacheIndex.erase(cache.back().first) ;
+    cache.pop_back() ;
+  }
+}
+
+void GenomeStore::Evict(size_t i){
+  auto found = cacheIndex.find(i) ;
+  if (found == cacheIndex.end())
+    return ;
+  cache.erase(found->second) ;
+  cacheIndex.erase(found) ;
+}
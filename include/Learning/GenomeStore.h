@@ -0,0 +1,75 @@
+#ifndef GENOME_STORE_H_
+#define GENOME_STORE_H_
+
+#include <list>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <Eigen/Eigen>
+#include "NeuralNet.h"
+
+using std::vector ;
+using namespace Eigen ;
+
+// Compressed storage for many NNs of the same shape. A genome is either a root
+// holding full weight matrices, or a reference to a parent genome plus the seed
+// of the mutation applied to it (see NeuralNet::MutateWeights(unsigned)). Weights
+// are rematerialised on demand by replaying the seed chain from the nearest root
+// or cached ancestor, and the most recently used NNs are kept in an LRU cache.
+//
+// Chains are never longer than maxDepth: a child that would exceed it is
+// materialised immediately and stored as a new root. Genomes are reference
+// counted; children hold a reference to their parent.
+class GenomeStore{
+  public:
+    GenomeStore(size_t, size_t, size_t, size_t, size_t) ; // nIn, nOut, nHidden, cacheSize, maxDepth
+    ~GenomeStore() ;
+    
+    size_t AddRoot(MatrixXd, MatrixXd) ; // new genome with reference count 1
+    size_t AddChild(size_t, unsigned) ; // parent id, mutation seed
+    void Retain(size_t) ;
+    void Release(size_t) ; // frees the genome when no references remain
+    
+    // Returns a NN holding the genome's weights. The cache shares ownership of
+    // the NN, so eviction by later calls only drops the cache's reference and
+    // the NN stays valid for as long as the caller holds it.
+    std::shared_ptr<NeuralNet> Materialise(size_t) ;
+    
+    size_t GetDepth(size_t i){return genomes[i].depth ;}
+    size_t GetMaxDepth(){return maxDepth ;}
+    size_t GetCacheSize(){return cacheSize ;}
+    size_t NumGenomes(){return genomes.size() - freeIds.size() ;}
+    size_t NumRoots(){return numRoots ;}
+    size_t NumCached(){return cache.size() ;}
+    size_t NumReplays(){return numReplays ;} // mutations replayed so far (for profiling)
+  private:
+    struct Genome{
+      size_t parent ;
+      unsigned seed ;
+      size_t depth ; // 0 for roots
+      size_t refs ;
+      MatrixXd weightsA ; // roots only
+      MatrixXd weightsB ;
+    } ;
+    
+    size_t numIn ;
+    size_t numOut ;
+    size_t numHidden ;
+    size_t cacheSize ;
+    size_t maxDepth ;
+    size_t numRoots ;
+    size_t numReplays ;
+    
+    vector<Genome> genomes ;
+    vector<size_t> freeIds ;
+    
+    // LRU cache: most recent at the front
+    std::list< std::pair<size_t, std::shared_ptr<NeuralNet> > > cache ;
+    std::unordered_map< size_t, std::list< std::pair<size_t, std::shared_ptr<NeuralNet> > >::iterator > cacheIndex ;
+    
+    size_t NewGenome() ;
+    void Evict(size_t) ;
+    std::shared_ptr<NeuralNet> Cached(size_t) ;
+    void Insert(size_t, const std::shared_ptr<NeuralNet> &) ;
+} ;
+#endif // GENOME_STORE_H_
@@ -1,10 +1,13 @@
+#include <algorithm>
+#include <cstring>
 #include "MAPElites.h"
+#include "MAPElitesArchive.h"
 
-// Constructor requires matrix of behaviour bin limits and size specifications of NN controllers. Initialises the vector storing the best performance evaluations and allocates memory on the heap to store the controllers.
-MAPElites::MAPElites(MatrixXd bins, size_t nIn, size_t nOut, size_t nHid): binLimits(bins){
+// Constructor requires matrix of behaviour bin limits and size specifications of NN controllers. Controllers are only allocated once their cell is visited.
+MAPElites::MAPElites(MatrixXd bins, size_t nIn, size_t nOut, size_t nHid): type(GRID), binLimits(bins), numIn(nIn), numOut(nOut), numHidden(nHid), numCandidates(0), eliteIndex(bins.rows()){
   bDim = bins.rows() ;
   numBins.setZero(bDim,1) ;
-  size_t totalBins = 1 ;
+  totalBins = 1 ;
   int k = 0 ;
   for (int i = 0; i < bDim; i++){
     double maxLim = binLimits(i,0) ;
@@ -12,7 +15,7 @@ MAPElites::MAPElites(MatrixXd bins, size_t nIn, size_t nOut, size_t nHid): binLi
     for (int j = 1; j < binLimits.cols(); j++){
       if (binLimits(i,j) < maxLim && !endFound){ // requires all valid bin limits to be increasing along the row
         endFound = true ;
-        totalBins += j ;
+        totalBins *= j ;
         numBins(k) = j ;
         k++ ;
         break ;
@@ -27,12 +30,6 @@ MAPElites::MAPElites(MatrixXd bins, size_t nIn, size_t nOut, size_t nHid): binLi
     }
   }
 
-  for (size_t i = 0; i < totalBins; i++){
-    behaviourFilled.push_back(false) ;
-    performanceLog.push_back(0.0) ;
-    behaviourMap.push_back(new NeuralNet(nIn,nOut,nHid)) ; // initialise behaviour map storage space
-  }
-  
   // Reverse cumulative product, used for computing 1D vector index from nD indices
   cProd.setOnes(bDim,1) ;
   for (int i = 1; i < bDim; i++){
@@ -43,11 +40,14 @@ MAPElites::MAPElites(MatrixXd bins, size_t nIn, size_t nOut, size_t nHid): binLi
   }
 }
 
+// Constructor for subclasses that compute cell indices themselves
+MAPElites::MAPElites(mapType t, MatrixXd limits, size_t numCells, size_t nIn, size_t nOut, size_t nHid): type(t), bDim(limits.rows()), binLimits(limits), totalBins(numCells), numIn(nIn), numOut(nOut), numHidden(nHid), numCandidates(0), eliteIndex(limits.rows()){}
+
 // Destructor releases all heap memory allocated to storing the NN controllers
 MAPElites::~MAPElites(){
-  for (size_t i = 0; i < behaviourMap.size(); i++){
-    delete(behaviourMap[i]) ;
-    behaviourMap[i] = 0 ;
+  for (size_t i = 0; i < filledNNs.size(); i++){
+    delete(filledNNs[i]) ;
+    filledNNs[i] = 0 ;
   }
 }
 
@@ -57,12 +57,23 @@ double MAPElites::GetPerformance(VectorXd behaviour){
     std::cout << "Error: input behaviour vector has the wrong number of elements!\n" ;
     return 0.0 ;
   }
-  return performanceLog[GetIndex(behaviour)] ;
+  return GetPerformance(GetIndex(behaviour)) ;
+}
+
+double MAPElites::GetPerformance(size_t ind){
+  auto found = cellSlots.find(ind) ;
+  if (found == cellSlots.end())
+    return 0.0 ;
+  return filledPerformance[found->second] ;
 }
 
 // Outputs boolean describing whether a behaviour has been visited before or not
 bool MAPElites::IsVisited(VectorXd behaviour){
-  return behaviourFilled[GetIndex(behaviour)] ;
+  return IsVisited(GetIndex(behaviour)) ;
+}
+
+bool MAPElites::IsVisited(size_t ind){
+  return cellSlots.count(ind) > 0 ;
 }
 
 // Outputs the NN controller associated with the best performance for an input behaviour vector 
@@ -71,31 +82,170 @@ NeuralNet * MAPElites::GetNeuralNet(VectorXd behaviour){
     std::cout << "Error: input behaviour vector has the wrong number of elements!\n" ;
     return 0 ;
   }
-  return behaviourMap[GetIndex(behaviour)] ;
+  return GetNeuralNet(GetIndex(behaviour)) ;
 }
 
 NeuralNet * MAPElites::GetNeuralNet(size_t ind){
-  if (ind > behaviourMap.size()){
+  if (ind >= totalBins){
     std::cout << "Error: behaviour map index out of bounds!\n" ;
     return 0 ;
   }
-  return behaviourMap[ind] ;
+  auto found = cellSlots.find(ind) ;
+  if (found == cellSlots.end())
+    return 0 ;
+  return filledNNs[found->second] ;
+}
+
+// Returns the cell index of a filled cell chosen uniformly at random
+size_t MAPElites::GetRandomFilledIndex(){
+  if (filledCells.empty()){
+    std::cout << "Error: behaviour map is empty!\n" ;
+    return 0 ;
+  }
+  std::uniform_int_distribution<size_t> pick(0, filledCells.size()-1) ;
+  return filledCells[pick(easymath::generator())] ;
+}
+
+// Cell index of the filled cell whose behaviour is closest to the input behaviour
+size_t MAPElites::GetNearestFilledIndex(VectorXd behaviour){
+  if (behaviour.size() != bDim){
+    std::cout << "Error: input behaviour vector has the wrong number of elements!\n" ;
+    return 0 ;
+  }
+  size_t id ;
+  double sqDist ;
+  if (!eliteIndex.Nearest(behaviour.data(), id, sqDist)){
+    std::cout << "Error: behaviour map is empty!\n" ;
+    return 0 ;
+  }
+  return pointCells[id] ;
+}
+
+vector<size_t> MAPElites::GetNearestFilledIndices(VectorXd behaviour, size_t k){
+  vector<size_t> cells ;
+  if (behaviour.size() != bDim){
+    std::cout << "Error: input behaviour vector has the wrong number of elements!\n" ;
+    return cells ;
+  }
+  vector<size_t> ids = eliteIndex.KNearest(behaviour.data(), k) ;
+  for (size_t i = 0; i < ids.size(); i++)
+    cells.push_back(pointCells[ids[i]]) ;
+  return cells ;
+}
+
+vector<size_t> MAPElites::GetFilledIndicesInRadius(VectorXd behaviour, double r){
+  vector<size_t> cells ;
+  if (behaviour.size() != bDim){
+    std::cout << "Error: input behaviour vector has the wrong number of elements!\n" ;
+    return cells ;
+  }
+  vector<size_t> ids = eliteIndex.Radius(behaviour.data(), r) ;
+  for (size_t i = 0; i < ids.size(); i++)
+    cells.push_back(pointCells[ids[i]]) ;
+  return cells ;
+}
+
+// Controller of the nearest filled cell, for use as a policy source at runtime
+NeuralNet * MAPElites::GetNearestNeuralNet(VectorXd behaviour){
+  if (filledCells.empty()){
+    std::cout << "Error: behaviour map is empty!\n" ;
+    return 0 ;
+  }
+  return GetNeuralNet(GetNearestFilledIndex(behaviour)) ;
+}
+
+// Dense performance log over all cells, unvisited cells are 0
+vector<double> MAPElites::GetPerformanceLog(){
+  vector<double> pLog(totalBins, 0.0) ;
+  for (size_t k = 0; k < filledCells.size(); k++)
+    pLog[filledCells[k]] = filledPerformance[k] ;
+  return pLog ;
+}
+
+// Dense visitation log over all cells
+vector<bool> MAPElites::GetFilledLog(){
+  vector<bool> fLog(totalBins, false) ;
+  for (size_t k = 0; k < filledCells.size(); k++)
+    fLog[filledCells[k]] = true ;
+  return fLog ;
 }
 
 // Considers the input NN given the corresponding behaviour vector and performance evaluation. If the stated performance is superior to the stored NN, it will replace the stored NN.  
 void MAPElites::UpdateMap(NeuralNet * NN, VectorXd bMap, double eval){
-  double pMap = GetPerformance(bMap) ;
-  if (eval > pMap || !IsVisited(bMap)){ // enter behaviour into map if better than previous or not visited before
-    MatrixXd A = NN->GetWeightsA() ;
-    MatrixXd B = NN->GetWeightsB() ;
-    
-    size_t n = GetIndex(bMap) ;
-    behaviourMap[n]->SetWeights(A,B) ;
-    performanceLog[n] = eval ;
-    
-    if (!IsVisited(bMap))
-      behaviourFilled[GetIndex(bMap)] = true ;
+  UpdateCell(GetIndex(bMap), NN, eval, ReserveRanks(1)) ;
+}
+
+size_t MAPElites::ReserveRanks(size_t n){
+  std::lock_guard<std::mutex> guard(archiveLock) ;
+  size_t first = numCandidates ;
+  numCandidates += n ;
+  return first ;
+}
+
+// Thread safe version of UpdateMap with an explicit rank for tie breaking
+void MAPElites::UpdateMapConcurrent(NeuralNet * NN, VectorXd bMap, double eval, size_t rank){
+  size_t n = GetIndex(bMap) ; // read only, done outside the lock
+  std::lock_guard<std::mutex> guard(archiveLock) ;
+  UpdateCell(n, NN, eval, rank) ;
+}
+
+// Enter behaviour into map if not visited before, or if better than the stored elite
+void MAPElites::UpdateCell(size_t n, NeuralNet * NN, double eval, size_t rank){
+  auto found = cellSlots.find(n) ;
+  if (found == cellSlots.end()){
+    InsertCell(n, new NeuralNet(*NN), eval, rank) ; // copy, so no random weights are drawn
+    return ;
+  }
+  size_t k = found->second ;
+  if (eval > filledPerformance[k] || (eval == filledPerformance[k] && rank < filledRank[k])){
+    filledNNs[k]->SetWeights(NN->GetWeightsA(), NN->GetWeightsB()) ;
+    filledPerformance[k] = eval ;
+    filledRank[k] = rank ;
+  }
+}
+
+// Store a controller for a newly visited cell, the map takes ownership of NN
+void MAPElites::InsertCell(size_t n, NeuralNet * NN, double eval, size_t rank){
+  cellSlots[n] = filledCells.size() ;
+  filledCells.push_back(n) ;
+  filledNNs.push_back(NN) ;
+  filledPerformance.push_back(eval) ;
+  filledRank.push_back(rank) ;
+  
+  VectorXd b = GetBehaviour(n) ;
+  filledPoint.push_back(eliteIndex.Insert(b.data())) ;
+  pointCells.push_back(n) ;
+}
+
+NeuralNet * MAPElites::NewNeuralNet(MatrixXd A, MatrixXd B){
+  NeuralNet * NN = new NeuralNet(numIn, numOut, numHidden) ;
+  NN->SetWeights(A, B) ;
+  return NN ;
+}
+
+// Release a cell, the last filled cell is moved into its slot
+void MAPElites::EraseCell(size_t n){
+  auto found = cellSlots.find(n) ;
+  if (found == cellSlots.end())
+    return ;
+  size_t k = found->second ;
+  size_t last = filledCells.size()-1 ;
+  delete(filledNNs[k]) ;
+  eliteIndex.Remove(filledPoint[k]) ;
+  if (k != last){
+    filledCells[k] = filledCells[last] ;
+    filledNNs[k] = filledNNs[last] ;
+    filledPerformance[k] = filledPerformance[last] ;
+    filledRank[k] = filledRank[last] ;
+    filledPoint[k] = filledPoint[last] ;
+    cellSlots[filledCells[k]] = k ;
   }
+  filledCells.pop_back() ;
+  filledNNs.pop_back() ;
+  filledPerformance.pop_back() ;
+  filledRank.pop_back() ;
+  filledPoint.pop_back() ;
+  cellSlots.erase(found) ;
 }
 
 // Returns the 1D index of an nD behaviour vector
@@ -144,31 +294,47 @@ VectorXd MAPElites::GetBehaviour(size_t n){
   return bMap ;
 }
 
+// The binary files below keep the dense layout of the original files (one
+// entry per cell, in cell order), and unvisited cells are written as zero
+// weights and zero performance. Performance and visitation files are unchanged
+// from before the sparse archive. Behaviour performance maps now start with
+// a tag and store each cell's weights in row-major order; the original writer
+// copied overlapping runs of the column-major storage and lost most weights,
+// so maps written by it cannot be recovered and are rejected.
+static const char bpMapTag[8] = {'M','E','B','P','M','A','P','2'} ;
+
 void MAPElites::WriteBPMapBinary(char * fName){
   // Filename to write behaviour performance map
 	std::stringstream fileName ;
   fileName << fName ;
   std::ofstream bpMapFile ;
   bpMapFile.open(fileName.str().c_str(),std::ios::out | std::ios::binary) ;
+  bpMapFile.write(bpMapTag, sizeof(bpMapTag)) ;
+  
+  MatrixXd zeroA = MatrixXd::Zero(numIn, numHidden) ;
+  MatrixXd zeroB = MatrixXd::Zero(numHidden+1, numOut) ;
   
   // Loop through all behaviours
-  for (size_t i = 0; i < behaviourMap.size(); i++){
-    MatrixXd NNA = behaviourMap[i]->GetWeightsA() ;
+  for (size_t i = 0; i < totalBins; i++){
+    NeuralNet * NN = GetNeuralNet(i) ;
+    MatrixXd NNA = NN ? NN->GetWeightsA() : zeroA ;
     for (int j = 0; j < NNA.rows(); j++){
-      char * pNNARow = reinterpret_cast<char *>(&NNA(j,0)) ;
-      size_t bytes = NNA.cols() * sizeof(NNA(j,0)) ;
-      bpMapFile.write(pNNARow, bytes) ;
+      for (int k = 0; k < NNA.cols(); k++)
+        bpMapFile.write(reinterpret_cast<char *>(&NNA(j,k)), sizeof(NNA(j,k))) ;
     }
     
-    MatrixXd NNB = behaviourMap[i]->GetWeightsB() ;
+    MatrixXd NNB = NN ? NN->GetWeightsB() : zeroB ;
     for (int j = 0; j < NNB.rows(); j++){
-      char * pNNBRow = reinterpret_cast<char *>(&NNB(j,0)) ;
-      size_t bytes = NNB.cols() * sizeof(NNB(j,0)) ;
-      bpMapFile.write(pNNBRow, bytes) ;
+      for (int k = 0; k < NNB.cols(); k++)
+        bpMapFile.write(reinterpret_cast<char *>(&NNB(j,k)), sizeof(NNB(j,k))) ;
     }
   }
 }
 
+// Reads a dense behaviour performance map. Cells with all zero weights are
+// treated as unvisited and skipped; any other cell is stored until
+// ReadVisitedBinary removes the ones that were not visited. Maps without the
+// tag (written by the original dense implementation) leave the map unchanged.
 void MAPElites::ReadBPMapBinary(char * fName){
   // Filename to read behaviour performance map
 	std::stringstream fileName ;
@@ -176,23 +342,38 @@ void MAPElites::ReadBPMapBinary(char * fName){
   std::ifstream bpMapFile ;
   bpMapFile.open(fileName.str().c_str(),std::ios::in | std::ios::binary) ;
   
+  char tag[sizeof(bpMapTag)] ;
+  bpMapFile.read(tag, sizeof(tag)) ;
+  if (!bpMapFile || !std::equal(tag, tag+sizeof(tag), bpMapTag)){
+    std::cout << "Error: " << fName << " is not a tagged behaviour performance map (maps from the original dense format cannot be read)!\n" ;
+    return ;
+  }
+  
   // Loop through all behaviours
-  for (size_t i = 0; i < behaviourMap.size(); i++){
-    MatrixXd NNA = behaviourMap[i]->GetWeightsA() ;
+  for (size_t i = 0; i < totalBins; i++){
+    MatrixXd NNA(numIn, numHidden) ;
     for (int j = 0; j < NNA.rows(); j++){
-      char * pNNARow = reinterpret_cast<char *>(&NNA(j,0)) ;
-      size_t bytes = NNA.cols() * sizeof(NNA(j,0)) ;
-      bpMapFile.read(pNNARow, bytes) ;
+      for (int k = 0; k < NNA.cols(); k++)
+        bpMapFile.read(reinterpret_cast<char *>(&NNA(j,k)), sizeof(NNA(j,k))) ;
     }
     
-    MatrixXd NNB = behaviourMap[i]->GetWeightsB() ;
+    MatrixXd NNB(numHidden+1, numOut) ;
     for (int j = 0; j < NNB.rows(); j++){
-      char * pNNBRow = reinterpret_cast<char *>(&NNB(j,0)) ;
-      size_t bytes = NNB.cols() * sizeof(NNB(j,0)) ;
-      bpMapFile.read(pNNBRow, bytes) ;
+      for (int k = 0; k < NNB.cols(); k++)
+        bpMapFile.read(reinterpret_cast<char *>(&NNB(j,k)), sizeof(NNB(j,k))) ;
+    }
+    
+    if (!bpMapFile){
+      std::cout << "Error: behaviour performance map file is too short!\n" ;
+      return ;
     }
     
-    behaviourMap[i]->SetWeights(NNA, NNB) ;
+    if (NNA.isZero(0.0) && NNB.isZero(0.0))
+      EraseCell(i) ;
+    else if (IsVisited(i))
+      filledNNs[cellSlots[i]]->SetWeights(NNA, NNB) ;
+    else
+      InsertCell(i, NewNeuralNet(NNA, NNB), 0.0) ;
   }
 }
 
@@ -204,9 +385,10 @@ void MAPElites::WritePerformanceBinary(char * fName){
   performanceFile.open(fileName.str().c_str(),std::ios::out | std::ios::binary) ;
   
   // Write all logged performance values
-  char * pPLog = reinterpret_cast<char *>(&performanceLog[0]) ;
-  size_t bytes = performanceLog.size() * sizeof(performanceLog[0]) ;
-  performanceFile.write(pPLog, bytes) ;
+  for (size_t i = 0; i < totalBins; i++){
+    double p = GetPerformance(i) ;
+    performanceFile.write(reinterpret_cast<char *>(&p), sizeof(p)) ;
+  }
 }
 
 void MAPElites::ReadPerformanceBinary(char * fName){
@@ -216,13 +398,17 @@ void MAPElites::ReadPerformanceBinary(char * fName){
   std::ifstream performanceFile ;
   performanceFile.open(fileName.str().c_str(),std::ios::in | std::ios::binary) ;
   
-  // Read all logged performance values
-  vector<double> pLog = performanceLog ;
-  char * pPLog = reinterpret_cast<char *>(&pLog[0]) ;
-  size_t bytes = pLog.size() * sizeof(pLog[0]) ;
-  performanceFile.read(pPLog, bytes) ;
-  
-  performanceLog = pLog ;
+  // Read all logged performance values, only stored cells keep theirs
+  for (size_t i = 0; i < totalBins; i++){
+    double p ;
+    if (!performanceFile.read(reinterpret_cast<char *>(&p), sizeof(p))){
+      std::cout << "Error: performance file is too short!\n" ;
+      return ;
+    }
+    auto found = cellSlots.find(i) ;
+    if (found != cellSlots.end())
+      filledPerformance[found->second] = p ;
+  }
 }
 
 void MAPElites::WriteVisitedBinary(char * fName){
@@ -232,20 +418,14 @@ void MAPElites::WriteVisitedBinary(char * fName){
   std::ofstream visitedFile ;
   visitedFile.open(fileName.str().c_str(),std::ios::out | std::ios::binary) ;
   
-  vector<size_t> bFilled ;
-  for (size_t i = 0; i < behaviourFilled.size(); i++){
-    if (behaviourFilled[i])
-      bFilled.push_back(1) ;
-    else
-      bFilled.push_back(0) ;
-  }
-  
   // Write all logged visitation values
-  char * pFLog = reinterpret_cast<char *>(&bFilled[0]) ;
-  size_t bytes = bFilled.size() * sizeof(bFilled[0]) ;
-  visitedFile.write(pFLog, bytes) ;
+  for (size_t i = 0; i < totalBins; i++){
+    size_t f = IsVisited(i) ? 1 : 0 ;
+    visitedFile.write(reinterpret_cast<char *>(&f), sizeof(f)) ;
+  }
 }
 
+// Reads the visitation log, cells that were not visited are released
 void MAPElites::ReadVisitedBinary(char * fName){
   // Filename to read visitation log
 	std::stringstream fileName ;
@@ -253,18 +433,108 @@ void MAPElites::ReadVisitedBinary(char * fName){
   std::ifstream visitedFile ;
   visitedFile.open(fileName.str().c_str(),std::ios::in | std::ios::binary) ;
   
-  vector<size_t> bFilled(behaviourFilled.size()) ;
+  for (size_t i = 0; i < totalBins; i++){
+    size_t f ;
+    if (!visitedFile.read(reinterpret_cast<char *>(&f), sizeof(f))){
+      std::cout << "Error: visitation file is too short!\n" ;
+      return ;
+    }
+    if (f != 1)
+      EraseCell(i) ;
+    else if (!IsVisited(i)) // visited with all zero weights
+      InsertCell(i, NewNeuralNet(MatrixXd::Zero(numIn, numHidden), MatrixXd::Zero(numHidden+1, numOut)), 0.0) ;
+  }
+}
+
+// Write header, bin limits, filled bitset, sorted cell indices, performances and packed weights
+bool MAPElites::WriteArchive(const char * fName){
+  vector<size_t> order(filledCells.size()) ;
+  for (size_t k = 0; k < order.size(); k++)
+    order[k] = k ;
+  vector<size_t> & cells = filledCells ;
+  std::sort(order.begin(), order.end(), [&cells](size_t a, size_t b){return cells[a] < cells[b] ;}) ;
   
-  // Read all logged visitation values
-  char * pFLog = reinterpret_cast<char *>(&bFilled[0]) ;
-  size_t bytes = bFilled.size() * sizeof(bFilled[0]) ;
-  visitedFile.read(pFLog, bytes) ;
+  MAPElitesArchiveHeader header ;
+  std::memset(&header, 0, sizeof(header)) ;
+  std::memcpy(header.magic, "MAPEARCH", 8) ;
+  header.version = MAP_ELITES_ARCHIVE_VERSION ;
+  header.bDim = bDim ;
+  header.kind = type ;
+  header.binCols = binLimits.cols() ;
+  header.numIn = numIn ;
+  header.numOut = numOut ;
+  header.numHidden = numHidden ;
+  header.numCells = totalBins ;
+  header.numFilled = filledCells.size() ;
+  size_t weightsPerNN = numIn*numHidden + (numHidden+1)*numOut ;
+  size_t numWords = (totalBins+63)/64 ;
+  header.limitsOffset = sizeof(header) ;
+  header.filledOffset = header.limitsOffset + binLimits.size()*sizeof(double) ;
+  header.cellsOffset = header.filledOffset + numWords*sizeof(unsigned long long) ;
+  header.performanceOffset = header.cellsOffset + header.numFilled*sizeof(unsigned long long) ;
+  header.weightsOffset = header.performanceOffset + header.numFilled*sizeof(double) ;
+  header.fileSize = header.weightsOffset + header.numFilled*weightsPerNN*sizeof(double) ;
   
+  std::ofstream archiveFile(fName, std::ios::out | std::ios::binary | std::ios::trunc) ;
+  easyio::write_binary(archiveFile, header) ;
+  archiveFile.write(reinterpret_cast<const char *>(binLimits.data()), binLimits.size()*sizeof(double)) ;
   
-  for (size_t i = 0; i < behaviourFilled.size(); i++){
-    if (bFilled[i] == 1)
-      behaviourFilled[i] = true ;
-    else
-      behaviourFilled[i] = false ;
+  vector<unsigned long long> words(numWords, 0) ;
+  for (size_t k = 0; k < filledCells.size(); k++)
+    words[filledCells[k]/64] |= 1ULL << (filledCells[k]%64) ;
+  if (numWords > 0)
+    archiveFile.write(reinterpret_cast<const char *>(&words[0]), numWords*sizeof(unsigned long long)) ;
+  
+  for (size_t k = 0; k < order.size(); k++)
+    easyio::write_binary(archiveFile, static_cast<unsigned long long>(filledCells[order[k]])) ;
+  for (size_t k = 0; k < order.size(); k++)
+    easyio::write_binary(archiveFile, filledPerformance[order[k]]) ;
+  for (size_t k = 0; k < order.size(); k++){
+    MatrixXd A = filledNNs[order[k]]->GetWeightsA() ;
+    MatrixXd B = filledNNs[order[k]]->GetWeightsB() ;
+    archiveFile.write(reinterpret_cast<const char *>(A.data()), A.size()*sizeof(double)) ;
+    archiveFile.write(reinterpret_cast<const char *>(B.data()), B.size()*sizeof(double)) ;
+  }
+  
+  archiveFile.close() ;
+  if (archiveFile.fail()){
+    std::cout << "Error: unable to write archive " << fName << "!\n" ;
+    return false ;
   }
+  return true ;
+}
+
+// Load every filled cell of an archive written by WriteArchive
+bool MAPElites::ReadArchive(const char * fName){
+  MAPElitesArchive archive ;
+  if (!archive.Open(fName))
+    return false ;
+  const MAPElitesArchiveHeader & header = archive.GetHeader() ;
+  if (header.kind != (unsigned int)type || header.numIn != numIn || header.numOut != numOut || header.numHidden != numHidden ||
+      header.numCells != totalBins || header.bDim != (unsigned int)bDim ||
+      header.binCols != (unsigned long long)binLimits.cols() || archive.GetBinLimits() != binLimits){
+    std::cout << "Error: archive " << fName << " does not match the behaviour map!\n" ;
+    return false ;
+  }
+  
+  ClearMap() ;
+  for (size_t k = 0; k < archive.GetNumFilled(); k++){
+    size_t n = archive.GetFilledIndex(k) ;
+    InsertCell(n, NewNeuralNet(archive.GetWeightsA(n), archive.GetWeightsB(n)), archive.GetPerformance(n)) ;
+  }
+  return true ;
+}
+
+// Release every stored controller
+void MAPElites::ClearMap(){
+  for (size_t k = 0; k < filledNNs.size(); k++)
+    delete(filledNNs[k]) ;
+  cellSlots.clear() ;
+  filledCells.clear() ;
+  filledNNs.clear() ;
+  filledPerformance.clear() ;
+  filledRank.clear() ;
+  filledPoint.clear() ;
+  pointCells.clear() ;
+  eliteIndex.Clear() ;
 }
@@ -5,30 +5,74 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <unordered_map>
+#include <mutex>
 #include <float.h>
 #include <math.h>
 #include <Eigen/Eigen>
 #include "Learning/NeuralNet.h"
+#include "Utilities/KdTree.h"
 
 using std::vector ;
 
+enum mapType {GRID, CVT} ; // cells from a grid of bin limits, or a centroidal Voronoi tessellation (see CVTMAPElites)
+
+// Behaviour-performance map. Only occupied cells are stored: a hash map takes
+// a 1D cell index to a slot in dense vectors of filled cells, controllers and
+// performances, so memory grows with the number of filled cells rather than
+// with the size of the behaviour grid.
 class MAPElites{
   public:
     MAPElites(MatrixXd, size_t, size_t, size_t) ;
-    ~MAPElites() ;
+    virtual ~MAPElites() ;
     
-    double GetPerformance(VectorXd) ;
+    double GetPerformance(VectorXd) ; // 0 for cells that have not been visited
+    double GetPerformance(size_t) ;
     bool IsVisited(VectorXd) ;
-    NeuralNet * GetNeuralNet(VectorXd) ;
+    bool IsVisited(size_t) ;
+    NeuralNet * GetNeuralNet(VectorXd) ; // null for cells that have not been visited
     NeuralNet * GetNeuralNet(size_t) ;
     void UpdateMap(NeuralNet *, VectorXd, double) ;
     
-    size_t GetIndex(VectorXd) ;
-    VectorXd GetBehaviour(size_t) ;
+    // Batched updates: every candidate gets a rank from ReserveRanks, and a
+    // candidate replaces an elite if it performs strictly better, or equally
+    // well with a lower rank. The archive therefore ends up the same whatever
+    // order the candidates of a batch arrive in. UpdateMapConcurrent may be
+    // called from several threads at once.
+    size_t ReserveRanks(size_t) ; // returns the first of n consecutive ranks
+    void UpdateMapConcurrent(NeuralNet *, VectorXd, double, size_t) ;
+    
+    virtual size_t GetIndex(VectorXd) ;
+    virtual VectorXd GetBehaviour(size_t) ;
+    mapType GetMapType(){return type ;}
     
     size_t GetBDim(){return bDim ;}
-    vector<double> GetPerformanceLog(){return performanceLog ;}
-    vector<bool> GetFilledLog(){return behaviourFilled ;}
+    size_t GetNumCells(){return totalBins ;}
+    size_t GetNumFilled(){return filledCells.size() ;}
+    size_t GetFilledIndex(size_t k){return filledCells[k] ;} // cell index of the k-th filled cell
+    size_t GetRandomFilledIndex() ; // uniform over filled cells
+    
+    // Nearest elite queries. The behaviours of the filled cells (bin values
+    // or centroids, as returned by GetBehaviour) are indexed in a kd-tree that
+    // grows as cells are filled, so queries are logarithmic in the number of
+    // filled cells and always land on a stored controller, including for
+    // behaviours outside the map limits. Queries must not run concurrently
+    // with UpdateMapConcurrent.
+    size_t GetNearestFilledIndex(VectorXd) ; // cell index, 0 with an error if the map is empty
+    vector<size_t> GetNearestFilledIndices(VectorXd, size_t) ; // k nearest cell indices, closest first
+    vector<size_t> GetFilledIndicesInRadius(VectorXd, double) ; // cell indices within a euclidean radius
+    NeuralNet * GetNearestNeuralNet(VectorXd) ; // null only if the map is empty
+    
+    // Dense logs over every cell (legacy, allocates GetNumCells() entries)
+    vector<double> GetPerformanceLog() ;
+    vector<bool> GetFilledLog() ;
+    
+    // Single file archive (see MAPElitesArchive.h). Reading replaces the
+    // current contents and requires the same bins and controller sizes.
+    bool WriteArchive(const char *) ;
+    bool ReadArchive(const char *) ;
+    void ClearMap() ;
+    MatrixXd GetBinLimits(){return binLimits ;}
     
     void WriteBPMapBinary(char *) ;
     void ReadBPMapBinary(char *) ;
@@ -38,13 +82,36 @@ class MAPElites{
     
     void WriteVisitedBinary(char *) ;
     void ReadVisitedBinary(char *) ;
-  private:
+  protected:
+    MAPElites(mapType, MatrixXd, size_t, size_t, size_t, size_t) ; // type, cell limits, number of cells, nIn, nOut, nHid
+    
+    mapType type ;
     int bDim ;
+    MatrixXd binLimits ; // for CVT maps, one centroid per column
+    size_t totalBins ;
+  private:
     VectorXi numBins ;
-    MatrixXd binLimits ;
     VectorXi cProd ;
-    vector<NeuralNet *> behaviourMap ;
-    vector<double> performanceLog ;
-    vector<bool> behaviourFilled ;
+    
+    // NN controller sizes
+    size_t numIn ;
+    size_t numOut ;
+    size_t numHidden ;
+    
+    std::unordered_map<size_t, size_t> cellSlots ; // cell index -> slot in the vectors below
+    vector<size_t> filledCells ;
+    vector<NeuralNet *> filledNNs ;
+    vector<double> filledPerformance ;
+    vector<size_t> filledRank ; // rank of the candidate that set each elite
+    vector<size_t> filledPoint ; // id of each filled cell's behaviour in eliteIndex
+    vector<size_t> pointCells ; // eliteIndex point id -> cell index
+    KdTree eliteIndex ;
+    size_t numCandidates ;
+    std::mutex archiveLock ;
+    
+    void UpdateCell(size_t, NeuralNet *, double, size_t) ;
+    void InsertCell(size_t, NeuralNet *, double, size_t rank = 0) ;
+    NeuralNet * NewNeuralNet(MatrixXd, MatrixXd) ;
+    void EraseCell(size_t) ;
 } ;
 #endif // MAP_ELITE_H_
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "MAPElitesArchive.h"
+#include "MAPElites.h"
+#include "CVTMAPElites.h"
+#include "Utilities/BinaryIO.h"
+
+MAPElitesArchive::MAPElitesArchive(): fd(-1), data(0), size(0), header(0), filled(0), cells(0), performance(0), weights(0), grid(0){}
+
+MAPElitesArchive::~MAPElitesArchive(){
+  Close() ;
+}
+
+// Map the file and check that its sections are consistent with the header
+bool MAPElitesArchive::Open(const char * fName){
+  Close() ;
+  fd = open(fName, O_RDONLY) ;
+  if (fd < 0){
+    std::cout << "Error: unable to open archive " << fName << "!\n" ;
+    return false ;
+  }
+  struct stat st ;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MAPElitesArchiveHeader)){
+    std::cout << "Error: " << fName << " is not a MAP-Elites archive!\n" ;
+    Close() ;
+    return false ;
+  }
+  size = st.st_size ;
+  void * p = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0) ;
+  if (p == MAP_FAILED){
+    std::cout << "Error: unable to map archive " << fName << "!\n" ;
+    data = 0 ;
+    Close() ;
+    return false ;
+  }
+  data = static_cast<const char *>(p) ;
+  header = reinterpret_cast<const MAPElitesArchiveHeader *>(data) ;
+  
+  const MAPElitesArchiveHeader & h = *header ;
+  unsigned long long limitCount, inputWeights, outputWeights, weightsPerNN, weightCount ;
+  bool valid = std::memcmp(h.magic, "MAPEARCH", 8) == 0 &&
+    h.version == MAP_ELITES_ARCHIVE_VERSION &&
+    (h.kind == GRID || h.kind == CVT) &&
+    h.fileSize == size &&
+    h.bDim > 0 && h.numFilled <= h.numCells &&
+    h.limitsOffset >= sizeof(MAPElitesArchiveHeader) &&
+    easyio::checked_multiply(h.bDim, h.binCols, limitCount) &&
+    easyio::checked_multiply(h.numIn, h.numHidden, inputWeights) &&
+    h.numHidden < ~0ULL && easyio::checked_multiply(h.numHidden+1, h.numOut, outputWeights) &&
+    easyio::checked_add(inputWeights, outputWeights, weightsPerNN) &&
+    easyio::checked_multiply(h.numFilled, weightsPerNN, weightCount) &&
+    easyio::section_fits(h.limitsOffset, limitCount, sizeof(double), h.filledOffset) &&
+    easyio::section_fits(h.filledOffset, h.numCells/64 + (h.numCells%64 != 0), sizeof(unsigned long long), h.cellsOffset) &&
+    easyio::section_fits(h.cellsOffset, h.numFilled, sizeof(unsigned long long), h.performanceOffset) &&
+    easyio::section_fits(h.performanceOffset, h.numFilled, sizeof(double), h.weightsOffset) &&
+    easyio::section_fits(h.weightsOffset, weightCount, sizeof(double), size) ;
+  if (valid){
+    // Filled cells must be increasing and inside the map
+    const unsigned long long * c = reinterpret_cast<const unsigned long long *>(data + h.cellsOffset) ;
+    for (unsigned long long k = 0; k < h.numFilled && valid; k++)
+      valid = c[k] < h.numCells && (k == 0 || c[k-1] < c[k]) ;
+  }
+  if (!valid){
+    std::cout << "Error: " << fName << " is not a valid MAP-Elites archive!\n" ;
+    Close() ;
+    return false ;
+  }
+  
+  filled = reinterpret_cast<const unsigned long long *>(data + header->filledOffset) ;
+  cells = reinterpret_cast<const unsigned long long *>(data + header->cellsOffset) ;
+  performance = reinterpret_cast<const double *>(data + header->performanceOffset) ;
+  weights = reinterpret_cast<const double *>(data + header->weightsOffset) ;
+  if (header->kind == CVT)
+    grid = new CVTMAPElites(GetBinLimits(), header->numIn, header->numOut, header->numHidden) ;
+  else
+    grid = new MAPElites(GetBinLimits(), header->numIn, header->numOut, header->numHidden) ;
+  if (grid->GetNumCells() != header->numCells){
+    std::cout << "Error: " << fName << " does not match its bin limits!\n" ;
+    Close() ;
+    return false ;
+  }
+  return true ;
+}
+
+void MAPElitesArchive::Close(){
+  if (data)
+    munmap(const_cast<char *>(data), size) ;
+  if (fd >= 0)
+    close(fd) ;
+  delete(grid) ;
+  fd = -1 ;
+  data = 0 ;
+  size = 0 ;
+  header = 0 ;
+  filled = 0 ;
+  cells = 0 ;
+  performance = 0 ;
+  weights = 0 ;
+  grid = 0 ;
+}
+
+MatrixXd MAPElitesArchive::GetBinLimits(){
+  Map<const MatrixXd> limits(reinterpret_cast<const double *>(data + header->limitsOffset), header->bDim, header->binCols) ;
+  return limits ;
+}
+
+size_t MAPElitesArchive::GetIndex(VectorXd behaviour){
+  return grid->GetIndex(behaviour) ;
+}
+
+VectorXd MAPElitesArchive::GetBehaviour(size_t n){
+  return grid->GetBehaviour(n) ;
+}
+
+bool MAPElitesArchive::IsVisited(size_t n){
+  if (n >= header->numCells)
+    return false ;
+  return (filled[n/64] >> (n%64)) & 1ULL ;
+}
+
+long MAPElitesArchive::FindSlot(size_t n){
+  if (!IsVisited(n))
+    return -1 ;
+  const unsigned long long * end = cells + header->numFilled ;
+  const unsigned long long * found = std::lower_bound(cells, end, (unsigned long long)n) ;
+  if (found == end || *found != n)
+    return -1 ;
+  return found - cells ;
+}
+
+double MAPElitesArchive::GetPerformance(size_t n){
+  long k = FindSlot(n) ;
+  return (k < 0) ? 0.0 : performance[k] ;
+}
+
+const double * MAPElitesArchive::WeightsBlock(size_t k){
+  size_t weightsPerNN = header->numIn*header->numHidden + (header->numHidden+1)*header->numOut ;
+  return weights + k*weightsPerNN ;
+}
+
+// The caller must check IsVisited first, unvisited cells give an empty map
+Map<const MatrixXd> MAPElitesArchive::GetWeightsA(size_t n){
+  long k = FindSlot(n) ;
+  if (k < 0)
+    return Map<const MatrixXd>(weights, 0, 0) ;
+  return Map<const MatrixXd>(WeightsBlock(k), header->numIn, header->numHidden) ;
+}
+
+Map<const MatrixXd> MAPElitesArchive::GetWeightsB(size_t n){
+  long k = FindSlot(n) ;
+  if (k < 0)
+    return Map<const MatrixXd>(weights, 0, 0) ;
+  return Map<const MatrixXd>(WeightsBlock(k) + header->numIn*header->numHidden, header->numHidden+1, header->numOut) ;
+}
+
+bool MAPElitesArchive::GetNeuralNet(size_t n, NeuralNet * NN){
+  long k = FindSlot(n) ;
+  if (k < 0)
+    return false ;
+  NN->SetWeights(GetWeightsA(n), GetWeightsB(n)) ;
+  NN->SetEvaluation(performance[k]) ;
+  return true ;
+}
@@ -0,0 +1,92 @@
+#ifndef MAP_ELITES_ARCHIVE_H_
+#define MAP_ELITES_ARCHIVE_H_
+
+#include <string>
+#include <Eigen/Eigen>
+#include "Learning/NeuralNet.h"
+
+using namespace Eigen ;
+
+class MAPElites ;
+
+// Single file MAP-Elites archive, written by MAPElites::WriteArchive. All
+// sections start on 8 byte boundaries so the file can be mapped into memory and
+// used in place:
+//   header                 MAPElitesArchiveHeader
+//   bin limits             bDim x binCols doubles, column-major (centroids for CVT maps)
+//   filled bitset          (numCells+63)/64 uint64 words, bit i of word i/64
+//   filled cell indices    numFilled uint64, increasing
+//   performance            numFilled doubles, same order as the cell indices
+//   weights                numFilled blocks of A then B, column-major doubles
+struct MAPElitesArchiveHeader{
+  char magic[8] ; // "MAPEARCH"
+  unsigned int version ;
+  unsigned int bDim ;
+  unsigned int kind ; // mapType of the map that wrote the archive
+  unsigned int reserved ;
+  unsigned long long binCols ;
+  unsigned long long numIn ;
+  unsigned long long numOut ;
+  unsigned long long numHidden ;
+  unsigned long long numCells ;
+  unsigned long long numFilled ;
+  unsigned long long limitsOffset ;
+  unsigned long long filledOffset ;
+  unsigned long long cellsOffset ;
+  unsigned long long performanceOffset ;
+  unsigned long long weightsOffset ;
+  unsigned long long fileSize ;
+} ;
+
+// Version 2 added kind and reserved to the header
+const unsigned int MAP_ELITES_ARCHIVE_VERSION = 2 ;
+
+// Read only view of an archive file mapped into memory. Opening checks the
+// header, reads every filled cell index to check they are increasing and in
+// range, and builds the map the archive was written from to index behaviours,
+// which for a CVT map means a kd-tree over all of its centroids. Performance
+// and weights are not read; cells are looked up by binary search over the
+// filled cell indices and their weights are paged in on first access.
+class MAPElitesArchive{
+  public:
+    MAPElitesArchive() ;
+    ~MAPElitesArchive() ;
+    
+    bool Open(const char *) ; // false if the file is missing or malformed
+    void Close() ;
+    bool IsOpen(){return data != 0 ;}
+    
+    const MAPElitesArchiveHeader & GetHeader(){return *header ;}
+    size_t GetNumCells(){return header->numCells ;}
+    size_t GetNumFilled(){return header->numFilled ;}
+    size_t GetBDim(){return header->bDim ;}
+    MatrixXd GetBinLimits() ;
+    
+    size_t GetIndex(VectorXd) ; // cell index of a behaviour vector
+    VectorXd GetBehaviour(size_t) ;
+    
+    bool IsVisited(size_t) ;
+    double GetPerformance(size_t) ; // 0 for unvisited cells
+    size_t GetFilledIndex(size_t k){return cells[k] ;} // cell index of the k-th filled cell, in increasing order
+    
+    // Weights of a visited cell, mapped directly onto the file
+    Map<const MatrixXd> GetWeightsA(size_t) ;
+    Map<const MatrixXd> GetWeightsB(size_t) ;
+    
+    // Copy the controller of a visited cell into NN, false if the cell is unvisited
+    bool GetNeuralNet(size_t, NeuralNet *) ;
+  private:
+    int fd ;
+    const char * data ;
+    size_t size ;
+    const MAPElitesArchiveHeader * header ;
+    const unsigned long long * filled ;
+    const unsigned long long * cells ;
+    const double * performance ;
+    const double * weights ;
+    MAPElites * grid ; // empty map with the archive's bins, used for cell index computations
+    
+    long FindSlot(size_t) ; // position of a cell in the filled list, -1 if unvisited
+    const double * WeightsBlock(size_t) ;
+} ;
+#endif // MAP_ELITES_ARCHIVE_H_
@@ -45,6 +45,28 @@ VectorXd NeuralNet::EvaluateNN(VectorXd inputs) const{
   return outputs ;
 }
 
+// Evaluate NN outputs for a batch of inputs stored as columns, as matrix products over the whole batch
+MatrixXd NeuralNet::EvaluateNNBatch(const MatrixXd & inputs) const{
+  bool logistic = (ActivationFunction == &NeuralNet::LogisticFunction) ;
+  
+  MatrixXd hidden(nH+1, inputs.cols()) ;
+  hidden.topRows(nH) = weightsA.transpose()*inputs ;
+  if (logistic)
+    hidden.topRows(nH) = (1.0 + (-hidden.topRows(nH).array()).exp()).inverse().matrix() ;
+  else
+    hidden.topRows(nH) = hidden.topRows(nH).array().tanh().matrix() ;
+  hidden.row(nH).setConstant(bias) ;
+  
+  MatrixXd outputs = weightsB.transpose()*hidden ;
+  if (layerActivation[1] == 1){ // bounded output
+    if (logistic)
+      outputs = (1.0 + (-outputs.array()).exp()).inverse().matrix() ;
+    else
+      outputs = outputs.array().tanh().matrix() ;
+  }
+  return outputs ;
+}
+
 // Evaluate NN output given input vector
 VectorXd NeuralNet::EvaluateNN(VectorXd inputs, VectorXd & hiddenLayer){
   hiddenLayer = (this->*ActivationFunction)(inputs, 0) ;
@@ -65,6 +87,22 @@ void NeuralNet::MutateWeights(){
       weightsB(i,j) += RandomMutation(fan_in) ;
 }
 
+// Mutate the weights using a private engine seeded with s, so that the same seed always applies the same mutation (used to replay seed-chain genomes)
+void NeuralNet::MutateWeights(unsigned s){
+  std::mt19937 engine(s) ;
+  std::uniform_real_distribution<double> coin(0.0, 1.0) ;
+  std::normal_distribution<double> noise(0.0, mutationStd) ;
+  for (int i = 0; i < weightsA.rows(); i++)
+    for (int j = 0; j < weightsA.cols(); j++)
+      if (coin(engine) <= mutationRate)
+        weightsA(i,j) += noise(engine) ;
+  
+  for (int i = 0; i < weightsB.rows(); i++)
+    for (int j = 0; j < weightsB.cols(); j++)
+      if (coin(engine) <= mutationRate)
+        weightsB(i,j) += noise(engine) ;
+}
+
 // Migrated from rebhuhnc/libraries/SingleAgent/NeuralNet/NeuralNet.cpp
 double NeuralNet::RandomMutation(double fan_in) {
   // Adds random amount mutationRate% of the time,
@@ -73,10 +111,8 @@ double NeuralNet::RandomMutation(double fan_in) {
     return 0.0;
   else {
     // FOR MUTATION
-    std::default_random_engine generator;
-    generator.seed(static_cast<size_t>(time(NULL)));
     std::normal_distribution<double> distribution(0.0, mutationStd);
-    return distribution(generator);
+    return distribution(easymath::generator());
   }
 }
 
@@ -313,3 +349,24 @@ vector<NeuralNet*> NeuralNet::loadNNFromFile(std::string filename, size_t numIn,
 
   return loadedNN;
 }
+
+void NeuralNet::WriteBinary(std::ostream & out){
+  easyio::write_matrix(out, weightsA) ;
+  easyio::write_matrix(out, weightsB) ;
+  easyio::write_binary(out, evaluation) ;
+}
+
+bool NeuralNet::ReadBinary(std::istream & in){
+  MatrixXd A, B ;
+  double eval ;
+  if (!easyio::read_matrix(in, A) || !easyio::read_matrix(in, B) || !easyio::read_binary(in, eval))
+    return false ;
+  if (A.rows() != weightsA.rows() || A.cols() != weightsA.cols() ||
+      B.rows() != weightsB.rows() || B.cols() != weightsB.cols()){
+    std::cout << "Error: stored NN does not match the network layer sizes!\n" ;
+    return false ;
+  }
+  SetWeights(A, B) ;
+  evaluation = eval ;
+  return true ;
+}
@@ -18,6 +18,7 @@ enum nnOut {BOUNDED, UNBOUNDED} ; // bounded output will apply activation functi
 #include <string>
 
 #include "Utilities/Utilities.h"
+#include "Utilities/BinaryIO.h"
 
 using namespace Eigen ;
 using easymath::rand_interval ;
@@ -31,7 +32,9 @@ class NeuralNet{
     
     VectorXd EvaluateNN(VectorXd inputs) const;
     VectorXd EvaluateNN(VectorXd inputs, VectorXd & hiddenLayer) ;
+    MatrixXd EvaluateNNBatch(const MatrixXd & inputs) const ; // one input per column, one output per column
     void MutateWeights() ;
+    void MutateWeights(unsigned) ; // reproducible mutation drawn from the given seed
     void SetWeights(MatrixXd, MatrixXd) ;
     MatrixXd GetWeightsA() {return weightsA ;}
     MatrixXd GetWeightsB() {return weightsB ;}
@@ -45,6 +48,9 @@ class NeuralNet{
 
     static vector<NeuralNet*> loadNNFromFile(string, size_t, size_t, size_t);
     
+    void WriteBinary(std::ostream &) ; // weights and evaluation
+    bool ReadBinary(std::istream &) ; // requires matching layer sizes
+    
   private:
     double bias ;
     MatrixXd weightsA ;
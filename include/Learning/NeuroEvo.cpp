@@ -1,8 +1,9 @@
 #include <iostream>
 #include "NeuroEvo.h"
+#include "Utilities/PhaseTimer.h"
 
 // Constructor: Initialises all NN in population, given NN layer sizes and population size, also sets SurvivalFunction
-NeuroEvo::NeuroEvo(size_t nIn, size_t nOut, size_t nHidden, size_t pSize): numIn(nIn), numOut(nOut), numHidden(nHidden), populationSize(pSize) {
+NeuroEvo::NeuroEvo(size_t nIn, size_t nOut, size_t nHidden, size_t pSize): numIn(nIn), numOut(nOut), numHidden(nHidden), populationSize(pSize), genomes(0) {
   for (size_t i = 0; i < populationSize; i++) {
     populationNN.push_back(new NeuralNet(numIn, numOut, numHidden)) ;
   }
@@ -11,14 +12,79 @@ NeuroEvo::NeuroEvo(size_t nIn, size_t nOut, size_t nHidden, size_t pSize): numIn
 
 // Destructor: Deletes all NN objects from population
 NeuroEvo::~NeuroEvo(){
+  ClearPopulation() ;
+  delete(genomes) ;
+  genomes = 0 ;
+}
+
+// Delete all NN objects or release all stored genomes
+void NeuroEvo::ClearPopulation(){
+  for (size_t i = 0; i < populationNN.size(); i++){
+    delete(populationNN[i]) ;
+    populationNN[i] = 0 ;
+  }
+  populationNN.clear() ;
+  for (size_t i = 0; i < populationIds.size(); i++)
+    genomes->Release(populationIds[i]) ;
+  populationIds.clear() ;
+  evaluations.clear() ;
+}
+
+// Move the current population into a GenomeStore, each NN becomes a root genome
+void NeuroEvo::CompressPopulation(size_t cacheSize, size_t maxDepth){
+  if (genomes){
+    std::cout << "Error: population is already compressed!\n" ;
+    return ;
+  }
+  genomes = new GenomeStore(numIn, numOut, numHidden, cacheSize, maxDepth) ;
   for (size_t i = 0; i < populationNN.size(); i++){
+    populationIds.push_back(genomes->AddRoot(populationNN[i]->GetWeightsA(), populationNN[i]->GetWeightsB())) ;
+    evaluations.push_back(populationNN[i]->GetEvaluation()) ;
     delete(populationNN[i]) ;
     populationNN[i] = 0 ;
   }
+  populationNN.clear() ;
+}
+
+// Return the i-th NN, materialising it from its seed chain in compressed mode
+NeuralNet * NeuroEvo::GetNNIndex(size_t i){
+  if (!genomes)
+    return populationNN[i] ;
+  NeuralNet * NN = genomes->Materialise(populationIds[i]).get() ;
+  NN->SetEvaluation(evaluations[i]) ;
+  return NN ;
+}
+
+std::shared_ptr<NeuralNet> NeuroEvo::GetSharedNN(size_t i){
+  if (!genomes)
+    return std::shared_ptr<NeuralNet>(populationNN[i], [](NeuralNet *){}) ; // not owned
+  std::shared_ptr<NeuralNet> NN = genomes->Materialise(populationIds[i]) ;
+  NN->SetEvaluation(evaluations[i]) ;
+  return NN ;
+}
+
+// Overwrite the weights of the i-th NN
+void NeuroEvo::SetNNWeights(size_t i, MatrixXd A, MatrixXd B){
+  if (!genomes){
+    populationNN[i]->SetWeights(A, B) ;
+    return ;
+  }
+  genomes->Release(populationIds[i]) ;
+  populationIds[i] = genomes->AddRoot(A, B) ;
 }
 
 // Double population size by adding NN with mutated weights of existing NN 
 void NeuroEvo::MutatePopulation(){
+  easytime::ScopedTimer timer(easytime::MUTATE) ;
+  if (genomes){
+    // Children only record the seed of their mutation
+    for (size_t i = 0; i < populationSize; i++){
+      unsigned seed = easymath::generator()() ;
+      populationIds.push_back(genomes->AddChild(populationIds[i], seed)) ;
+      evaluations.push_back(0.0) ;
+    }
+    return ;
+  }
   for (size_t i = 0; i < populationSize; i++){
     size_t j = i + populationSize ;
     //    std::cout << "Pushing back new NeuralNet..." << std::endl;
@@ -31,18 +97,51 @@ void NeuroEvo::MutatePopulation(){
 
 // Evolve population according to evaluation signal and survival function
 void NeuroEvo::EvolvePopulation(vector<double> evaluation){
+  easytime::ScopedTimer timer(easytime::SELECT) ;
+  if (genomes){
+    // Shuffle ids and evaluations together
+    vector<size_t> order(2*populationSize) ;
+    for (size_t i = 0; i < order.size(); i++)
+      order[i] = i ;
+    shuffle(order.begin(), order.end(), easymath::generator()) ;
+    vector<size_t> ids ;
+    for (size_t i = 0; i < order.size(); i++){
+      ids.push_back(populationIds[order[i]]) ;
+      evaluations[i] = evaluation[order[i]] ;
+    }
+    populationIds = ids ;
+    
+    (this->*SurvivalFunction)() ;
+    return ;
+  }
+  
   for (size_t i = 0; i < 2*populationSize; i++)
     populationNN[i]->SetEvaluation(evaluation[i]) ;
   
   // Shuffle in preparation for comparisons
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count() ;
-  shuffle(populationNN.begin(), populationNN.end(), std::default_random_engine(seed)) ;
+  shuffle(populationNN.begin(), populationNN.end(), easymath::generator()) ;
   
   (this->*SurvivalFunction)() ;
 }
 
 // Binary tournament for survival, head to head competition between random pairs of NNs
 void NeuroEvo::BinaryTournament(){
+  if (genomes){
+    vector<size_t> ids ;
+    vector<double> evals ;
+    for (size_t i = 0; i < populationSize; i++){
+      size_t j = i + populationSize ;
+      size_t win = (evaluations[i] >= evaluations[j]) ? i : j ;
+      size_t lose = (win == i) ? j : i ;
+      genomes->Release(populationIds[lose]) ;
+      ids.push_back(populationIds[win]) ;
+      evals.push_back(evaluations[win]) ;
+    }
+    populationIds = ids ;
+    evaluations = evals ;
+    return ;
+  }
+  
   vector<size_t> toErase ;
   for (size_t i = 0; i < populationSize; i++){
     size_t j = i + populationSize ;
@@ -71,6 +170,27 @@ bool NeuroEvo::CompareEvaluations(NeuralNet* NN0, NeuralNet* NN1){
 
 // Retain the best half of the population
 void NeuroEvo::RetainBestHalf(){
+  if (genomes){
+    vector<size_t> order(populationIds.size()) ;
+    for (size_t i = 0; i < order.size(); i++)
+      order[i] = i ;
+    vector<double> & evals = evaluations ;
+    std::stable_sort(order.begin(), order.end(), [&evals](size_t a, size_t b){return evals[a] > evals[b] ;}) ;
+    vector<size_t> ids ;
+    vector<double> kept ;
+    for (size_t i = 0; i < order.size(); i++){
+      if (i < populationSize){
+        ids.push_back(populationIds[order[i]]) ;
+        kept.push_back(evaluations[order[i]]) ;
+      }
+      else
+        genomes->Release(populationIds[order[i]]) ;
+    }
+    populationIds = ids ;
+    evaluations = kept ;
+    return ;
+  }
+  
   std::sort(populationNN.begin(),populationNN.end(),CompareEvaluations) ;
   
   for (size_t i = populationSize; i < 2*populationSize; i++){
@@ -85,8 +205,59 @@ void NeuroEvo::RetainBestHalf(){
 
 // Return evaluations of all current NNs in population (used for debugging)
 vector<double> NeuroEvo::GetAllEvaluations(){
+  if (genomes)
+    return evaluations ;
   vector<double> evals ;
   for (size_t i = 0 ; i < populationNN.size(); i++)
     evals.push_back(populationNN[i]->GetEvaluation()) ;
   return evals ;
 }
+
+// Write layer sizes, population size and every NN currently held
+void NeuroEvo::WriteBinary(std::ostream & out){
+  easyio::write_binary(out, static_cast<unsigned long long>(numIn)) ;
+  easyio::write_binary(out, static_cast<unsigned long long>(numOut)) ;
+  easyio::write_binary(out, static_cast<unsigned long long>(numHidden)) ;
+  easyio::write_binary(out, static_cast<unsigned long long>(populationSize)) ;
+  // Compressed populations are written out in full so checkpoints do not depend on the storage mode
+  size_t nStored = genomes ? populationIds.size() : populationNN.size() ;
+  easyio::write_binary(out, static_cast<unsigned long long>(nStored)) ;
+  for (size_t i = 0; i < nStored; i++)
+    GetNNIndex(i)->WriteBinary(out) ;
+}
+
+// Replace the current population with one previously written by WriteBinary
+bool NeuroEvo::ReadBinary(std::istream & in){
+  unsigned long long nIn, nOut, nHidden, pSize, nStored ;
+  if (!easyio::read_binary(in, nIn) || !easyio::read_binary(in, nOut) ||
+      !easyio::read_binary(in, nHidden) || !easyio::read_binary(in, pSize) ||
+      !easyio::read_binary(in, nStored))
+    return false ;
+  if (nIn != numIn || nOut != numOut || nHidden != numHidden || pSize != populationSize){
+    std::cout << "Error: stored population does not match NeuroEvo sizes!\n" ;
+    return false ;
+  }
+  
+  vector<NeuralNet *> loaded ;
+  for (size_t i = 0; i < nStored; i++){
+    NeuralNet * NN = new NeuralNet(numIn, numOut, numHidden) ;
+    loaded.push_back(NN) ;
+    if (!NN->ReadBinary(in)){
+      for (size_t j = 0; j < loaded.size(); j++)
+        delete(loaded[j]) ;
+      return false ;
+    }
+  }
+  
+  ClearPopulation() ;
+  if (!genomes){
+    populationNN = loaded ;
+    return true ;
+  }
+  for (size_t i = 0; i < loaded.size(); i++){
+    populationIds.push_back(genomes->AddRoot(loaded[i]->GetWeightsA(), loaded[i]->GetWeightsB())) ;
+    evaluations.push_back(loaded[i]->GetEvaluation()) ;
+    delete(loaded[i]) ;
+  }
+  return true ;
+}
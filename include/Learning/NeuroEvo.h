@@ -4,9 +4,11 @@
 #include <chrono>
 #include <algorithm>
 #include <random>
+#include <memory>
 #include <vector>
 #include <Eigen/Eigen>
 #include "NeuralNet.h"
+#include "GenomeStore.h"
 
 using std::vector ;
 using std::sort ;
@@ -21,10 +23,29 @@ class NeuroEvo{
     void EvolvePopulation(vector<double>) ;
     vector<double> GetAllEvaluations() ;
     
-    NeuralNet * GetNNIndex(size_t i){return populationNN[i] ;}
+    // Binary snapshot of the full current population (including any mutated
+    // half), used for checkpointing. Reading replaces the population and
+    // requires matching layer and population sizes.
+    void WriteBinary(std::ostream &) ;
+    bool ReadBinary(std::istream &) ;
+    
+    // Store the population as seed chains in a GenomeStore rather than as full
+    // NNs. In this mode the pointer returned by GetNNIndex is owned by the
+    // store's cache and is only valid until the next call to GetNNIndex; use
+    // GetSharedNN to keep several NNs at once.
+    void CompressPopulation(size_t cacheSize, size_t maxDepth) ;
+    bool IsCompressed(){return genomes != 0 ;}
+    GenomeStore * GetGenomeStore(){return genomes ;}
+    
+    NeuralNet * GetNNIndex(size_t i) ;
+    // The i-th NN, kept alive by the returned pointer even if it is evicted
+    // from the store's cache. Uncompressed NNs are still owned by the
+    // population and are only valid until it changes.
+    std::shared_ptr<NeuralNet> GetSharedNN(size_t i) ;
+    void SetNNWeights(size_t, MatrixXd, MatrixXd) ;
     size_t GetCurrentPopSize() {
       std::cout << "NeuroEvo.h::GetCurrentPopSize()" << std::endl;
-      return populationNN.size();
+      return genomes ? populationIds.size() : populationNN.size();
     }
   private:
     size_t numIn ;
@@ -34,9 +55,14 @@ class NeuroEvo{
     size_t populationSize ;
     vector<NeuralNet *> populationNN ;
     
+    GenomeStore * genomes ; // null unless the population is compressed
+    vector<size_t> populationIds ;
+    vector<double> evaluations ;
+    
     void (NeuroEvo::*SurvivalFunction)() ;
     void BinaryTournament() ;
     void RetainBestHalf() ;
     static bool CompareEvaluations(NeuralNet *, NeuralNet *) ;
+    void ClearPopulation() ;
 } ;
 #endif // NEUR0_EVO_H_
@@ -0,0 +1,60 @@
+#include "BeliefTracker.h"
+
+BeliefTracker::BeliefTracker(POMDPEnvironment * env, POMDPPolicy * policy, size_t numBeliefs): pomdpEnv(env), pomdpPolicy(policy){
+  size_t numActions = pomdpEnv->GetActions().size() ;
+  for (size_t a = 0; a < numActions; a++)
+    zDense.push_back(MatrixXd(pomdpEnv->GetObservationProbabilities(a))) ;
+  byAction.resize(numActions) ;
+  beliefs.resize(pomdpEnv->GetStates().size(), numBeliefs) ;
+  Reset() ;
+}
+
+void BeliefTracker::Reset(){
+  beliefs.colwise() = pomdpEnv->GetInitialBelief() ;
+}
+
+size_t BeliefTracker::Update(const vector<size_t> & actions, const vector<size_t> & observations){
+  if (actions.size() != (size_t)beliefs.cols() || observations.size() != (size_t)beliefs.cols()){
+    std::cout << "Error: expected one action and observation for each of " << beliefs.cols() << " beliefs!\n" ;
+    return beliefs.cols() ;
+  }
+  for (size_t a = 0; a < byAction.size(); a++)
+    byAction[a].clear() ;
+  for (size_t i = 0; i < actions.size(); i++)
+    byAction[actions[i]].push_back(i) ;
+  
+  size_t impossible = 0 ;
+  for (size_t a = 0; a < byAction.size(); a++){
+    const vector<size_t> & cols = byAction[a] ;
+    if (cols.empty())
+      continue ;
+    gathered.resize(beliefs.rows(), cols.size()) ;
+    for (size_t k = 0; k < cols.size(); k++)
+      gathered.col(k) = beliefs.col(cols[k]) ;
+    updated.noalias() = pomdpEnv->GetTransitions(a).transpose()*gathered ;
+    
+    // Observation likelihoods and normalisation per belief
+    for (size_t k = 0; k < cols.size(); k++){
+      updated.col(k).array() *= zDense[a].col(observations[cols[k]]).array() ;
+      double total = updated.col(k).sum() ;
+      if (total > 0.0)
+        beliefs.col(cols[k]) = updated.col(k)/total ;
+      else
+        impossible++ ;
+    }
+  }
+  return impossible ;
+}
+
+// Of equally valued alpha vectors the first is chosen
+vector<size_t> BeliefTracker::GetBestActions(){
+  values.noalias() = pomdpPolicy->GetAlphaMatrix()*beliefs ;
+  vector<size_t> actionNums = pomdpPolicy->GetActionVector() ;
+  vector<size_t> best(beliefs.cols()) ;
+  for (size_t i = 0; i < best.size(); i++){
+    MatrixXd::Index maxInd ;
+    values.col(i).maxCoeff(&maxInd) ;
+    best[i] = actionNums[maxInd] ;
+  }
+  return best ;
+}
@@ -0,0 +1,44 @@
+#ifndef BELIEF_TRACKER_H_
+#define BELIEF_TRACKER_H_
+
+#include <vector>
+#include <iostream>
+#include <Eigen/Eigen>
+#include "POMDPEnvironment.h"
+#include "POMDPPolicy.h"
+
+using std::vector ;
+using namespace Eigen ;
+
+// Many beliefs over the same POMDP, held as the columns of one matrix. An
+// update groups the beliefs by action so each action's transition is applied
+// to all of its beliefs with one sparse-dense product, and the best actions
+// for every belief come from one product with the policy's alpha matrix.
+// The environment and policy are not owned.
+class BeliefTracker{
+  public:
+    BeliefTracker(POMDPEnvironment *, POMDPPolicy *, size_t) ;
+    ~BeliefTracker(){}
+    
+    size_t GetNumBeliefs(){return beliefs.cols() ;}
+    const MatrixXd & GetBeliefs(){return beliefs ;} // one belief per column
+    VectorXd GetBelief(size_t i){return beliefs.col(i) ;}
+    void SetBelief(size_t i, const VectorXd & b){beliefs.col(i) = b ;}
+    void Reset() ; // every belief back to the initial belief
+    
+    // One action and observation per belief. A belief whose observation is
+    // impossible is left unchanged, returns the number of such beliefs.
+    size_t Update(const vector<size_t> &, const vector<size_t> &) ;
+    vector<size_t> GetBestActions() ;
+  private:
+    POMDPEnvironment * pomdpEnv ;
+    POMDPPolicy * pomdpPolicy ;
+    MatrixXd beliefs ;
+    
+    vector<MatrixXd> zDense ; // action, transitioned state, observation
+    vector< vector<size_t> > byAction ; // belief indices grouped by action
+    MatrixXd gathered ;
+    MatrixXd updated ;
+    MatrixXd values ;
+} ;
+#endif // BELIEF_TRACKER_H_
@@ -0,0 +1,213 @@
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include "PBVISolver.h"
+
+PBVISolver::PBVISolver(POMDPEnvironment * env, size_t numThreads, unsigned seed): pomdpEnv(env), generator(seed){
+  pool = new ThreadPool(numThreads) ;
+  numStates = pomdpEnv->GetStates().size() ;
+  numActions = pomdpEnv->GetActions().size() ;
+  numObservations = pomdpEnv->GetObservations().size() ;
+  discount = pomdpEnv->GetDiscount() ;
+  double sign = (pomdpEnv->GetValues() == "cost") ? -1.0 : 1.0 ;
+  
+  // Expected immediate rewards and transition-observation products
+  rewards.setZero(numStates, numActions) ;
+  for (size_t a = 0; a < numActions; a++){
+    const SparseRowMatrix & T = pomdpEnv->GetTransitions(a) ;
+    const SparseRowMatrix & Z = pomdpEnv->GetObservationProbabilities(a) ;
+    for (size_t s = 0; s < numStates; s++)
+      for (SparseRowMatrix::InnerIterator t(T, s); t; ++t)
+        for (SparseRowMatrix::InnerIterator z(Z, t.col()); z; ++z)
+          rewards(s,a) += sign*t.value()*z.value()*pomdpEnv->GetReward(a, s, t.col(), z.col()) ;
+    for (size_t o = 0; o < numObservations; o++){
+      VectorXd zo = Z*VectorXd::Unit(numObservations, o) ;
+      M.push_back(T*zo.asDiagonal()) ;
+    }
+  }
+}
+
+PBVISolver::~PBVISolver(){
+  delete pool ;
+}
+
+size_t PBVISolver::Sample(const SparseRowMatrix & P, size_t row){
+  double u = std::uniform_real_distribution<double>(0.0, 1.0)(generator) ;
+  size_t last = 0 ;
+  for (SparseRowMatrix::InnerIterator p(P, row); p; ++p){
+    last = p.col() ;
+    u -= p.value() ;
+    if (u <= 0.0)
+      break ;
+  }
+  return last ;
+}
+
+size_t PBVISolver::Sample(const VectorXd & p){
+  double u = std::uniform_real_distribution<double>(0.0, 1.0)(generator) ;
+  size_t last = 0 ;
+  for (size_t i = 0; i < (size_t)p.size(); i++){
+    if (p(i) <= 0.0)
+      continue ;
+    last = i ;
+    u -= p(i) ;
+    if (u <= 0.0)
+      break ;
+  }
+  return last ;
+}
+
+// Random walks from the initial belief with uniformly chosen actions, a walk
+// ends with probability 1-discount per step. Only beliefs not already within
+// a small L1 distance of a collected point are kept.
+void PBVISolver::CollectBeliefs(size_t numBeliefs){
+  vector<VectorXd> points(1, pomdpEnv->GetInitialBelief()) ;
+  VectorXd b = points[0] ;
+  VectorXd next ;
+  size_t s = Sample(b) ;
+  std::uniform_int_distribution<size_t> action(0, numActions-1) ;
+  std::uniform_real_distribution<double> unif(0.0, 1.0) ;
+  for (size_t attempt = 0; points.size() < numBeliefs && attempt < 100*numBeliefs; attempt++){
+    size_t a = action(generator) ;
+    size_t s1 = Sample(pomdpEnv->GetTransitions(a), s) ;
+    size_t o = Sample(pomdpEnv->GetObservationProbabilities(a), s1) ;
+    if (!pomdpEnv->UpdateBelief(b, a, o, next))
+      continue ;
+    b.swap(next) ;
+    s = s1 ;
+    
+    double closest = std::numeric_limits<double>::max() ;
+    for (size_t i = 0; i < points.size(); i++)
+      closest = std::min(closest, (points[i] - b).lpNorm<1>()) ;
+    if (closest > 1e-3)
+      points.push_back(b) ;
+    if (unif(generator) > discount){
+      b = points[0] ;
+      s = Sample(b) ;
+    }
+  }
+  beliefs.resize(numStates, points.size()) ;
+  for (size_t i = 0; i < points.size(); i++)
+    beliefs.col(i) = points[i] ;
+}
+
+// Best alpha vector for a belief given the projections M[a*O+o]*alphas'
+void PBVISolver::Backup(const VectorXd & b, const vector<MatrixXd> & proj, VectorXd & alpha, size_t & action){
+  double bestValue = -std::numeric_limits<double>::infinity() ;
+  VectorXd g ;
+  for (size_t a = 0; a < numActions; a++){
+    g = rewards.col(a) ;
+    for (size_t o = 0; o < numObservations; o++){
+      const MatrixXd & P = proj[a*numObservations + o] ;
+      MatrixXd::Index best ;
+      (P.transpose()*b).maxCoeff(&best) ;
+      g += discount*P.col(best) ;
+    }
+    double value = g.dot(b) ;
+    if (value > bestValue){
+      bestValue = value ;
+      alpha = g ;
+      action = a ;
+    }
+  }
+}
+
+PBVIStats PBVISolver::Solve(size_t numBeliefs, size_t maxIterations, double epsilon){
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() ;
+  PBVIStats stats ;
+  stats.iterations = 0 ;
+  stats.residual = std::numeric_limits<double>::infinity() ;
+  stats.converged = false ;
+  
+  CollectBeliefs(std::max(numBeliefs, (size_t)1)) ;
+  stats.numBeliefs = beliefs.cols() ;
+  stats.beliefSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() ;
+  
+  // Lower bound: the worst immediate reward received forever
+  if (discount >= 1.0)
+    std::cout << "Error: PBVI needs a discount below 1, initial values are not bounded!\n" ;
+  alphas.setConstant(1, numStates, rewards.minCoeff()/(1.0 - std::min(discount, 0.999999))) ;
+  actionNums.assign(1, 0) ;
+  
+  size_t numB = beliefs.cols() ;
+  vector<MatrixXd> proj(numActions*numObservations) ;
+  MatrixXd newAlphas(numB, numStates) ;
+  vector<size_t> newActions(numB) ;
+  vector<long> keptOld(numB) ; // previous vector kept for a point, -1 if the backup improved it
+  VectorXd oldValues, newValues(numB) ;
+  
+  while (stats.iterations < maxIterations && !stats.converged){
+    std::chrono::steady_clock::time_point iterStart = std::chrono::steady_clock::now() ;
+    MatrixXd values = alphas*beliefs ;
+    oldValues = values.colwise().maxCoeff().transpose() ;
+    
+    MatrixXd alphasT = alphas.transpose() ;
+    pool->ParallelFor(proj.size(), [this, &proj, &alphasT](size_t k, size_t){
+      proj[k] = M[k]*alphasT ;
+    }) ;
+    pool->ParallelFor(numB, [&](size_t i, size_t){
+      VectorXd alpha ;
+      size_t action ;
+      Backup(beliefs.col(i), proj, alpha, action) ;
+      double value = alpha.dot(beliefs.col(i)) ;
+      if (value < oldValues(i)){
+        MatrixXd::Index best ;
+        values.col(i).maxCoeff(&best) ;
+        keptOld[i] = best ;
+        newValues(i) = oldValues(i) ;
+      }
+      else {
+        keptOld[i] = -1 ;
+        newAlphas.row(i) = alpha.transpose() ;
+        newActions[i] = action ;
+        newValues(i) = value ;
+      }
+    }) ;
+    
+    // New vector set without duplicates, in belief point order
+    MatrixXd next(numB, numStates) ;
+    vector<size_t> nextActions ;
+    for (size_t i = 0; i < numB; i++){
+      VectorXd alpha = (keptOld[i] < 0) ? VectorXd(newAlphas.row(i).transpose()) : VectorXd(alphas.row(keptOld[i]).transpose()) ;
+      size_t action = (keptOld[i] < 0) ? newActions[i] : actionNums[keptOld[i]] ;
+      bool duplicate = false ;
+      for (size_t j = 0; j < nextActions.size() && !duplicate; j++)
+        duplicate = (nextActions[j] == action && next.row(j).transpose() == alpha) ;
+      if (!duplicate){
+        next.row(nextActions.size()) = alpha.transpose() ;
+        nextActions.push_back(action) ;
+      }
+    }
+    alphas = next.topRows(nextActions.size()) ;
+    actionNums.swap(nextActions) ;
+    
+    stats.iterations++ ;
+    stats.residual = (newValues - oldValues).cwiseAbs().maxCoeff() ;
+    stats.converged = stats.residual <= epsilon ;
+    stats.iterationSeconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - iterStart).count()) ;
+  }
+  
+  stats.numVectors = actionNums.size() ;
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() ;
+  return stats ;
+}
+
+bool PBVISolver::WritePolicy(const char * fName){
+  std::ofstream policyFile(fName) ;
+  if (!policyFile.is_open()){
+    std::cout << "Error: unable to write " << fName << "!\n" ;
+    return false ;
+  }
+  policyFile.precision(12) ;
+  policyFile << "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n" ;
+  policyFile << "<Policy version=\"0.1\" type=\"value\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:noNamespaceSchemaLocation=\"policyx.xsd\">\n" ;
+  policyFile << "<AlphaVector vectorLength=\"" << numStates << "\" numObsValue=\"1\" numVectors=\"" << actionNums.size() << "\">\n" ;
+  for (size_t i = 0; i < actionNums.size(); i++){
+    policyFile << "<Vector action=\"" << actionNums[i] << "\" obsValue=\"0\">" ;
+    for (size_t j = 0; j < numStates; j++)
+      policyFile << alphas(i,j) << " " ;
+    policyFile << "</Vector>\n" ;
+  }
+  policyFile << "</AlphaVector> </Policy>\n" ;
+  return policyFile.good() ;
+}
@@ -0,0 +1,65 @@
+#ifndef PBVI_SOLVER_H_
+#define PBVI_SOLVER_H_
+
+#include <vector>
+#include <random>
+#include <iostream>
+#include <Eigen/Eigen>
+#include "Utilities/ThreadPool.h"
+#include "POMDPEnvironment.h"
+
+using std::vector ;
+using namespace Eigen ;
+
+// Convergence and timing of a solve
+struct PBVIStats{
+  size_t iterations ;
+  size_t numBeliefs ;
+  size_t numVectors ;
+  double residual ; // largest change in value over the belief points in the last iteration
+  bool converged ;
+  double beliefSeconds ; // time spent collecting belief points
+  double seconds ; // total wall time
+  vector<double> iterationSeconds ;
+} ;
+
+// Point-based value iteration. Belief points are collected by random walks
+// from the initial belief, then every point is backed up against the current
+// alpha vectors in parallel on each iteration. As in Perseus a point whose
+// backup does not improve its value keeps its previous best vector, so the
+// value of every point never decreases. Models with "values: cost" are solved
+// with negated rewards. The alpha vectors are written in the XML format read
+// by POMDPPolicy.
+class PBVISolver{
+  public:
+    PBVISolver(POMDPEnvironment *, size_t numThreads = 1, unsigned seed = 0) ;
+    ~PBVISolver() ;
+    
+    // Stops when no point's value changes by more than epsilon
+    PBVIStats Solve(size_t numBeliefs, size_t maxIterations, double epsilon) ;
+    
+    const MatrixXd & GetAlphaMatrix(){return alphas ;} // one alpha vector per row
+    vector<size_t> GetActionVector(){return actionNums ;}
+    const MatrixXd & GetBeliefs(){return beliefs ;} // one belief point per column
+    bool WritePolicy(const char *) ;
+  private:
+    POMDPEnvironment * pomdpEnv ;
+    ThreadPool * pool ;
+    std::mt19937 generator ;
+    size_t numStates ;
+    size_t numActions ;
+    size_t numObservations ;
+    double discount ;
+    
+    MatrixXd rewards ; // expected immediate reward, state by action
+    vector<SparseRowMatrix> M ; // [a*O+o](s,s') = T(s,s') Z(s',o)
+    MatrixXd beliefs ;
+    MatrixXd alphas ;
+    vector<size_t> actionNums ;
+    
+    void CollectBeliefs(size_t) ;
+    size_t Sample(const SparseRowMatrix &, size_t) ;
+    size_t Sample(const VectorXd &) ;
+    void Backup(const VectorXd &, const vector<MatrixXd> &, VectorXd &, size_t &) ;
+} ;
+#endif // PBVI_SOLVER_H_
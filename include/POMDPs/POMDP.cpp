@@ -1,8 +1,11 @@
 #include "POMDP.h"
 
 POMDP::POMDP(char * env, char * policy, VectorXd b){
-  pomdpEnv = new POMDPEnvironment(env) ;
-  pomdpPolicy = new POMDPPolicy(policy) ;
+  // Compiled model and pruned policy, from the .pomdpb cache when it is current
+  if (!POMDPCache::Load(env, policy, pomdpEnv, pomdpPolicy)){
+    pomdpEnv = new POMDPEnvironment(env) ;
+    pomdpPolicy = new POMDPPolicy(policy) ;
+  }
   belief = b ;
 }
 
@@ -11,7 +14,9 @@ size_t POMDP::GetBestAction(){
 }
 
 void POMDP::UpdateBelief(size_t act, size_t obs){
-  VectorXd b = pomdpEnv->UpdateBelief(belief,act,obs) ;
-  belief = b ;
+  if (pomdpEnv->UpdateBelief(belief,act,obs,nextBelief))
+    belief.swap(nextBelief) ;
+  else
+    std::cout << "Error: observation " << obs << " is impossible after action " << act << ", belief not updated!\n" ;
 }
 
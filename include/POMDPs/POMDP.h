@@ -5,6 +5,7 @@
 #include <Eigen/Eigen>
 #include "POMDPEnvironment.h"
 #include "POMDPPolicy.h"
+#include "POMDPCache.h"
 
 using std::vector ;
 using namespace Eigen ;
@@ -28,5 +29,6 @@ class POMDP{
     POMDPEnvironment * pomdpEnv ;
     POMDPPolicy * pomdpPolicy ;
     VectorXd belief ;
+    VectorXd nextBelief ; // update buffer, swapped with belief
 } ;
 #endif // POMDP_H_
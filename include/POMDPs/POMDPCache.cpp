@@ -0,0 +1,306 @@
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "POMDPCache.h"
+#include "Utilities/BinaryIO.h"
+
+namespace {
+// Appends sections to a buffer, each padded to 8 bytes
+class CacheWriter{
+  public:
+    void Raw(const void * p, size_t n){
+      bytes.append(static_cast<const char *>(p), n) ;
+      bytes.append((8 - n%8)%8, '\0') ;
+    }
+    void U64(unsigned long long x){Raw(&x, sizeof(x)) ;}
+    void Double(double x){Raw(&x, sizeof(x)) ;}
+    void String(const string & s){
+      U64(s.size()) ;
+      Raw(s.data(), s.size()) ;
+    }
+    void Strings(const vector<string> & s){
+      U64(s.size()) ;
+      for (size_t i = 0; i < s.size(); i++)
+        String(s[i]) ;
+    }
+    void Sparse(SparseRowMatrix m){
+      m.makeCompressed() ;
+      U64(m.rows()) ;
+      U64(m.cols()) ;
+      U64(m.nonZeros()) ;
+      Raw(m.outerIndexPtr(), (m.rows()+1)*sizeof(int)) ;
+      Raw(m.innerIndexPtr(), m.nonZeros()*sizeof(int)) ;
+      Raw(m.valuePtr(), m.nonZeros()*sizeof(double)) ;
+    }
+    string bytes ;
+} ;
+
+// Reads sections back in the same order, any read past the end fails and
+// every later read fails too
+class CacheReader{
+  public:
+    CacheReader(const char * d, size_t n, size_t start): ok(true), data(d), size(n), pos(start){}
+    const char * Raw(size_t n){
+      size_t padded = n + (8 - n%8)%8 ;
+      if (!ok || padded > size - pos){
+        ok = false ;
+        return 0 ;
+      }
+      const char * p = data + pos ;
+      pos += padded ;
+      return p ;
+    }
+    unsigned long long U64(){
+      unsigned long long x = 0 ;
+      const char * p = Raw(sizeof(x)) ;
+      if (p)
+        std::memcpy(&x, p, sizeof(x)) ;
+      return x ;
+    }
+    double Double(){
+      double x = 0.0 ;
+      const char * p = Raw(sizeof(x)) ;
+      if (p)
+        std::memcpy(&x, p, sizeof(x)) ;
+      return x ;
+    }
+    string String(){
+      unsigned long long n = U64() ;
+      const char * p = (n <= size) ? Raw(n) : 0 ;
+      return p ? string(p, n) : string() ;
+    }
+    vector<string> Strings(){
+      unsigned long long n = U64() ;
+      vector<string> s ;
+      for (unsigned long long i = 0; i < n && ok; i++)
+        s.push_back(String()) ;
+      return s ;
+    }
+    SparseRowMatrix Sparse(size_t rows, size_t cols){
+      SparseRowMatrix m ;
+      if (U64() != rows || U64() != cols){
+        ok = false ;
+        return m ;
+      }
+      unsigned long long nnz = U64() ;
+      const int * outer = reinterpret_cast<const int *>(Raw((rows+1)*sizeof(int))) ;
+      const int * inner = (nnz <= size) ? reinterpret_cast<const int *>(Raw(nnz*sizeof(int))) : 0 ;
+      const double * values = (nnz <= size) ? reinterpret_cast<const double *>(Raw(nnz*sizeof(double))) : 0 ;
+      if (!ok || !inner || !values || outer[0] != 0 || (unsigned long long)outer[rows] != nnz){
+        ok = false ;
+        return m ;
+      }
+      // Row starts run from 0 to nnz without decreasing, so every row is in range
+      for (size_t i = 0; i < rows; i++){
+        if (outer[i] > outer[i+1]){
+          ok = false ;
+          return m ;
+        }
+      }
+      for (size_t i = 0; i < nnz; i++){
+        if (inner[i] < 0 || (size_t)inner[i] >= cols){
+          ok = false ;
+          return m ;
+        }
+      }
+      m = Map<const SparseRowMatrix>(rows, cols, nnz, outer, inner, values) ;
+      return m ;
+    }
+    bool ok ;
+  private:
+    const char * data ;
+    size_t size ;
+    size_t pos ;
+} ;
+} // namespace
+
+string POMDPCache::CachePath(const char * model){
+  string path(model) ;
+  size_t dot = path.find_last_of('.') ;
+  size_t slash = path.find_last_of('/') ;
+  if (dot != string::npos && (slash == string::npos || dot > slash))
+    path.erase(dot) ;
+  return path + ".pomdpb" ;
+}
+
+unsigned long long POMDPCache::HashFile(const char * fName, bool & ok){
+  ifstream file(fName, std::ios::in | std::ios::binary) ;
+  ok = file.is_open() ;
+  unsigned long long h = 14695981039346656037ULL ;
+  char buffer[1 << 16] ;
+  while (ok && file){
+    file.read(buffer, sizeof(buffer)) ;
+    std::streamsize n = file.gcount() ;
+    for (std::streamsize i = 0; i < n; i++){
+      h ^= (unsigned char)buffer[i] ;
+      h *= 1099511628211ULL ;
+    }
+  }
+  return h ;
+}
+
+bool POMDPCache::Load(const char * model, const char * policy, POMDPEnvironment *& env, POMDPPolicy *& pol, const string & cachePath, bool * usedCache){
+  env = 0 ;
+  pol = 0 ;
+  if (usedCache)
+    *usedCache = false ;
+  bool modelOk, policyOk ;
+  unsigned long long modelHash = HashFile(model, modelOk) ;
+  unsigned long long policyHash = HashFile(policy, policyOk) ;
+  if (!modelOk || !policyOk){
+    std::cout << "Error: unable to read " << (modelOk ? policy : model) << "!\n" ;
+    return false ;
+  }
+  string path = cachePath.empty() ? CachePath(model) : cachePath ;
+  if (Read(path, env, pol, modelHash, policyHash)){
+    if (usedCache)
+      *usedCache = true ;
+    return true ;
+  }
+  
+  env = new POMDPEnvironment(const_cast<char *>(model)) ;
+  pol = new POMDPPolicy(const_cast<char *>(policy)) ;
+  if (!env->IsValid() || !pol->IsValid()){
+    delete env ;
+    delete pol ;
+    env = 0 ;
+    pol = 0 ;
+    return false ;
+  }
+  pol->PruneDominated() ;
+  Write(path, env, pol, modelHash, policyHash) ; // a failed write only costs the next process a parse
+  return true ;
+}
+
+bool POMDPCache::Write(const string & path, POMDPEnvironment * env, POMDPPolicy * pol, unsigned long long modelHash, unsigned long long policyHash){
+  POMDPCacheHeader header ;
+  std::memset(&header, 0, sizeof(header)) ;
+  std::memcpy(header.magic, "POMDPB", 7) ;
+  header.version = POMDP_CACHE_VERSION ;
+  header.modelHash = modelHash ;
+  header.policyHash = policyHash ;
+  
+  CacheWriter w ;
+  w.Raw(&header, sizeof(header)) ;
+  w.Double(env->discount) ;
+  w.String(env->values) ;
+  w.Strings(env->states) ;
+  w.Strings(env->actions) ;
+  w.Strings(env->observations) ;
+  w.Raw(env->start.data(), env->start.size()*sizeof(double)) ;
+  for (size_t a = 0; a < env->actions.size(); a++)
+    w.Sparse(env->T[a]) ;
+  for (size_t a = 0; a < env->actions.size(); a++)
+    w.Sparse(env->Z[a]) ;
+  
+  vector< std::pair<unsigned long long, double> > rewards(env->R.begin(), env->R.end()) ;
+  std::sort(rewards.begin(), rewards.end()) ;
+  vector<unsigned long long> keys(rewards.size()) ;
+  vector<double> values(rewards.size()) ;
+  for (size_t i = 0; i < rewards.size(); i++){
+    keys[i] = rewards[i].first ;
+    values[i] = rewards[i].second ;
+  }
+  w.U64(rewards.size()) ;
+  w.Raw(keys.data(), keys.size()*sizeof(unsigned long long)) ;
+  w.Raw(values.data(), values.size()*sizeof(double)) ;
+  
+  Matrix<double, Dynamic, Dynamic, RowMajor> alphas = pol->alphas ;
+  vector<unsigned long long> actionNums(pol->actionNums.begin(), pol->actionNums.end()) ;
+  w.U64(alphas.rows()) ;
+  w.U64(alphas.cols()) ;
+  w.Raw(actionNums.data(), actionNums.size()*sizeof(unsigned long long)) ;
+  w.Raw(alphas.data(), alphas.size()*sizeof(double)) ;
+  
+  header.fileSize = w.bytes.size() ;
+  std::memcpy(&w.bytes[0], &header, sizeof(header)) ;
+  
+  stringstream tmp ;
+  tmp << path << ".tmp" << getpid() ;
+  std::ofstream out(tmp.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc) ;
+  out.write(w.bytes.data(), w.bytes.size()) ;
+  out.close() ;
+  if (out.fail() || std::rename(tmp.str().c_str(), path.c_str()) != 0){
+    std::cout << "Error: unable to write POMDP cache " << path << "!\n" ;
+    std::remove(tmp.str().c_str()) ;
+    return false ;
+  }
+  return true ;
+}
+
+bool POMDPCache::Read(const string & path, POMDPEnvironment *& env, POMDPPolicy *& pol, unsigned long long modelHash, unsigned long long policyHash){
+  int fd = ::open(path.c_str(), O_RDONLY) ;
+  if (fd < 0)
+    return false ;
+  struct stat st ;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(POMDPCacheHeader)){
+    ::close(fd) ;
+    return false ;
+  }
+  size_t fileSize = st.st_size ;
+  void * p = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0) ;
+  ::close(fd) ;
+  if (p == MAP_FAILED)
+    return false ;
+  const char * data = static_cast<const char *>(p) ;
+  const POMDPCacheHeader * header = reinterpret_cast<const POMDPCacheHeader *>(data) ;
+  if (std::memcmp(header->magic, "POMDPB", 7) != 0 || header->version != POMDP_CACHE_VERSION || header->fileSize != fileSize || header->modelHash != modelHash || header->policyHash != policyHash){
+    munmap(p, fileSize) ;
+    return false ;
+  }
+  
+  CacheReader r(data, fileSize, sizeof(POMDPCacheHeader) + (8 - sizeof(POMDPCacheHeader)%8)%8) ;
+  POMDPEnvironment * e = new POMDPEnvironment() ;
+  e->discount = r.Double() ;
+  e->values = r.String() ;
+  e->states = r.Strings() ;
+  e->actions = r.Strings() ;
+  e->observations = r.Strings() ;
+  size_t nS = e->states.size() ;
+  size_t nO = e->observations.size() ;
+  const char * start = (nS <= fileSize) ? r.Raw(nS*sizeof(double)) : 0 ;
+  if (start)
+    e->start = Map<const VectorXd>(reinterpret_cast<const double *>(start), nS) ;
+  for (size_t a = 0; a < e->actions.size() && r.ok; a++)
+    e->T.push_back(r.Sparse(nS, nS)) ;
+  for (size_t a = 0; a < e->actions.size() && r.ok; a++)
+    e->Z.push_back(r.Sparse(nS, nO)) ;
+  
+  unsigned long long numRewards = r.U64() ;
+  const char * keys = (numRewards <= fileSize) ? r.Raw(numRewards*sizeof(unsigned long long)) : 0 ;
+  const char * values = (numRewards <= fileSize) ? r.Raw(numRewards*sizeof(double)) : 0 ;
+  for (size_t i = 0; keys && values && i < numRewards; i++)
+    e->R[reinterpret_cast<const unsigned long long *>(keys)[i]] = reinterpret_cast<const double *>(values)[i] ;
+  
+  POMDPPolicy * q = new POMDPPolicy() ;
+  unsigned long long numVectors = r.U64() ;
+  unsigned long long length = r.U64() ;
+  const char * actionNums = (numVectors <= fileSize) ? r.Raw(numVectors*sizeof(unsigned long long)) : 0 ;
+  unsigned long long numAlphas = 0 ;
+  bool alphasFit = length == nS && easyio::checked_multiply(numVectors, length, numAlphas) && numAlphas <= fileSize ;
+  const char * alphas = alphasFit ? r.Raw(numAlphas*sizeof(double)) : 0 ;
+  if (actionNums && alphas){
+    q->actionNums.assign(reinterpret_cast<const unsigned long long *>(actionNums), reinterpret_cast<const unsigned long long *>(actionNums) + numVectors) ;
+    q->alphas = Map< const Matrix<double, Dynamic, Dynamic, RowMajor> >(reinterpret_cast<const double *>(alphas), numVectors, length) ;
+  }
+  munmap(p, fileSize) ;
+  
+  if (!r.ok || !start || !keys || !values || !actionNums || !alphas || nS == 0 || e->actions.empty() || nO == 0 || length != nS || numVectors == 0){
+    std::cout << "Error: POMDP cache " << path << " is malformed and will be rebuilt!\n" ;
+    delete e ;
+    delete q ;
+    return false ;
+  }
+  e->BuildTransposes() ;
+  e->valid = true ;
+  q->valid = true ;
+  env = e ;
+  pol = q ;
+  return true ;
+}
@@ -0,0 +1,61 @@
+#ifndef POMDP_CACHE_H_
+#define POMDP_CACHE_H_
+
+#include <string>
+#include <iostream>
+#include "POMDPEnvironment.h"
+#include "POMDPPolicy.h"
+
+using std::string ;
+
+// Compiled binary form (.pomdpb) of a model and its pruned policy: the
+// sparse transition and observation matrices, the specified rewards and the
+// alpha matrix, stored with hashes of the two source files. Loading maps the
+// file and copies the arrays straight into place, so there is no parsing.
+// The mapping is released once loaded, so each process still holds its own
+// copy of the model: the model's accessors return owned sparse matrices, and
+// every process builds transposed copies of T and Z for belief updates
+// anyway. Processes sharing a cache share the parsing and pruning work, not
+// the memory.
+// The cache is rewritten whenever either source no longer matches its hash,
+// and is written to a temporary file and renamed so processes starting
+// together never see a partial file.
+//
+// File layout, every section padded to 8 bytes:
+//   header                   POMDPCacheHeader
+//   discount, values         double, string
+//   state, action, observation names
+//   start belief             S doubles
+//   T then Z per action      rows, cols, nnz, outer (int), inner (int), values (double)
+//   rewards                  count, packed keys (u64), values (double)
+//   policy                   vectors, length, actions (u64), alphas (row major doubles)
+// Strings are a u64 length followed by the characters.
+struct POMDPCacheHeader{
+  char magic[8] ; // "POMDPB\0\0"
+  unsigned int version ;
+  unsigned int reserved ;
+  unsigned long long modelHash ;
+  unsigned long long policyHash ;
+  unsigned long long fileSize ; // detects a truncated file
+} ;
+
+const unsigned int POMDP_CACHE_VERSION = 1 ;
+
+class POMDPCache{
+  public:
+    // Cache file used for a model: its name with the extension replaced by .pomdpb
+    static string CachePath(const char *) ;
+    
+    // Model and policy from the cache if it matches the sources, otherwise
+    // parsed (and the policy pruned) then written to the cache. Returns false
+    // if the sources cannot be read or parsed, env and policy are then left
+    // NULL. An empty cache path uses CachePath(model). usedCache, if given,
+    // is set to whether the cache was read.
+    static bool Load(const char * model, const char * policy, POMDPEnvironment *& env, POMDPPolicy *& pol, const string & cachePath = "", bool * usedCache = 0) ;
+    
+    static unsigned long long HashFile(const char *, bool &) ; // 64 bit FNV-1a of the contents
+  private:
+    static bool Write(const string &, POMDPEnvironment *, POMDPPolicy *, unsigned long long, unsigned long long) ;
+    static bool Read(const string &, POMDPEnvironment *&, POMDPPolicy *&, unsigned long long, unsigned long long) ;
+} ;
+#endif // POMDP_CACHE_H_
@@ -1,277 +1,423 @@
+#include <cstdlib>
+#include <cctype>
+#include <limits>
 #include "POMDPEnvironment.h"
 
-POMDPEnvironment::POMDPEnvironment(char * fName){
-  // WARNING! SERIOUSLY HARD CODED TO EXPECT STRICT ORDERING IN .POMDP FILE
-  // Filename to write to stored in fName
-	stringstream fileName ;
-  fileName << fName ;
-  ifstream envFile ;
-  envFile.open(fileName.str().c_str(),std::ios::in) ;
-  
-  // Collect state, action and observation definitions
-  string line ;
-  while (getline(envFile,line)){
-    stringstream lineStream(line) ;
-    string cell ;
-    
-    size_t elemNum = 0 ;
-    int tag = -1 ; // 0: discount, 1: values, 2: states, 3: actions, 4: observations
-    while (getline(lineStream,cell,' ')){ // space delimiter
-      if (elemNum == 0){
-        if (cell.compare("discount:") == 0){
-          tag = 0 ;
-//          std::cout << "Reading in discount parameter...\n" ;
-        }
-        else if (cell.compare("values:") == 0){
-          tag = 1 ;
-//          std::cout << "Reading in value parameters...\n" ;
+namespace {
+// Tokens of a .pomdp file: ':' is a token of its own and '#' starts a comment
+class PomdpTokens{
+  public:
+    PomdpTokens(const string & text): pos(0){
+      size_t i = 0 ;
+      while (i < text.size()){
+        char c = text[i] ;
+        if (c == '#'){
+          while (i < text.size() && text[i] != '\n')
+            i++ ;
         }
-        else if (cell.compare("states:") == 0){
-          tag = 2 ;
-//          std::cout << "Reading in states...\n" ;
+        else if (isspace((unsigned char)c))
+          i++ ;
+        else if (c == ':'){
+          tokens.push_back(":") ;
+          i++ ;
         }
-        else if (cell.compare("actions:") == 0){
-          tag = 3 ;
-//          std::cout << "Reading in actions...\n" ;
+        else {
+          size_t j = i ;
+          while (j < text.size() && !isspace((unsigned char)text[j]) && text[j] != ':' && text[j] != '#')
+            j++ ;
+          tokens.push_back(text.substr(i, j-i)) ;
+          i = j ;
         }
-        else if (cell.compare("observations:") == 0){
-          tag = 4 ;
-//          std::cout << "Reading in observations...\n" ;
-        }
-        else
-          break ; // ignore all other annotated lines
       }
-      else if (tag == 0)
-        discount = atof(cell.c_str()) ;
-      else if (tag == 1)
-        values = cell ;
-      else if (tag == 2)
-        states.push_back(cell) ;
-      else if (tag == 3)
-        actions.push_back(cell) ;
-      else if (tag == 4)
-        observations.push_back(cell) ;
-      elemNum++ ;
     }
-  }
-  envFile.close() ;
-  
-  // Collect transition functions and observation probabilities
-  size_t lineNum = 0 ;
-  size_t matrixDataRow = -1 ;
-  
-  MatrixXd tContainer ;
-  tContainer.setZero(states.size(),states.size()) ;
-  vector<MatrixXd> tt(actions.size(),tContainer) ;
-  
-  MatrixXd zContainer ;
-  zContainer.setZero(states.size(),observations.size()) ;
-  vector<MatrixXd> zz(actions.size(),zContainer) ;
-  
-  envFile.open(fileName.str().c_str(),std::ios::in) ;
-  int tag = -1 ; // 5: T, 6: O
-  int aInd = -1 ;
-  while (getline(envFile,line)){
-    stringstream lineStream(line) ;
-    string cell ;
     
-    size_t elemNum = 0 ;
-    while (getline(lineStream,cell,' ')){ // space delimiter
-      if (aInd == -1){ // collect information on where to store matrix data
-        if (elemNum == 0){
-          if (cell.compare("T:") == 0){
-            tag = 5 ;
-            matrixDataRow = lineNum ;
-//            std::cout << "\nNew matrix data begins on line: " << matrixDataRow << "\n" ;
-          }
-          else if (cell.compare("O:") == 0){
-            tag = 6 ;
-            matrixDataRow = lineNum ;
-//            std::cout << "\nNew matrix data begins on line: " << matrixDataRow << "\n" ;
-          }
-        }
-        else if (elemNum == 1 && tag > 0){
-          for (size_t i = 0; i < actions.size(); i++){
-            if (cell.compare(actions[i]) == 0){
-              aInd = (int)i ;
-              break ;
-            }
-          }
-        }
-      }
-      else if (tag == 5){
-        size_t i = lineNum - matrixDataRow - 1 ;
-        tt[aInd](i,elemNum) = atof(cell.c_str()) ;
-//        std::cout << cell << ":" ;
-      }
-      else if (tag == 6){
-        size_t i = lineNum - matrixDataRow - 1 ;
-        zz[aInd](i,elemNum) = atof(cell.c_str()) ;
-//        std::cout << cell << ":" ;
+    bool AtEnd(){return pos >= tokens.size() ;}
+    string Peek(size_t k = 0){return (pos+k < tokens.size()) ? tokens[pos+k] : string() ;}
+    string Next(){return AtEnd() ? string() : tokens[pos++] ;}
+    
+    bool Colon(){
+      if (Next() == ":")
+        return true ;
+      std::cout << "Error: expected ':' in .pomdp file near token " << pos << "!\n" ;
+      return false ;
+    }
+    
+    bool Number(double & x){
+      string t = Next() ;
+      char * end ;
+      x = strtod(t.c_str(), &end) ;
+      if (t.empty() || *end != '\0'){
+        std::cout << "Error: expected a number in .pomdp file but found '" << t << "'!\n" ;
+        return false ;
       }
-      elemNum++ ;
+      return true ;
     }
     
-    // tag = {5,6} if at end of matrix, reset tag and aInd to -1
-    if (tag > 0 && lineNum-matrixDataRow >= states.size()){
-      tag = -1 ;
-      aInd = -1 ;
+    // Start of a new preamble or T/O/R entry
+    bool AtKeyword(size_t k = 0){
+      string t = Peek(k) ;
+      if (t == "start")
+        return Peek(k+1) == ":" || Peek(k+1) == "include" || Peek(k+1) == "exclude" ;
+      return Peek(k+1) == ":" && (t == "discount" || t == "values" || t == "states" || t == "actions" || t == "observations" || t == "T" || t == "O" || t == "R") ;
+    }
+  private:
+    vector<string> tokens ;
+    size_t pos ;
+} ;
+
+bool IsCount(const string & t){
+  if (t.empty())
+    return false ;
+  for (size_t i = 0; i < t.size(); i++)
+    if (!isdigit((unsigned char)t[i]))
+      return false ;
+  return true ;
+}
+
+// Names up to the next keyword, a single integer is a count of unnamed elements
+vector<string> ReadNames(PomdpTokens & tok){
+  vector<string> names ;
+  while (!tok.AtEnd() && !tok.AtKeyword())
+    names.push_back(tok.Next()) ;
+  if (names.size() == 1 && IsCount(names[0])){
+    size_t n = atoi(names[0].c_str()) ;
+    names.clear() ;
+    for (size_t i = 0; i < n; i++){
+      stringstream ss ;
+      ss << i ;
+      names.push_back(ss.str()) ;
     }
-    lineNum++ ;
   }
-  // Write to member variables
-  T = tt ;
-  Z = zz ;
-  
-  envFile.close() ;
-  
-  // Loop through for rewards
-  MatrixXd rContainer(actions.size(),observations.size()) ;
-  vector<MatrixXd> r(states.size(),rContainer) ;
-  vector< vector<MatrixXd> > rr(states.size(),r) ;
+  return names ;
+}
+
+// Indices matched by a wildcard, name or index
+bool Resolve(const string & t, const vector<string> & names, vector<size_t> & out){
+  out.clear() ;
+  if (t == "*"){
+    for (size_t i = 0; i < names.size(); i++)
+      out.push_back(i) ;
+    return true ;
+  }
+  for (size_t i = 0; i < names.size(); i++){
+    if (names[i] == t){
+      out.push_back(i) ;
+      return true ;
+    }
+  }
+  if (IsCount(t) && (size_t)atoi(t.c_str()) < names.size()){
+    out.push_back(atoi(t.c_str())) ;
+    return true ;
+  }
+  std::cout << "Error: unknown element '" << t << "' in .pomdp file!\n" ;
+  return false ;
+}
+
+// Later entries overwrite earlier ones, zeros are not stored
+void BuildSparse(vector< Triplet<double> > & entries, size_t rows, size_t cols, SparseRowMatrix & m){
+  vector<size_t> order(entries.size()) ;
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i ;
+  std::stable_sort(order.begin(), order.end(), [&entries](size_t a, size_t b){
+    return entries[a].row() < entries[b].row() || (entries[a].row() == entries[b].row() && entries[a].col() < entries[b].col()) ;
+  }) ;
+  vector< Triplet<double> > last ;
+  for (size_t k = 0; k < order.size(); k++){
+    const Triplet<double> & e = entries[order[k]] ;
+    bool overwritten = k+1 < order.size() && entries[order[k+1]].row() == e.row() && entries[order[k+1]].col() == e.col() ;
+    if (!overwritten && e.value() != 0.0)
+      last.push_back(e) ;
+  }
+  m.resize(rows, cols) ;
+  m.setFromTriplets(last.begin(), last.end()) ;
+  entries.clear() ;
+}
+} // namespace
+
+POMDPEnvironment::POMDPEnvironment(char * fName): discount(1.0), values("reward"){
+  valid = ReadModel(fName) ;
+}
+
+// Single pass over the tokens of the file
+bool POMDPEnvironment::ReadModel(const char * fName){
+  ifstream envFile(fName, std::ios::in | std::ios::binary) ;
+  if (!envFile.is_open()){
+    std::cout << "Error: unable to open " << fName << "!\n" ;
+    return false ;
+  }
+  stringstream text ;
+  text << envFile.rdbuf() ;
+  PomdpTokens tok(text.str()) ;
   
-  envFile.open(fileName.str().c_str(),std::ios::in) ;
-  while (getline(envFile,line)){
-    stringstream lineStream(line) ;
-    string cell ;
-    
-    vector<size_t> s0 ;
-    vector<size_t> s1 ;
-    vector<size_t> a ;
-    vector<size_t> o ;
+  vector< vector< Triplet<double> > > tEntries, zEntries ;
+  bool startGiven = false ;
+  vector<size_t> a, s0, s1, o ;
+  while (!tok.AtEnd()){
+    string key = tok.Next() ;
+    bool sized = !states.empty() && !actions.empty() && !observations.empty() ;
+    if ((key == "T" || key == "O" || key == "R") && !sized){
+      std::cout << "Error: states, actions and observations must be defined before " << key << " entries!\n" ;
+      return false ;
+    }
+    if (sized && tEntries.empty()){
+      tEntries.resize(actions.size()) ;
+      zEntries.resize(actions.size()) ;
+    }
+    size_t nS = states.size() ;
+    size_t nO = observations.size() ;
     
-    size_t elemNum = 0 ;
-    while (getline(lineStream,cell,':')){ // colon delimiter
-      if (elemNum == 0 && cell.compare("R") != 0)
-        break ; // skip line
+    if (key == "discount"){
+      if (!tok.Colon() || !tok.Number(discount))
+        return false ;
+    }
+    else if (key == "values"){
+      if (!tok.Colon())
+        return false ;
+      values = tok.Next() ;
+    }
+    else if (key == "states" || key == "actions" || key == "observations"){
+      if (!tok.Colon())
+        return false ;
+      vector<string> names = ReadNames(tok) ;
+      if (key == "states")
+        states = names ;
+      else if (key == "actions")
+        actions = names ;
+      else
+        observations = names ;
+    }
+    else if (key == "start"){
+      if (states.empty()){
+        std::cout << "Error: states must be defined before the start distribution!\n" ;
+        return false ;
+      }
+      start.setZero(nS) ;
+      startGiven = true ;
+      string mode = tok.Peek() ;
+      if (mode == "include" || mode == "exclude"){
+        tok.Next() ;
+        if (!tok.Colon())
+          return false ;
+        if (mode == "exclude")
+          start.setOnes() ;
+        while (!tok.AtEnd() && !tok.AtKeyword()){
+          if (!Resolve(tok.Next(), states, s0))
+            return false ;
+          for (size_t i = 0; i < s0.size(); i++)
+            start(s0[i]) = (mode == "include") ? 1.0 : 0.0 ;
+        }
+        if (start.sum() > 0.0)
+          start /= start.sum() ;
+      }
       else {
-        if (elemNum == 1){
-          // Remove whitespace
-          string::iterator newEnd = std::remove(cell.begin(), cell.end(), ' ');
-          cell.assign(cell.begin(),newEnd) ;
-//          std::cout << "First element: [" << cell << "]\n" ;
-          if (cell.compare("*") == 0)
-            for (size_t i = 0; i < actions.size(); i++)
-              a.push_back(i) ;
-          else {
-            for (size_t i = 0; i < actions.size(); i++){
-              if (cell.compare(actions[i]) == 0){
-                a.push_back(i) ;
-                break ;
-              }
-            }
-          }
+        if (!tok.Colon())
+          return false ;
+        if (tok.Peek() == "uniform"){
+          tok.Next() ;
+          start.setConstant(1.0/nS) ;
         }
-        else if (elemNum == 2){
-          // Remove whitespace
-          string::iterator newEnd = std::remove(cell.begin(), cell.end(), ' ');
-          cell.assign(cell.begin(),newEnd) ;
-//          std::cout << "Second element: [" << cell << "]\n" ;
-          if (cell.compare("*") == 0)
-            for (size_t i = 0; i < states.size(); i++)
-              s0.push_back(i) ;
-          else {
-            for (size_t i = 0; i < states.size(); i++){
-              if (cell.compare(states[i]) == 0){
-                s0.push_back(i) ;
-                break ;
-              }
-            }
-          }
+        else if (nS > 1 && (tok.Peek(1).empty() || tok.AtKeyword(1))){ // a single state
+          if (!Resolve(tok.Next(), states, s0))
+            return false ;
+          start(s0[0]) = 1.0 ;
         }
-        else if (elemNum == 3){
-          // Remove whitespace
-          string::iterator newEnd = std::remove(cell.begin(), cell.end(), ' ');
-          cell.assign(cell.begin(),newEnd) ;
-//          std::cout << "Third element: [" << cell << "]\n" ;
-          if (cell.compare("*") == 0)
-            for (size_t i = 0; i < states.size(); i++)
-              s1.push_back(i) ;
-          else {
-            for (size_t i = 0; i < states.size(); i++){
-              if (cell.compare(states[i]) == 0){
-                s1.push_back(i) ;
-                break ;
-              }
-            }
+        else {
+          for (size_t i = 0; i < nS; i++)
+            if (!tok.Number(start(i)))
+              return false ;
+        }
+      }
+    }
+    else if (key == "T" || key == "O"){
+      bool isT = (key == "T") ;
+      size_t nCols = isT ? nS : nO ;
+      vector< vector< Triplet<double> > > & entries = isT ? tEntries : zEntries ;
+      if (!tok.Colon() || !Resolve(tok.Next(), actions, a))
+        return false ;
+      if (tok.Peek() == ":"){
+        tok.Next() ;
+        if (!Resolve(tok.Next(), states, s0))
+          return false ;
+        if (tok.Peek() == ":"){ // single entry
+          tok.Next() ;
+          double p ;
+          if (!Resolve(tok.Next(), isT ? states : observations, s1) || !tok.Number(p))
+            return false ;
+          for (size_t i = 0; i < a.size(); i++)
+            for (size_t j = 0; j < s0.size(); j++)
+              for (size_t k = 0; k < s1.size(); k++)
+                entries[a[i]].push_back(Triplet<double>(s0[j], s1[k], p)) ;
+        }
+        else { // one row
+          VectorXd row(nCols) ;
+          if (tok.Peek() == "uniform"){
+            tok.Next() ;
+            row.setConstant(1.0/nCols) ;
           }
+          else
+            for (size_t k = 0; k < nCols; k++)
+              if (!tok.Number(row(k)))
+                return false ;
+          for (size_t i = 0; i < a.size(); i++)
+            for (size_t j = 0; j < s0.size(); j++)
+              for (size_t k = 0; k < nCols; k++)
+                entries[a[i]].push_back(Triplet<double>(s0[j], k, row(k))) ;
         }
-        else if (elemNum == 4){
-//          std::cout << "Fourth element: [" << cell << "]\n" ;
-          stringstream ss(cell) ;
-          string sCell ;
-          size_t eNum = 0 ;
-          while (getline(ss,sCell,' ')){
-//            std::cout << "eNum: " << eNum << ", sCell: [" << sCell << "]\n" ;
-            if (eNum == 0){
-//              std::cout << "sCell: [" << sCell << "]\n" ;
-              if (sCell.compare("*") == 0){
-                eNum++ ;
-                for (size_t i = 0; i < observations.size(); i++)
-                  o.push_back(i) ;
-              }
-              else {
-                for (size_t i = 0; i < observations.size(); i++){
-                  if (sCell.compare(observations[i]) == 0){
-                    o.push_back(i) ;
-                    eNum++ ;
-                    break ;
-                  }
-                }
-              }
-            }
-            else {
-//              std::cout << "s0.size(): " << s0.size() << ", s1.size(): " << s1.size() << ", a.size(): " << a.size() << ", o.size(): " << o.size() << "\n" ;
-//              std::cout << "s0[0]: " << s0[0] << ", s1[0]: " << s1[0] << ", s1[1]: " << s1[1] << ", a[0]: " << a[0] << ", o[0]: " << o[0] << ", sCell: " << atof(sCell.c_str()) << "\n" ;
-              for (size_t i = 0; i < s0.size(); i++)
-                for (size_t j = 0; j < s1.size(); j++)
-                  for (size_t k = 0; k < a.size(); k++)
-                    for (size_t l = 0; l < o.size(); l++)
-                      rr[s0[i]][s1[j]](a[k],o[l]) = atof(sCell.c_str()) ;
-              eNum++ ;
-            }
+      }
+      else { // whole matrix
+        string shorthand = tok.Peek() ;
+        if (shorthand == "uniform" || (isT && shorthand == "identity")){
+          tok.Next() ;
+          for (size_t i = 0; i < a.size(); i++)
+            for (size_t j = 0; j < nS; j++)
+              for (size_t k = 0; k < nCols; k++)
+                entries[a[i]].push_back(Triplet<double>(j, k, (shorthand == "uniform") ? 1.0/nCols : (j == k ? 1.0 : 0.0))) ;
+        }
+        else {
+          MatrixXd m(nS, nCols) ;
+          for (size_t j = 0; j < nS; j++)
+            for (size_t k = 0; k < nCols; k++)
+              if (!tok.Number(m(j,k)))
+                return false ;
+          for (size_t i = 0; i < a.size(); i++)
+            for (size_t j = 0; j < nS; j++)
+              for (size_t k = 0; k < nCols; k++)
+                entries[a[i]].push_back(Triplet<double>(j, k, m(j,k))) ;
+        }
+      }
+    }
+    else if (key == "R"){
+      if (!tok.Colon() || !Resolve(tok.Next(), actions, a) || !tok.Colon() || !Resolve(tok.Next(), states, s0))
+        return false ;
+      MatrixXd m ; // rewards for each transitioned state and observation, NaN where not given
+      m.setConstant(nS, nO, std::numeric_limits<double>::quiet_NaN()) ;
+      if (tok.Peek() == ":"){
+        tok.Next() ;
+        if (!Resolve(tok.Next(), states, s1))
+          return false ;
+        if (tok.Peek() == ":"){ // single entry
+          tok.Next() ;
+          double r ;
+          if (!Resolve(tok.Next(), observations, o) || !tok.Number(r))
+            return false ;
+          for (size_t k = 0; k < s1.size(); k++)
+            for (size_t l = 0; l < o.size(); l++)
+              m(s1[k], o[l]) = r ;
+        }
+        else { // one row over observations
+          for (size_t l = 0; l < nO; l++){
+            double r ;
+            if (!tok.Number(r))
+              return false ;
+            for (size_t k = 0; k < s1.size(); k++)
+              m(s1[k], l) = r ;
           }
         }
       }
-      elemNum++ ;
+      else { // transitioned state by observation matrix
+        for (size_t k = 0; k < nS; k++)
+          for (size_t l = 0; l < nO; l++)
+            if (!tok.Number(m(k,l)))
+              return false ;
+      }
+      for (size_t i = 0; i < a.size(); i++)
+        for (size_t j = 0; j < s0.size(); j++)
+          for (size_t k = 0; k < nS; k++)
+            for (size_t l = 0; l < nO; l++){
+              if (m(k,l) != m(k,l))
+                continue ; // not given
+              if (m(k,l) == 0.0)
+                R.erase(RewardKey(a[i], s0[j], k, l)) ;
+              else
+                R[RewardKey(a[i], s0[j], k, l)] = m(k,l) ;
+            }
+    }
+    else {
+      std::cout << "Error: unexpected '" << key << "' in " << fName << "!\n" ;
+      return false ;
     }
   }
-  R = rr ; // write to reward member variable
   
-//  for (size_t i = 0; i < rr.size(); i++){
-//    for (size_t j = 0; j < rr[i].size(); j++){
-//      for (int k = 0; k < rr[i][j].rows(); k++){
-//        for (int l = 0; l < rr[i][j].cols(); l++){
-//          std::cout << rr[i][j](k,l) << " " ;
-//        }
-//        std::cout << "\n" ;
-//      }
-//      std::cout << "\n" ;
-//    }
-//    std::cout << "\n" ;
-//  }
+  if (states.empty() || actions.empty() || observations.empty()){
+    std::cout << "Error: " << fName << " does not define states, actions and observations!\n" ;
+    return false ;
+  }
+  tEntries.resize(actions.size()) ;
+  zEntries.resize(actions.size()) ;
+  T.resize(actions.size()) ;
+  Z.resize(actions.size()) ;
+  for (size_t i = 0; i < actions.size(); i++){
+    BuildSparse(tEntries[i], states.size(), states.size(), T[i]) ;
+    BuildSparse(zEntries[i], states.size(), observations.size(), Z[i]) ;
+  }
+  BuildTransposes() ;
+  if (!startGiven)
+    start.setConstant(states.size(), 1.0/states.size()) ;
+  return true ;
+}
 
-  
-  envFile.close() ;
+// Transposed copies so a belief update reads whole rows
+void POMDPEnvironment::BuildTransposes(){
+  TT.resize(T.size()) ;
+  ZT.resize(Z.size()) ;
+  for (size_t i = 0; i < T.size(); i++){
+    TT[i] = T[i].transpose() ;
+    ZT[i] = Z[i].transpose() ;
+  }
+}
+
+double POMDPEnvironment::GetReward(size_t a, size_t s0, size_t s1, size_t o){
+  auto found = R.find(RewardKey(a, s0, s1, o)) ;
+  return (found == R.end()) ? 0.0 : found->second ;
+}
+
+vector<MatrixXd> POMDPEnvironment::GetTransitions(){
+  vector<MatrixXd> tt ;
+  for (size_t i = 0; i < T.size(); i++)
+    tt.push_back(MatrixXd(T[i])) ;
+  return tt ;
+}
+
+vector<MatrixXd> POMDPEnvironment::GetObservationProbabilities(){
+  vector<MatrixXd> zz ;
+  for (size_t i = 0; i < Z.size(); i++)
+    zz.push_back(MatrixXd(Z[i])) ;
+  return zz ;
+}
+
+vector< vector<MatrixXd> > POMDPEnvironment::GetRewards(){
+  MatrixXd rContainer ;
+  rContainer.setZero(actions.size(),observations.size()) ;
+  vector<MatrixXd> r(states.size(),rContainer) ;
+  vector< vector<MatrixXd> > rr(states.size(),r) ;
+  for (size_t a = 0; a < actions.size(); a++)
+    for (size_t s0 = 0; s0 < states.size(); s0++)
+      for (size_t s1 = 0; s1 < states.size(); s1++)
+        for (size_t o = 0; o < observations.size(); o++)
+          rr[s0][s1](a,o) = GetReward(a, s0, s1, o) ;
+  return rr ;
 }
 
 VectorXd POMDPEnvironment::UpdateBelief(VectorXd b, size_t aInd, size_t oInd){
   VectorXd belief ;
+  if (!UpdateBelief(b, aInd, oInd, belief))
+    belief.setConstant(states.size(), std::numeric_limits<double>::quiet_NaN()) ;
+  return belief ;
+}
+
+// Only transitioned states that can emit the observation are visited, each
+// takes one sparse row times the dense belief, and the normalising total is
+// accumulated on the way
+bool POMDPEnvironment::UpdateBelief(const VectorXd & b, size_t aInd, size_t oInd, VectorXd & belief){
   belief.setZero(states.size()) ;
-  for (size_t i = 0; i < states.size(); i++){
-    double pOPrime = Z[aInd](i,oInd) ;
-    double summation = 0.0 ;
-    for (size_t j = 0; j < states.size(); j++){
-      double pSPrime = T[aInd](j,i) ;
-      double bS = b[j] ;
-      summation += pSPrime*bS ;
-    }
-    belief(i) = pOPrime * summation ;
+  double total = 0.0 ;
+  for (SparseRowMatrix::InnerIterator z(ZT[aInd], oInd); z; ++z){
+    double p = z.value() * TT[aInd].row(z.col()).dot(b) ;
+    belief(z.col()) = p ;
+    total += p ;
   }
-  
-  // Normalise belief
-  double total = belief.sum() ;
-  belief /= total ;
-  
-  return belief ;
+  if (total <= 0.0)
+    return false ;
+  belief *= 1.0/total ;
+  return true ;
 }
@@ -8,7 +8,9 @@
 #include <algorithm>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <Eigen/Eigen>
+#include <Eigen/Sparse>
 
 using std::string ;
 using std::getline ;
@@ -17,30 +19,62 @@ using std::ifstream ;
 using std::vector ;
 using namespace Eigen ;
 
+typedef SparseMatrix<double, RowMajor> SparseRowMatrix ;
+
+// POMDP model read from a file in Cassandra's .pomdp format. The file is read
+// once and split into tokens; T, O and R entries may appear in any order and
+// any number of times (later entries overwrite earlier ones), with * wildcards,
+// element names or indices, and the uniform and identity shorthands.
+// Transition and observation probabilities are stored as one sparse matrix
+// per action and only the rewards that are specified are stored.
 class POMDPEnvironment{
   public:
     POMDPEnvironment(char *) ;
     ~POMDPEnvironment(){}
     
+    bool IsValid(){return valid ;} // false if the file could not be read or parsed
+    
     VectorXd UpdateBelief(VectorXd, size_t, size_t) ;
+    // Writes the updated belief into a caller's buffer (which must not be the
+    // input belief), returns false if the observation has zero probability
+    bool UpdateBelief(const VectorXd &, size_t, size_t, VectorXd &) ;
     
     double GetDiscount(){return discount ;}
     string GetValues(){return values ;}
     vector<string> GetStates(){return states ;}
     vector<string> GetActions(){return actions ;}
     vector<string> GetObservations(){return observations ;}
-    vector<MatrixXd> GetTransitions(){return T ;}
-    vector<MatrixXd> GetObservationProbabilities(){return Z ;}
-    vector< vector<MatrixXd> > GetRewards(){return R ;} ;
+    VectorXd GetInitialBelief(){return start ;}
+    
+    const SparseRowMatrix & GetTransitions(size_t a){return T[a] ;} // initial state, transitioned state
+    const SparseRowMatrix & GetObservationProbabilities(size_t a){return Z[a] ;} // transitioned state, observation
+    double GetReward(size_t a, size_t s0, size_t s1, size_t o) ; // 0 if not specified
+    size_t GetNumRewards(){return R.size() ;}
+    
+    // Dense copies (legacy)
+    vector<MatrixXd> GetTransitions() ;
+    vector<MatrixXd> GetObservationProbabilities() ;
+    vector< vector<MatrixXd> > GetRewards() ; // initial state, transitioned state, action, observation
   private:
+    friend class POMDPCache ;
+    POMDPEnvironment(): valid(false), discount(1.0){} // filled in by POMDPCache
+    
+    bool valid ;
     double discount ;
     string values ;
     vector<string> states ;
     vector<string> actions ;
     vector<string> observations ;
+    VectorXd start ;
+    
+    vector<SparseRowMatrix> T ; // action, initial state, transitioned state
+    vector<SparseRowMatrix> Z ; // action, transitioned state, observation
+    vector<SparseRowMatrix> TT ; // action, transitioned state, initial state
+    vector<SparseRowMatrix> ZT ; // action, observation, transitioned state
+    std::unordered_map<unsigned long long, double> R ; // packed (action, initial state, transitioned state, observation)
     
-    vector<MatrixXd> T ; // action, initial state, transitioned state
-    vector<MatrixXd> Z ; // action, initial state, observation
-    vector< vector<MatrixXd> > R ; // initial state, transitioned state, action, observation
+    bool ReadModel(const char *) ;
+    void BuildTransposes() ;
+    unsigned long long RewardKey(size_t a, size_t s0, size_t s1, size_t o){return ((a*states.size() + s0)*states.size() + s1)*observations.size() + o ;}
 } ;
 #endif // POMDP_ENVIRONMENT_H_
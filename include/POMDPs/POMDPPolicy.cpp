@@ -1,15 +1,101 @@
+#include <cstdlib>
+#include <cmath>
+#include <limits>
 #include "POMDPPolicy.h"
 
+namespace {
+// Largest margin by which alpha vector v beats every row of 'others' at some
+// belief, found with the simplex method. Variables are the belief b and the
+// margin d, both non-negative, with d + b.(u - v) <= 0 for each other vector
+// u and sum(b) <= 1. The origin is feasible so no first phase is needed, and
+// the tableau is kept in dictionary form (one column per non-basic variable)
+// so its size grows only with the number of vectors. Bland's rule prevents
+// cycling.
+double MaxMargin(const VectorXd & v, const MatrixXd & others){
+  size_t n = v.size() + 1 ; // belief entries, then margin
+  size_t m = others.rows() + 1 ;
+  MatrixXd D(m+1, n+1) ; // constraint rows then objective row, last column is the right hand side
+  D.setZero() ;
+  for (size_t i = 0; i < (size_t)others.rows(); i++){
+    D.block(i, 0, 1, v.size()) = (others.row(i) - v.transpose()) ;
+    D(i, n-1) = 1.0 ;
+  }
+  D.block(m-1, 0, 1, v.size()).setOnes() ;
+  D(m-1, n) = 1.0 ;
+  D(m, n-1) = -1.0 ; // maximise the margin
+  vector<size_t> basic(m), nonBasic(n) ;
+  for (size_t i = 0; i < m; i++)
+    basic[i] = n + i ;
+  for (size_t j = 0; j < n; j++)
+    nonBasic[j] = j ;
+  
+  const double eps = 1e-12 ;
+  while (true){
+    // Entering variable: smallest label with a negative reduced cost
+    size_t col = n ;
+    for (size_t j = 0; j < n; j++)
+      if (D(m,j) < -eps && (col == n || nonBasic[j] < nonBasic[col]))
+        col = j ;
+    if (col == n)
+      break ;
+    // Leaving variable: minimum ratio, ties broken by smallest label
+    size_t row = m ;
+    for (size_t i = 0; i < m; i++){
+      if (D(i,col) <= eps)
+        continue ;
+      if (row == m)
+        row = i ;
+      else {
+        double lhs = D(i,n)*D(row,col) ;
+        double rhs = D(row,n)*D(i,col) ;
+        if (lhs < rhs - eps || (std::fabs(lhs - rhs) <= eps && basic[i] < basic[row]))
+          row = i ;
+      }
+    }
+    if (row == m)
+      return std::numeric_limits<double>::infinity() ; // unbounded, no other vectors limit v
+    
+    // Pivot
+    double inv = 1.0/D(row,col) ;
+    for (size_t i = 0; i <= m; i++){
+      if (i == row || D(i,col) == 0.0)
+        continue ;
+      double f = D(i,col)*inv ;
+      D.row(i) -= f*D.row(row) ;
+      D(i,col) = -f ;
+    }
+    D.row(row) *= inv ;
+    D(row,col) = inv ;
+    std::swap(basic[row], nonBasic[col]) ;
+  }
+  return D(m,n) ;
+}
+} // namespace
+
 POMDPPolicy::POMDPPolicy(char * fName){
-  // Filename to write to stored in fName
-	stringstream fileName ;
-  fileName << fName ;
-  ifstream policyFile ;
-  policyFile.open(fileName.str().c_str(),std::ios::in) ;
+  ifstream policyFile(fName, std::ios::in | std::ios::binary) ;
+  if (!policyFile.is_open()){
+    std::cout << "Error: unable to open " << fName << "!\n" ;
+    valid = false ;
+    return ;
+  }
+  stringstream text ;
+  text << policyFile.rdbuf() ;
   
-  // Data format: [actionNum, vector<pBeliefState>]
+  if (text.str().find("<Vector") != string::npos)
+    valid = ReadXML(text.str()) ;
+  else
+    valid = ReadCSV(text.str()) ;
+}
+
+// Data format: [actionNum, vector<pBeliefState>]
+bool POMDPPolicy::ReadCSV(const string & text){
+  stringstream policyStream(text) ;
+  vector< vector<double> > rows ;
   string line ;
-  while (getline(policyFile,line)){
+  while (getline(policyStream,line)){
+    if (line.find_first_not_of(" \t\r") == string::npos)
+      continue ;
     stringstream lineStream(line) ;
     string cell ;
   
@@ -22,25 +108,138 @@ POMDPPolicy::POMDPPolicy(char * fName){
         b.push_back(atof(cell.c_str())) ;
       elemNum++ ;
     }
-    VectorXd bb ;
-    bb.setZero(b.size()) ;
-    for (size_t i = 0; i < b.size(); i++)
-      bb(i) = b[i] ;
-    pMatrix.push_back(bb) ;
-  }
-}
-
-size_t POMDPPolicy::GetBestAction(VectorXd belief){
-  VectorXd res ;
-  res.setZero(pMatrix.size()) ;
-  double resMax = DBL_MIN ;
-  size_t maxInd = -1 ;
-  for (size_t i = 0; i < pMatrix.size(); i++){
-    res(i) = pMatrix[i].dot(belief) ;
-    if (res(i) > resMax){
-      resMax = res(i) ;
-      maxInd = i ;
+    rows.push_back(b) ;
+  }
+  if (rows.empty() || rows[0].empty()){
+    std::cout << "Error: policy file contains no alpha vectors!\n" ;
+    return false ;
+  }
+  for (size_t i = 1; i < rows.size(); i++){
+    if (rows[i].size() != rows[0].size()){
+      std::cout << "Error: alpha vector " << i << " has length " << rows[i].size() << " instead of " << rows[0].size() << "!\n" ;
+      return false ;
+    }
+  }
+  SetAlphas(rows) ;
+  return true ;
+}
+
+// Data format: <Vector action="a" obsValue="0">alpha vector </Vector>
+bool POMDPPolicy::ReadXML(const string & text){
+  vector< vector<double> > rows ;
+  size_t vectorLength = 0 ;
+  size_t header = text.find("vectorLength=\"") ;
+  if (header != string::npos)
+    vectorLength = atoi(text.c_str() + header + 14) ;
+  
+  size_t pos = text.find("<Vector") ;
+  while (pos != string::npos){
+    size_t tagEnd = text.find('>', pos) ;
+    size_t close = text.find("</Vector>", pos) ;
+    size_t action = text.find("action=\"", pos) ;
+    if (tagEnd == string::npos || close == string::npos || action == string::npos || action > tagEnd){
+      std::cout << "Error: malformed <Vector> entry in policy file!\n" ;
+      return false ;
+    }
+    actionNums.push_back(atoi(text.c_str() + action + 8)) ;
+    
+    stringstream values(text.substr(tagEnd+1, close-tagEnd-1)) ;
+    vector<double> b ;
+    double x ;
+    while (values >> x)
+      b.push_back(x) ;
+    if (vectorLength == 0)
+      vectorLength = b.size() ;
+    if (b.size() != vectorLength || vectorLength == 0){
+      std::cout << "Error: alpha vector " << rows.size() << " has length " << b.size() << " instead of " << vectorLength << "!\n" ;
+      return false ;
+    }
+    rows.push_back(b) ;
+    pos = text.find("<Vector", close) ;
+  }
+  if (rows.empty()){
+    std::cout << "Error: policy file contains no alpha vectors!\n" ;
+    return false ;
+  }
+  SetAlphas(rows) ;
+  return true ;
+}
+
+void POMDPPolicy::SetAlphas(const vector< vector<double> > & rows){
+  alphas.resize(rows.size(), rows[0].size()) ;
+  for (size_t i = 0; i < rows.size(); i++)
+    for (size_t j = 0; j < rows[i].size(); j++)
+      alphas(i,j) = rows[i][j] ;
+}
+
+void POMDPPolicy::KeepRows(const vector<size_t> & keep){
+  MatrixXd kept(keep.size(), alphas.cols()) ;
+  vector<size_t> keptActions(keep.size()) ;
+  for (size_t i = 0; i < keep.size(); i++){
+    kept.row(i) = alphas.row(keep[i]) ;
+    keptActions[i] = actionNums[keep[i]] ;
+  }
+  alphas.swap(kept) ;
+  actionNums.swap(keptActions) ;
+}
+
+size_t POMDPPolicy::PruneDominated(){
+  size_t before = actionNums.size() ;
+  
+  // Pointwise: a vector no better than another anywhere, of identical vectors
+  // the first is kept
+  vector<size_t> keep ;
+  for (size_t i = 0; i < before; i++){
+    bool dominated = false ;
+    for (size_t j = 0; j < before && !dominated; j++){
+      if (i == j)
+        continue ;
+      bool geq = (alphas.row(j).array() >= alphas.row(i).array()).all() ;
+      dominated = geq && (j < i || (alphas.row(j).array() > alphas.row(i).array()).any()) ;
     }
+    if (!dominated)
+      keep.push_back(i) ;
+  }
+  KeepRows(keep) ;
+  
+  // Linear program: a vector that never beats the others by a positive margin
+  // is removed, later checks are against the vectors still kept
+  double tol = 1e-9*std::max(1.0, alphas.cwiseAbs().maxCoeff()) ;
+  vector<bool> kept(actionNums.size(), true) ;
+  for (size_t i = 0; i < actionNums.size() && actionNums.size() > 1; i++){
+    MatrixXd others(actionNums.size(), alphas.cols()) ;
+    size_t numOthers = 0 ;
+    for (size_t j = 0; j < actionNums.size(); j++)
+      if (j != i && kept[j])
+        others.row(numOthers++) = alphas.row(j) ;
+    if (numOthers == 0)
+      break ;
+    if (MaxMargin(alphas.row(i).transpose(), others.topRows(numOthers)) <= tol)
+      kept[i] = false ;
+  }
+  keep.clear() ;
+  for (size_t i = 0; i < kept.size(); i++)
+    if (kept[i])
+      keep.push_back(i) ;
+  KeepRows(keep) ;
+  
+  return before - actionNums.size() ;
+}
+
+vector<VectorXd> POMDPPolicy::GetPolicyMatrix(){
+  vector<VectorXd> pMatrix ;
+  for (size_t i = 0; i < (size_t)alphas.rows(); i++)
+    pMatrix.push_back(alphas.row(i).transpose()) ;
+  return pMatrix ;
+}
+
+// Of equally valued alpha vectors the first is chosen
+size_t POMDPPolicy::GetBestAction(const VectorXd & belief){
+  if (actionNums.empty()){
+    std::cout << "Error: policy contains no alpha vectors!\n" ;
+    return 0 ;
   }
+  VectorXd::Index maxInd ;
+  (alphas*belief).maxCoeff(&maxInd) ;
   return actionNums[maxInd] ;
 }
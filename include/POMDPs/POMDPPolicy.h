@@ -4,8 +4,8 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <iostream>
 #include <string>
-#include <float.h>
 #include <vector>
 #include <Eigen/Eigen>
 
@@ -16,17 +16,39 @@ using std::ifstream ;
 using std::vector ;
 using namespace Eigen ;
 
+// Alpha vector policy read from either the CSV form (action, alpha vector per
+// line) or the XML form written by the solver (<Vector action="a"> entries).
+// The alpha vectors are held as the rows of one matrix so the best action for
+// a belief is a single matrix-vector product and argmax.
 class POMDPPolicy{
   public:
     POMDPPolicy(char *) ;
     ~POMDPPolicy(){}
     
-    size_t GetBestAction(VectorXd) ;
+    bool IsValid(){return valid ;} // false if the file could not be read or parsed
     
+    size_t GetBestAction(const VectorXd &) ;
+    
+    // Offline pass removing alpha vectors that are pointwise dominated or that
+    // are not strictly best at any belief (checked with a linear program),
+    // neither changes the value of any belief. Returns the number removed.
+    size_t PruneDominated() ;
+    
+    size_t GetNumVectors(){return actionNums.size() ;}
+    const MatrixXd & GetAlphaMatrix(){return alphas ;} // one alpha vector per row
     vector<size_t> GetActionVector(){return actionNums ;}
-    vector<VectorXd> GetPolicyMatrix(){return pMatrix ;}
+    vector<VectorXd> GetPolicyMatrix() ; // legacy copy of the rows
   private:
+    friend class POMDPCache ;
+    POMDPPolicy(): valid(false){} // filled in by POMDPCache
+    
+    bool valid ;
     vector<size_t> actionNums ;
-    vector<VectorXd> pMatrix ;
+    MatrixXd alphas ;
+    
+    bool ReadCSV(const string &) ;
+    bool ReadXML(const string &) ;
+    void SetAlphas(const vector< vector<double> > &) ;
+    void KeepRows(const vector<size_t> &) ;
 } ;
 #endif // POMDP_POLICY_H_
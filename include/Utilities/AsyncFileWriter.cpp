@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "AsyncFileWriter.h"
+
+AsyncFileWriter::AsyncFileWriter(): hasPending(false), busy(false), stop(false){}
+
+AsyncFileWriter::~AsyncFileWriter(){
+  {
+    std::unique_lock<std::mutex> guard(lock) ;
+    stop = true ;
+  }
+  signal.notify_all() ;
+  if (worker.joinable())
+    worker.join() ;
+}
+
+void AsyncFileWriter::Write(std::string fileName, std::string data){
+  {
+    std::unique_lock<std::mutex> guard(lock) ;
+    pendingFile.swap(fileName) ;
+    pendingData.swap(data) ;
+    hasPending = true ;
+    if (!worker.joinable())
+      worker = std::thread(&AsyncFileWriter::Run, this) ;
+  }
+  signal.notify_all() ;
+}
+
+void AsyncFileWriter::Flush(){
+  std::unique_lock<std::mutex> guard(lock) ;
+  signal.wait(guard, [this]{ return !hasPending && !busy ; }) ;
+}
+
+void AsyncFileWriter::Run(){
+  std::unique_lock<std::mutex> guard(lock) ;
+  while (true){
+    signal.wait(guard, [this]{ return hasPending || stop ; }) ;
+    if (!hasPending && stop)
+      break ;
+    
+    std::string fileName, data ;
+    fileName.swap(pendingFile) ;
+    data.swap(pendingData) ;
+    hasPending = false ;
+    busy = true ;
+    guard.unlock() ;
+    
+    std::string tempName = fileName + ".tmp" ;
+    std::ofstream out(tempName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc) ;
+    out.write(data.data(), data.size()) ;
+    out.close() ;
+    if (out.fail() || std::rename(tempName.c_str(), fileName.c_str()) != 0)
+      std::cout << "Error: unable to write " << fileName << "!\n" ;
+    
+    guard.lock() ;
+    busy = false ;
+    signal.notify_all() ;
+  }
+}
@@ -0,0 +1,36 @@
+// Writes buffers to disk on a background thread so that the caller does not
+// block on file IO. The thread is only started by the first Write.
+#ifndef ASYNC_FILE_WRITER_H_
+#define ASYNC_FILE_WRITER_H_
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class AsyncFileWriter{
+  public:
+    AsyncFileWriter() ;
+    ~AsyncFileWriter() ; // flushes any pending write
+    
+    // Queue data to be written to fileName. The file is written to a temporary
+    // name and renamed once complete, so a reader never sees a partial file.
+    // If a previous write has not started yet it is replaced by this one.
+    void Write(std::string fileName, std::string data) ;
+    
+    // Block until all queued data is on disk
+    void Flush() ;
+  private:
+    std::thread worker ;
+    std::mutex lock ;
+    std::condition_variable signal ;
+    
+    std::string pendingFile ;
+    std::string pendingData ;
+    bool hasPending ;
+    bool busy ;
+    bool stop ;
+    
+    void Run() ;
+} ;
+#endif // ASYNC_FILE_WRITER_H_
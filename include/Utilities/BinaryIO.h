@@ -0,0 +1,126 @@
+// Helpers for reading and writing plain binary records
+#ifndef BINARY_IO_H_
+#define BINARY_IO_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace easyio{
+// Write/read a single trivially copyable value
+template<typename T>
+void write_binary(std::ostream & out, const T & value){
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T)) ;
+}
+
+template<typename T>
+bool read_binary(std::istream & in, T & value){
+  in.read(reinterpret_cast<char *>(&value), sizeof(T)) ;
+  return in.good() ;
+}
+
+// Stored lengths are not trusted: a length of n elements of the given size is
+// only accepted if that many bytes are left in the stream (or, when the stream
+// cannot seek, if they amount to at most 1GB), so a corrupt file cannot cause
+// a huge allocation. A rejected length sets the stream's failbit.
+inline bool length_fits(std::istream & in, unsigned long long n, size_t size){
+  const unsigned long long unseekable = 1ULL << 30 ;
+  std::streampos pos = in.tellg() ;
+  unsigned long long left = unseekable ;
+  if (pos >= 0){
+    in.seekg(0, std::ios::end) ;
+    std::streampos end = in.tellg() ;
+    in.seekg(pos) ;
+    if (end >= pos)
+      left = static_cast<unsigned long long>(end - pos) ;
+    else
+      left = 0 ;
+  }
+  if (n <= left/size)
+    return true ;
+  in.setstate(std::ios::failbit) ;
+  return false ;
+}
+
+// r = a*b and r = a+b, false on overflow
+inline bool checked_multiply(unsigned long long a, unsigned long long b, unsigned long long & r){
+  if (a != 0 && b > ~0ULL/a)
+    return false ;
+  r = a*b ;
+  return true ;
+}
+
+inline bool checked_add(unsigned long long a, unsigned long long b, unsigned long long & r){
+  if (b > ~0ULL - a)
+    return false ;
+  r = a+b ;
+  return true ;
+}
+
+// A section of count items of itemSize bytes at an 8 byte aligned offset ends
+// at or before limit. Sizes read from a file are untrusted, so nothing may
+// overflow.
+inline bool section_fits(unsigned long long offset, unsigned long long count, unsigned long long itemSize, unsigned long long limit){
+  unsigned long long bytes, end ;
+  return offset % 8 == 0 && checked_multiply(count, itemSize, bytes) && checked_add(offset, bytes, end) && end <= limit ;
+}
+
+// Vectors of trivially copyable values are stored as a uint64 length followed
+// by the raw elements
+template<typename T>
+void write_binary(std::ostream & out, const std::vector<T> & v){
+  write_binary(out, static_cast<unsigned long long>(v.size())) ;
+  if (!v.empty())
+    out.write(reinterpret_cast<const char *>(&v[0]), v.size()*sizeof(T)) ;
+}
+
+template<typename T>
+bool read_binary(std::istream & in, std::vector<T> & v){
+  unsigned long long n ;
+  if (!read_binary(in, n) || !length_fits(in, n, sizeof(T)))
+    return false ;
+  v.resize(n) ;
+  if (n > 0)
+    in.read(reinterpret_cast<char *>(&v[0]), n*sizeof(T)) ;
+  return in.good() ;
+}
+
+inline void write_binary(std::ostream & out, const std::string & s){
+  write_binary(out, static_cast<unsigned long long>(s.size())) ;
+  out.write(s.data(), s.size()) ;
+}
+
+inline bool read_binary(std::istream & in, std::string & s){
+  unsigned long long n ;
+  if (!read_binary(in, n) || !length_fits(in, n, 1))
+    return false ;
+  s.resize(n) ;
+  if (n > 0)
+    in.read(&s[0], n) ;
+  return in.good() ;
+}
+
+// Dense Eigen matrices are stored as rows, cols and column-major coefficients
+template<typename M>
+void write_matrix(std::ostream & out, const M & m){
+  write_binary(out, static_cast<long long>(m.rows())) ;
+  write_binary(out, static_cast<long long>(m.cols())) ;
+  out.write(reinterpret_cast<const char *>(m.data()),
+            m.size()*sizeof(typename M::Scalar)) ;
+}
+
+template<typename M>
+bool read_matrix(std::istream & in, M & m){
+  long long rows, cols ;
+  if (!read_binary(in, rows) || !read_binary(in, cols) || rows < 0 || cols < 0)
+    return false ;
+  if (rows > 0 && cols > 0 && (!length_fits(in, cols, sizeof(typename M::Scalar)) ||
+                   !length_fits(in, rows, cols*sizeof(typename M::Scalar))))
+    return false ;
+  m.resize(rows, cols) ;
+  in.read(reinterpret_cast<char *>(m.data()),
+          m.size()*sizeof(typename M::Scalar)) ;
+  return in.good() ;
+}
+} // namespace easyio
+#endif // BINARY_IO_H_
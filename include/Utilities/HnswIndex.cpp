@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include "HnswIndex.h"
+
+HnswIndex::HnswIndex(size_t d, size_t m, size_t efC, unsigned seed): dim(d), M(std::max(m, (size_t)2)), maxM0(2*M), efConstruction(std::max(efC, M)), efSearch(50), levelScale(1.0/std::log((double)M)), levelGenerator(seed), entry(-1), topLevel(-1){}
+
+void HnswIndex::Build(const std::vector<double> & points){
+  Clear() ;
+  size_t n = points.size()/dim ;
+  coords.reserve(points.size()) ;
+  levels.reserve(n) ;
+  links.reserve(n) ;
+  for (size_t i = 0; i < n; i++)
+    Insert(&points[i*dim]) ;
+}
+
+void HnswIndex::Clear(){
+  coords.clear() ;
+  levels.clear() ;
+  links.clear() ;
+  entry = -1 ;
+  topLevel = -1 ;
+}
+
+double HnswIndex::SqDist(const double * q, size_t i) const{
+  const double * p = &coords[i*dim] ;
+  double d = 0.0 ;
+  for (size_t a = 0; a < dim; a++)
+    d += (q[a]-p[a])*(q[a]-p[a]) ;
+  return d ;
+}
+
+size_t HnswIndex::Insert(const double * p){
+  size_t id = Size() ;
+  coords.insert(coords.end(), p, p+dim) ;
+  const double * q = &coords[id*dim] ; // p may not outlive a reallocation of coords
+
+  // Exponentially decaying layer assignment
+  std::uniform_real_distribution<double> unif(0.0, 1.0) ;
+  double u = std::max(unif(levelGenerator), 1e-12) ;
+  int level = (int)std::floor(-std::log(u)*levelScale) ;
+  levels.push_back(level) ;
+  links.push_back(std::vector< std::vector<size_t> >(level+1)) ;
+
+  if (entry < 0){
+    entry = id ;
+    topLevel = level ;
+    return id ;
+  }
+
+  size_t cur = GreedyClosest(q, entry, topLevel, level) ;
+  for (int l = std::min(level, topLevel); l >= 0; l--){
+    std::vector<Candidate> found = SearchLayer(q, cur, efConstruction, l) ;
+    links[id][l] = SelectNeighbours(found, M) ;
+    size_t maxLinks = (l == 0) ? maxM0 : M ;
+    for (size_t k = 0; k < links[id][l].size(); k++){
+      size_t n = links[id][l][k] ;
+      links[n][l].push_back(id) ;
+      if (links[n][l].size() > maxLinks)
+        ShrinkLinks(n, l) ;
+    }
+    cur = found[0].second ;
+  }
+
+  if (level > topLevel){
+    entry = id ;
+    topLevel = level ;
+  }
+  return id ;
+}
+
+// Greedy walk towards q on each layer from 'from' down to just above 'to'
+size_t HnswIndex::GreedyClosest(const double * q, size_t cur, int from, int to) const{
+  double curDist = SqDist(q, cur) ;
+  for (int l = from; l > to; l--){
+    bool moved = true ;
+    while (moved){
+      moved = false ;
+      const std::vector<size_t> & nbrs = links[cur][l] ;
+      for (size_t k = 0; k < nbrs.size(); k++){
+        double d = SqDist(q, nbrs[k]) ;
+        if (d < curDist){
+          curDist = d ;
+          cur = nbrs[k] ;
+          moved = true ;
+        }
+      }
+    }
+  }
+  return cur ;
+}
+
+// Best first search of width ef on one layer. Visited marks are kept per
+// thread and cleared by bumping a tag, so concurrent queries share nothing.
+std::vector<HnswIndex::Candidate> HnswIndex::SearchLayer(const double * q, size_t start, size_t ef, int layer) const{
+  static thread_local std::vector<unsigned> visited ;
+  static thread_local unsigned tag = 0 ;
+  if (visited.size() < Size())
+    visited.resize(Size(), 0) ;
+  if (++tag == 0){
+    std::fill(visited.begin(), visited.end(), 0) ;
+    tag = 1 ;
+  }
+
+  std::priority_queue< Candidate, std::vector<Candidate>, std::greater<Candidate> > frontier ; // closest on top
+  std::priority_queue<Candidate> best ; // furthest on top, at most ef entries
+  Candidate s(SqDist(q, start), start) ;
+  frontier.push(s) ;
+  best.push(s) ;
+  visited[start] = tag ;
+
+  while (!frontier.empty()){
+    Candidate c = frontier.top() ;
+    if (c.first > best.top().first)
+      break ;
+    frontier.pop() ;
+    const std::vector<size_t> & nbrs = links[c.second][layer] ;
+    for (size_t k = 0; k < nbrs.size(); k++){
+      size_t n = nbrs[k] ;
+      if (visited[n] == tag)
+        continue ;
+      visited[n] = tag ;
+      double d = SqDist(q, n) ;
+      if (best.size() < ef || d < best.top().first){
+        frontier.push(Candidate(d, n)) ;
+        best.push(Candidate(d, n)) ;
+        if (best.size() > ef)
+          best.pop() ;
+      }
+    }
+  }
+
+  std::vector<Candidate> result(best.size()) ;
+  for (size_t k = result.size(); k > 0; k--){
+    result[k-1] = best.top() ;
+    best.pop() ;
+  }
+  return result ;
+}
+
+// Keep candidates (closest first) that are closer to the query than to any
+// neighbour already kept, so links spread in different directions, then top
+// up with the closest of the rest
+std::vector<size_t> HnswIndex::SelectNeighbours(const std::vector<Candidate> & candidates, size_t m) const{
+  std::vector<size_t> kept ;
+  std::vector<size_t> skipped ;
+  for (size_t k = 0; k < candidates.size() && kept.size() < m; k++){
+    const double * p = GetPoint(candidates[k].second) ;
+    bool diverse = true ;
+    for (size_t j = 0; j < kept.size() && diverse; j++)
+      diverse = SqDist(p, kept[j]) > candidates[k].first ;
+    if (diverse)
+      kept.push_back(candidates[k].second) ;
+    else
+      skipped.push_back(candidates[k].second) ;
+  }
+  for (size_t k = 0; k < skipped.size() && kept.size() < m; k++)
+    kept.push_back(skipped[k]) ;
+  return kept ;
+}
+
+void HnswIndex::ShrinkLinks(size_t n, int layer){
+  std::vector<size_t> & nbrs = links[n][layer] ;
+  std::vector<Candidate> candidates ;
+  for (size_t k = 0; k < nbrs.size(); k++)
+    candidates.push_back(Candidate(SqDist(GetPoint(n), nbrs[k]), nbrs[k])) ;
+  std::sort(candidates.begin(), candidates.end()) ;
+  nbrs = SelectNeighbours(candidates, (layer == 0) ? maxM0 : M) ;
+}
+
+bool HnswIndex::Nearest(const double * q, size_t & id, double & sqDist) const{
+  if (entry < 0)
+    return false ;
+  size_t cur = GreedyClosest(q, entry, topLevel, 0) ;
+  std::vector<Candidate> found = SearchLayer(q, cur, std::max(efSearch, (size_t)1), 0) ;
+  id = found[0].second ;
+  sqDist = found[0].first ;
+  return true ;
+}
+
+std::vector<size_t> HnswIndex::KNearest(const double * q, size_t k) const{
+  std::vector<size_t> ids ;
+  if (entry < 0 || k == 0)
+    return ids ;
+  size_t cur = GreedyClosest(q, entry, topLevel, 0) ;
+  std::vector<Candidate> found = SearchLayer(q, cur, std::max(efSearch, k), 0) ;
+  for (size_t i = 0; i < found.size() && i < k; i++)
+    ids.push_back(found[i].second) ;
+  return ids ;
+}
+
+double HnswIndex::RecallAtOne(const std::vector<double> & queries) const{
+  size_t n = queries.size()/dim ;
+  if (n == 0 || Size() == 0)
+    return 0.0 ;
+  size_t hits = 0 ;
+  for (size_t i = 0; i < n; i++){
+    const double * q = &queries[i*dim] ;
+    double exact = SqDist(q, 0) ;
+    for (size_t j = 1; j < Size(); j++)
+      exact = std::min(exact, SqDist(q, j)) ;
+    size_t id ;
+    double approx ;
+    Nearest(q, id, approx) ;
+    if (approx <= exact) // any point at the exact distance counts
+      hits++ ;
+  }
+  return ((double)hits)/((double)n) ;
+}
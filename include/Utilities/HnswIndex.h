@@ -0,0 +1,60 @@
+// Approximate nearest neighbour index (hierarchical navigable small world
+// graph) over points of a fixed dimension. Each point is linked to up to M
+// near neighbours on every layer it belongs to, and a query descends greedily
+// from a sparse top layer before a best first search of width efSearch on the
+// bottom layer. Larger M and efConstruction give a better graph at a higher
+// build cost, larger efSearch trades query time for recall. Queries are const
+// and may run concurrently with each other, but not with insertion.
+#ifndef HNSW_INDEX_H_
+#define HNSW_INDEX_H_
+
+#include <vector>
+#include <random>
+#include <cstddef>
+
+class HnswIndex{
+  public:
+    HnswIndex(size_t dim, size_t M = 16, size_t efConstruction = 100, unsigned seed = 0) ;
+
+    void Build(const std::vector<double> &) ; // replace the contents, points given as consecutive runs of Dim() coordinates
+    size_t Insert(const double *) ; // returns the new point's id, ids are assigned in order from 0
+    void Clear() ;
+
+    size_t Dim() const {return dim ;}
+    size_t Size() const {return levels.size() ;}
+    const double * GetPoint(size_t i) const {return &coords[i*dim] ;}
+    void SetEfSearch(size_t ef){efSearch = ef ;}
+    size_t GetEfSearch() const {return efSearch ;}
+
+    // Nearest returns false if the index is empty, KNearest returns ids closest first
+    bool Nearest(const double *, size_t &, double & sqDist) const ;
+    std::vector<size_t> KNearest(const double *, size_t) const ;
+
+    // Fraction of queries whose approximate nearest neighbour is at the exact
+    // nearest distance, found by a linear scan. Queries are consecutive runs
+    // of Dim() coordinates.
+    double RecallAtOne(const std::vector<double> &) const ;
+  private:
+    typedef std::pair<double, size_t> Candidate ; // squared distance, id
+
+    size_t dim ;
+    size_t M ;
+    size_t maxM0 ; // links per point on the bottom layer
+    size_t efConstruction ;
+    size_t efSearch ;
+    double levelScale ;
+    std::mt19937 levelGenerator ;
+
+    std::vector<double> coords ;
+    std::vector<int> levels ;
+    std::vector< std::vector< std::vector<size_t> > > links ; // links[point][layer]
+    long entry ;
+    int topLevel ;
+
+    double SqDist(const double *, size_t) const ;
+    size_t GreedyClosest(const double *, size_t, int, int) const ; // descend from a layer down to (not including) another
+    std::vector<Candidate> SearchLayer(const double *, size_t, size_t, int) const ; // closest first
+    std::vector<size_t> SelectNeighbours(const std::vector<Candidate> &, size_t) const ;
+    void ShrinkLinks(size_t, int) ;
+} ;
+#endif // HNSW_INDEX_H_
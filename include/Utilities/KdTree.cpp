@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "KdTree.h"
+
+static const double balance = 0.7 ; // alpha: a child may hold at most this fraction of its parent's subtree
+
+KdTree::KdTree(size_t d): dim(d), numPoints(0), numRemoved(0), numTombstones(0), numGarbage(0), root(-1), depth(0){}
+
+void KdTree::Build(const std::vector<double> & points){
+  Clear() ;
+  coords = points ;
+  numPoints = points.size()/dim ;
+  removed.assign(numPoints, false) ;
+  Rebuild() ;
+}
+
+void KdTree::Clear(){
+  coords.clear() ;
+  removed.clear() ;
+  nodes.clear() ;
+  numPoints = 0 ;
+  numRemoved = 0 ;
+  numTombstones = 0 ;
+  numGarbage = 0 ;
+  root = -1 ;
+  depth = 0 ;
+}
+
+// Rebuild a balanced tree over all live points, ids are unchanged
+void KdTree::Rebuild(){
+  nodes.clear() ;
+  depth = 0 ;
+  std::vector<size_t> ids ;
+  for (size_t i = 0; i < numPoints; i++)
+    if (!removed[i])
+      ids.push_back(i) ;
+  nodes.reserve(ids.size()) ;
+  root = BuildRange(ids, 0, ids.size(), 1) ;
+  numTombstones = 0 ;
+  numGarbage = 0 ;
+}
+
+size_t KdTree::CountNodes(long n) const{
+  size_t count = 0 ;
+  std::vector<long> stack(1, n) ;
+  while (!stack.empty()){
+    long m = stack.back() ;
+    stack.pop_back() ;
+    if (m < 0)
+      continue ;
+    count++ ;
+    stack.push_back(nodes[m].left) ;
+    stack.push_back(nodes[m].right) ;
+  }
+  return count ;
+}
+
+// Live points of a subtree, tombstones are dropped
+void KdTree::CollectLive(long n, std::vector<size_t> & ids){
+  std::vector<long> stack(1, n) ;
+  while (!stack.empty()){
+    long m = stack.back() ;
+    stack.pop_back() ;
+    if (m < 0)
+      continue ;
+    if (removed[nodes[m].point])
+      numTombstones-- ;
+    else
+      ids.push_back(nodes[m].point) ;
+    numGarbage++ ;
+    stack.push_back(nodes[m].left) ;
+    stack.push_back(nodes[m].right) ;
+  }
+}
+
+// Replace the subtree rooted at path[k] with a balanced one. Its old nodes are
+// left in place and reclaimed by the next full rebuild.
+void KdTree::RebuildSubtree(const std::vector<long> & path, size_t k){
+  std::vector<size_t> ids ;
+  CollectLive(path[k], ids) ;
+  long sub = BuildRange(ids, 0, ids.size(), k+1) ;
+  if (k == 0)
+    root = sub ;
+  else if (nodes[path[k-1]].left == path[k])
+    nodes[path[k-1]].left = sub ;
+  else
+    nodes[path[k-1]].right = sub ;
+  if (numGarbage > Size())
+    Rebuild() ;
+}
+
+// Split on the axis of widest spread at the median point
+long KdTree::BuildRange(std::vector<size_t> & ids, size_t begin, size_t end, size_t level){
+  if (begin >= end)
+    return -1 ;
+  depth = std::max(depth, level) ;
+  
+  size_t axis = 0 ;
+  double widest = -1.0 ;
+  for (size_t a = 0; a < dim; a++){
+    double lo = coords[ids[begin]*dim+a] ;
+    double hi = lo ;
+    for (size_t i = begin+1; i < end; i++){
+      double x = coords[ids[i]*dim+a] ;
+      lo = std::min(lo, x) ;
+      hi = std::max(hi, x) ;
+    }
+    if (hi - lo > widest){
+      widest = hi - lo ;
+      axis = a ;
+    }
+  }
+  
+  size_t mid = begin + (end-begin)/2 ;
+  const std::vector<double> & c = coords ;
+  size_t d = dim ;
+  std::nth_element(ids.begin()+begin, ids.begin()+mid, ids.begin()+end,
+    [&c, d, axis](size_t a, size_t b){return c[a*d+axis] < c[b*d+axis] ;}) ;
+  
+  long n = nodes.size() ;
+  Node node ;
+  node.point = ids[mid] ;
+  node.axis = axis ;
+  nodes.push_back(node) ;
+  long left = BuildRange(ids, begin, mid, level+1) ;
+  long right = BuildRange(ids, mid+1, end, level+1) ;
+  nodes[n].left = left ;
+  nodes[n].right = right ;
+  return n ;
+}
+
+size_t KdTree::Insert(const double * p){
+  size_t id = numPoints ;
+  coords.insert(coords.end(), p, p+dim) ;
+  removed.push_back(false) ;
+  numPoints++ ;
+  
+  Node node ;
+  node.point = id ;
+  node.left = -1 ;
+  node.right = -1 ;
+  if (root < 0){
+    node.axis = 0 ;
+    root = nodes.size() ;
+    nodes.push_back(node) ;
+    depth = 1 ;
+    return id ;
+  }
+  
+  // Descend to a leaf
+  std::vector<long> path ;
+  long cur = root ;
+  size_t level = 1 ;
+  while (true){
+    path.push_back(cur) ;
+    Node & parent = nodes[cur] ;
+    bool goLeft = p[parent.axis] < coords[parent.point*dim+parent.axis] ;
+    long next = goLeft ? parent.left : parent.right ;
+    level++ ;
+    if (next < 0){
+      node.axis = (parent.axis+1) % dim ;
+      long n = nodes.size() ;
+      if (goLeft)
+        nodes[cur].left = n ;
+      else
+        nodes[cur].right = n ;
+      nodes.push_back(node) ;
+      path.push_back(n) ;
+      break ;
+    }
+    cur = next ;
+  }
+  
+  // Too deep: walk up to the lowest ancestor with a child holding more than
+  // a fraction alpha of its subtree and rebuild it. One always exists, and
+  // the rebuild cost is amortised over the insertions that unbalanced it.
+  double linked = (double)(Size() + numTombstones) ;
+  if (level - 1 > std::log(linked)/std::log(1.0/balance)){
+    size_t childSize = 1 ;
+    for (size_t k = path.size()-1; k > 0; k--){
+      const Node & parent = nodes[path[k-1]] ;
+      long sibling = parent.left == path[k] ? parent.right : parent.left ;
+      size_t parentSize = childSize + 1 + CountNodes(sibling) ;
+      if (childSize > balance*parentSize){
+        RebuildSubtree(path, k-1) ;
+        return id ;
+      }
+      childSize = parentSize ;
+    }
+    Rebuild() ;
+    return id ;
+  }
+  depth = std::max(depth, level) ;
+  return id ;
+}
+
+void KdTree::Remove(size_t i){
+  if (i >= numPoints || removed[i])
+    return ;
+  removed[i] = true ;
+  numRemoved++ ;
+  numTombstones++ ;
+  if (numTombstones > Size())
+    Rebuild() ;
+}
+
+double KdTree::SqDist(const double * q, size_t i) const{
+  const double * p = &coords[i*dim] ;
+  double d = 0.0 ;
+  for (size_t a = 0; a < dim; a++)
+    d += (q[a]-p[a])*(q[a]-p[a]) ;
+  return d ;
+}
+
+bool KdTree::Nearest(const double * q, size_t & id, double & sqDist) const{
+  std::vector< std::pair<double, size_t> > best ;
+  SearchKNearest(root, q, 1, best) ;
+  if (best.empty())
+    return false ;
+  id = best[0].second ;
+  sqDist = best[0].first ;
+  return true ;
+}
+
+std::vector<size_t> KdTree::KNearest(const double * q, size_t k) const{
+  std::vector< std::pair<double, size_t> > best ;
+  if (k > 0)
+    SearchKNearest(root, q, k, best) ;
+  std::sort_heap(best.begin(), best.end()) ;
+  std::vector<size_t> ids ;
+  for (size_t i = 0; i < best.size(); i++)
+    ids.push_back(best[i].second) ;
+  return ids ;
+}
+
+std::vector<size_t> KdTree::Radius(const double * q, double r) const{
+  std::vector<size_t> ids ;
+  SearchRadius(root, q, r*r, ids) ;
+  return ids ;
+}
+
+// best is a max-heap on squared distance holding at most k entries
+void KdTree::SearchKNearest(long n, const double * q, size_t k, std::vector< std::pair<double, size_t> > & best) const{
+  while (n >= 0){
+    const Node & node = nodes[n] ;
+    if (!removed[node.point]){
+      double d = SqDist(q, node.point) ;
+      if (best.size() < k || d < best.front().first){
+        best.push_back(std::make_pair(d, node.point)) ;
+        std::push_heap(best.begin(), best.end()) ;
+        if (best.size() > k){
+          std::pop_heap(best.begin(), best.end()) ;
+          best.pop_back() ;
+        }
+      }
+    }
+    double diff = q[node.axis] - coords[node.point*dim+node.axis] ;
+    long nearSide = diff < 0.0 ? node.left : node.right ;
+    long farSide = diff < 0.0 ? node.right : node.left ;
+    SearchKNearest(nearSide, q, k, best) ;
+    if (best.size() < k || diff*diff < best.front().first)
+      n = farSide ; // continue down the far side without recursion
+    else
+      return ;
+  }
+}
+
+void KdTree::SearchRadius(long n, const double * q, double sqR, std::vector<size_t> & ids) const{
+  while (n >= 0){
+    const Node & node = nodes[n] ;
+    if (!removed[node.point] && SqDist(q, node.point) <= sqR)
+      ids.push_back(node.point) ;
+    double diff = q[node.axis] - coords[node.point*dim+node.axis] ;
+    long nearSide = diff < 0.0 ? node.left : node.right ;
+    long farSide = diff < 0.0 ? node.right : node.left ;
+    SearchRadius(nearSide, q, sqR, ids) ;
+    if (diff*diff <= sqR)
+      n = farSide ;
+    else
+      return ;
+  }
+}
+
+std::vector<size_t> KdTree::BuildImplicit(std::vector<double> & points, size_t dim, std::vector<unsigned int> & axes){
+  size_t n = points.size()/dim ;
+  std::vector<size_t> order(n) ;
+  for (size_t i = 0; i < n; i++)
+    order[i] = i ;
+  axes.assign(n, 0) ;
+  BuildImplicitRange(points, dim, order, axes, 0, n) ;
+  
+  std::vector<double> sorted(points.size()) ;
+  for (size_t i = 0; i < n; i++)
+    std::copy(points.begin()+order[i]*dim, points.begin()+(order[i]+1)*dim, sorted.begin()+i*dim) ;
+  points.swap(sorted) ;
+  return order ;
+}
+
+// Split on the axis of widest spread at the middle position, as in BuildRange
+void KdTree::BuildImplicitRange(const std::vector<double> & c, size_t dim, std::vector<size_t> & order, std::vector<unsigned int> & axes, size_t begin, size_t end){
+  if (end - begin <= 1)
+    return ;
+  size_t axis = 0 ;
+  double widest = -1.0 ;
+  for (size_t a = 0; a < dim; a++){
+    double lo = c[order[begin]*dim+a] ;
+    double hi = lo ;
+    for (size_t i = begin+1; i < end; i++){
+      lo = std::min(lo, c[order[i]*dim+a]) ;
+      hi = std::max(hi, c[order[i]*dim+a]) ;
+    }
+    if (hi - lo > widest){
+      widest = hi - lo ;
+      axis = a ;
+    }
+  }
+  
+  size_t mid = begin + (end-begin)/2 ;
+  std::nth_element(order.begin()+begin, order.begin()+mid, order.begin()+end,
+    [&c, dim, axis](size_t a, size_t b){return c[a*dim+axis] < c[b*dim+axis] ;}) ;
+  axes[mid] = axis ;
+  BuildImplicitRange(c, dim, order, axes, begin, mid) ;
+  BuildImplicitRange(c, dim, order, axes, mid+1, end) ;
+}
+
+bool KdTree::NearestImplicit(const double * points, const unsigned int * axes, size_t n, size_t dim, const double * q, size_t & pos, double & sqDist){
+  if (n == 0)
+    return false ;
+  sqDist = -1.0 ; // unset
+  SearchImplicit(points, axes, 0, n, dim, q, pos, sqDist) ;
+  return true ;
+}
+
+void KdTree::SearchImplicit(const double * points, const unsigned int * axes, size_t begin, size_t end, size_t dim, const double * q, size_t & pos, double & sqDist){
+  while (begin < end){
+    size_t mid = begin + (end-begin)/2 ;
+    const double * p = points + mid*dim ;
+    double d = 0.0 ;
+    for (size_t a = 0; a < dim; a++)
+      d += (q[a]-p[a])*(q[a]-p[a]) ;
+    if (sqDist < 0.0 || d < sqDist || (d == sqDist && mid < pos)){
+      sqDist = d ;
+      pos = mid ;
+    }
+    if (end - begin == 1)
+      return ;
+    size_t axis = axes[mid] ;
+    double diff = q[axis] - p[axis] ;
+    bool nearLeft = diff < 0.0 ;
+    if (nearLeft)
+      SearchImplicit(points, axes, begin, mid, dim, q, pos, sqDist) ;
+    else
+      SearchImplicit(points, axes, mid+1, end, dim, q, pos, sqDist) ;
+    if (diff*diff > sqDist)
+      return ;
+    if (nearLeft) // continue down the far side without recursion
+      begin = mid+1 ;
+    else
+      end = mid ;
+  }
+}
@@ -0,0 +1,75 @@
+// kd-tree over points of a fixed dimension. Points are kept in one flat
+// coordinate array and nodes are plain structs indexing into it, so a tree
+// holds no per-point heap allocations. Supports bulk builds, incremental
+// insertion and removal by tombstone (with a rebuild once half the points are
+// removed). Insertion keeps the depth logarithmic as in a scapegoat tree: an
+// insertion that lands deeper than log base 1/alpha of the number of nodes
+// rebuilds the subtree of the lowest ancestor that is out of balance.
+#ifndef KD_TREE_H_
+#define KD_TREE_H_
+
+#include <vector>
+#include <cstddef>
+
+class KdTree{
+  public:
+    KdTree(size_t) ; // point dimension
+    
+    // Replace the contents with points given as consecutive runs of Dim()
+    // coordinates. Point ids are assigned in order from 0.
+    void Build(const std::vector<double> &) ;
+    size_t Insert(const double *) ; // returns the new point's id
+    void Remove(size_t) ;
+    void Clear() ;
+    
+    size_t Dim() const {return dim ;}
+    size_t Size() const {return numPoints - numRemoved ;} // live points
+    bool IsRemoved(size_t i){return removed[i] ;}
+    const double * GetPoint(size_t i) const {return &coords[i*dim] ;}
+    
+    // Queries skip removed points. Nearest returns false if the tree is empty,
+    // KNearest returns ids closest first.
+    bool Nearest(const double *, size_t &, double & sqDist) const ;
+    std::vector<size_t> KNearest(const double *, size_t) const ;
+    std::vector<size_t> Radius(const double *, double) const ;
+    
+    size_t Depth(){return depth ;} // longest root to leaf path, an upper bound between full rebuilds
+    
+    // Implicit trees: points are reordered so that the split point of every
+    // range [b,e) sits at its middle, with one split axis per position. Such a
+    // tree needs no node storage and can be searched in place, for example in
+    // a memory mapped file. BuildImplicit reorders the flat points and returns
+    // the original index of the point now at each position.
+    static std::vector<size_t> BuildImplicit(std::vector<double> &, size_t dim, std::vector<unsigned int> & axes) ;
+    static bool NearestImplicit(const double * points, const unsigned int * axes, size_t n, size_t dim, const double * q, size_t & pos, double & sqDist) ;
+  private:
+    struct Node{
+      size_t point ;
+      size_t axis ;
+      long left ;
+      long right ;
+    } ;
+    
+    size_t dim ;
+    size_t numPoints ;
+    size_t numRemoved ;
+    size_t numTombstones ; // removed points still linked into the tree
+    size_t numGarbage ; // nodes left unlinked by subtree rebuilds
+    std::vector<double> coords ;
+    std::vector<bool> removed ;
+    std::vector<Node> nodes ;
+    long root ;
+    size_t depth ; // longest root to leaf path
+    
+    void Rebuild() ;
+    void RebuildSubtree(const std::vector<long> &, size_t) ; // path from the root, index of the subtree's root on it
+    size_t CountNodes(long) const ;
+    void CollectLive(long, std::vector<size_t> &) ;
+    long BuildRange(std::vector<size_t> &, size_t, size_t, size_t) ;
+    double SqDist(const double *, size_t) const ;
+    void SearchKNearest(long, const double *, size_t, std::vector< std::pair<double, size_t> > &) const ;
+    void SearchRadius(long, const double *, double, std::vector<size_t> &) const ;
+    static void BuildImplicitRange(const std::vector<double> &, size_t, std::vector<size_t> &, std::vector<unsigned int> &, size_t, size_t) ;
+    static void SearchImplicit(const double *, const unsigned int *, size_t, size_t, size_t, const double *, size_t &, double &) ;
+} ;
+#endif // KD_TREE_H_
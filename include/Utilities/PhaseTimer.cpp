@@ -0,0 +1,51 @@
+#include <atomic>
+#include <sstream>
+#include "PhaseTimer.h"
+
+namespace easytime{
+std::atomic<bool> enabled(false) ;
+
+static std::atomic<unsigned long long> phaseNs[NUM_PHASES] ;
+static std::atomic<unsigned long long> phaseCalls[NUM_PHASES] ;
+
+static const char * phaseNames[NUM_PHASES] = {"train", "evolve", "mutate",
+  "select", "teams", "simulate", "rollout", "step", "sense", "policy", "reward"} ;
+
+void enable(bool on){
+  enabled.store(on, std::memory_order_relaxed) ;
+}
+
+void add(phase p, unsigned long long ns){
+  phaseNs[p].fetch_add(ns, std::memory_order_relaxed) ;
+  phaseCalls[p].fetch_add(1, std::memory_order_relaxed) ;
+}
+
+totals snapshot(){
+  totals t ;
+  for (size_t i = 0; i < NUM_PHASES; i++){
+    t.ns[i] = phaseNs[i].load(std::memory_order_relaxed) ;
+    t.calls[i] = phaseCalls[i].load(std::memory_order_relaxed) ;
+  }
+  return t ;
+}
+
+void reset(){
+  for (size_t i = 0; i < NUM_PHASES; i++){
+    phaseNs[i].store(0, std::memory_order_relaxed) ;
+    phaseCalls[i].store(0, std::memory_order_relaxed) ;
+  }
+}
+
+const char * phase_name(phase p){
+  return phaseNames[p] ;
+}
+
+std::string to_json(const totals & t, size_t epoch){
+  std::stringstream ss ;
+  ss << "{\"epoch\":" << epoch ;
+  for (size_t i = 0; i < NUM_PHASES; i++)
+    ss << ",\"" << phaseNames[i] << "\":{\"ms\":" << t.ns[i]/1.0e6 << ",\"calls\":" << t.calls[i] << "}" ;
+  ss << "}" ;
+  return ss.str() ;
+}
+} // namespace easytime
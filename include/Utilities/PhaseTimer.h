@@ -0,0 +1,55 @@
+// Wall clock timers for the phases of a training epoch. Timing is off by
+// default; while it is off a ScopedTimer only checks a flag.
+#ifndef PHASE_TIMER_H_
+#define PHASE_TIMER_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace easytime{
+enum phase {TRAIN, EVOLVE, MUTATE, SELECT, TEAMS, SIMULATE, ROLLOUT, STEP, SENSE, POLICY, REWARD, NUM_PHASES} ;
+
+extern std::atomic<bool> enabled ; // read by timers on worker threads
+
+void enable(bool) ;
+inline bool is_enabled(){return enabled.load(std::memory_order_relaxed) ;}
+
+// Accumulate elapsed nanoseconds and a call count for a phase (thread safe)
+void add(phase, unsigned long long) ;
+
+// Totals accumulated since the last reset
+struct totals{
+  unsigned long long ns[NUM_PHASES] ;
+  unsigned long long calls[NUM_PHASES] ;
+} ;
+totals snapshot() ;
+void reset() ;
+
+// Phase name as used in the JSON output
+const char * phase_name(phase) ;
+
+// One JSON object on a single line: {"epoch":n,"train":{"ms":..,"calls":..},...}
+std::string to_json(const totals &, size_t epoch) ;
+
+// Times the enclosing scope, or until Stop() is called
+class ScopedTimer{
+  public:
+    ScopedTimer(phase p): p(p), running(is_enabled()){
+      if (running)
+        start = std::chrono::steady_clock::now() ;
+    }
+    ~ScopedTimer(){Stop() ;}
+    void Stop(){
+      if (!running)
+        return ;
+      running = false ;
+      add(p, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()) ;
+    }
+  private:
+    phase p ;
+    bool running ;
+    std::chrono::steady_clock::time_point start ;
+} ;
+} // namespace easytime
+#endif // PHASE_TIMER_H_
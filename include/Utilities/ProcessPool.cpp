@@ -0,0 +1,67 @@
+#include <iostream>
+#include <map>
+#include <chrono>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "ProcessPool.h"
+
+ProcessPool::ProcessPool(size_t n): numWorkers(n > 0 ? n : 1){}
+
+std::vector<ProcessResult> ProcessPool::Run(size_t n, const Job & job, const ExitHandler & onExit){
+  ProcessResult failed = {-1, 0.0, 0} ;
+  std::vector<ProcessResult> results(n, failed) ;
+  std::vector<std::chrono::steady_clock::time_point> started(n) ;
+  std::map<pid_t, size_t> running ; // child pid -> job index
+  size_t next = 0 ;
+
+  while (next < n || !running.empty()){
+    // Keep every worker busy
+    while (next < n && running.size() < numWorkers){
+      std::cout.flush() ;
+      started[next] = std::chrono::steady_clock::now() ;
+      pid_t pid = fork() ;
+      if (pid == 0){
+        int code = job(next) ;
+        std::cout.flush() ;
+        _exit(code) ;
+      }
+      if (pid < 0){
+        std::cout << "Error: could not start job " << next << "!\n" ;
+        if (onExit)
+          onExit(next, results[next]) ;
+        next++ ;
+        continue ;
+      }
+      running[pid] = next++ ;
+    }
+    if (running.empty())
+      break ;
+
+    // wait4 reports the usage of exactly the child that was reaped
+    int status ;
+    struct rusage usage ;
+    pid_t pid = wait4(-1, &status, 0, &usage) ;
+    if (pid < 0){
+      if (errno == EINTR)
+        continue ;
+      break ; // no children left to wait for
+    }
+    std::map<pid_t, size_t>::iterator it = running.find(pid) ;
+    if (it == running.end())
+      continue ; // not one of ours
+    size_t i = it->second ;
+    running.erase(it) ;
+
+    ProcessResult & r = results[i] ;
+    r.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1 ;
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started[i]).count() ;
+    r.peakRSS = usage.ru_maxrss ;
+    if (onExit)
+      onExit(i, r) ;
+  }
+  return results ;
+}
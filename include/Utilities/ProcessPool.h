@@ -0,0 +1,38 @@
+// Runs independent jobs in forked child processes, at most a fixed number at
+// a time. Children start with a copy of the parent's memory and share nothing
+// afterwards, so jobs that use global state (random engines, timers, std::cout)
+// can run side by side without interfering.
+#ifndef PROCESS_POOL_H_
+#define PROCESS_POOL_H_
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+// How a job's child process ended
+struct ProcessResult{
+  int status ;     // exit status, -1 if the job could not be started or was killed by a signal
+  double seconds ; // wall time from fork to exit
+  long peakRSS ;   // largest resident set size of the child in kB (ru_maxrss)
+} ;
+
+class ProcessPool{
+  public:
+    typedef std::function<int(size_t)> Job ;
+    typedef std::function<void(size_t, const ProcessResult &)> ExitHandler ;
+
+    ProcessPool(size_t) ; // maximum number of children alive at once, at least 1
+
+    size_t NumWorkers() const {return numWorkers ;}
+
+    // Calls job(i) for every i in [0,n), each in its own child process, and
+    // blocks until every child has exited. A child exits with the value its
+    // job returns. Jobs are started in index order as children finish, and
+    // onExit (if set) is called in the parent as each one is reaped, so
+    // progress can be recorded before the whole batch is done. std::cout is
+    // flushed before each fork.
+    std::vector<ProcessResult> Run(size_t n, const Job & job, const ExitHandler & onExit = ExitHandler()) ;
+  private:
+    size_t numWorkers ;
+} ;
+#endif // PROCESS_POOL_H_
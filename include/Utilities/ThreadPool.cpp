@@ -0,0 +1,69 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t n): jobSize(0), nextIndex(0), generation(0), running(0), stop(false){
+  for (size_t i = 1; i < n; i++)
+    workers.push_back(std::thread(&ThreadPool::Run, this, i)) ;
+}
+
+ThreadPool::~ThreadPool(){
+  {
+    std::unique_lock<std::mutex> guard(lock) ;
+    stop = true ;
+  }
+  start.notify_all() ;
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join() ;
+}
+
+void ThreadPool::ParallelFor(size_t n, std::function<void(size_t, size_t)> f){
+  if (workers.empty() || n < 2){
+    for (size_t i = 0; i < n; i++)
+      f(i, 0) ;
+    return ;
+  }
+  
+  {
+    std::unique_lock<std::mutex> guard(lock) ;
+    job = f ;
+    jobSize = n ;
+    nextIndex = 0 ;
+    running = workers.size() ;
+    generation++ ;
+  }
+  start.notify_all() ;
+  
+  // The caller takes part as worker 0
+  Work(0) ;
+  
+  std::unique_lock<std::mutex> guard(lock) ;
+  done.wait(guard, [this]{ return running == 0 ; }) ;
+  job = nullptr ;
+}
+
+void ThreadPool::Run(size_t worker){
+  size_t seen = 0 ;
+  std::unique_lock<std::mutex> guard(lock) ;
+  while (true){
+    start.wait(guard, [this, seen]{ return stop || generation != seen ; }) ;
+    if (stop)
+      break ;
+    seen = generation ;
+    guard.unlock() ;
+    
+    Work(worker) ;
+    
+    guard.lock() ;
+    running-- ;
+    if (running == 0)
+      done.notify_all() ;
+  }
+}
+
+void ThreadPool::Work(size_t worker){
+  while (true){
+    size_t i = nextIndex.fetch_add(1) ;
+    if (i >= jobSize)
+      return ;
+    job(i, worker) ;
+  }
+}
@@ -0,0 +1,40 @@
+// Fixed set of worker threads for data parallel loops
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+class ThreadPool{
+  public:
+    ThreadPool(size_t) ; // total threads including the caller, 0 or 1 runs everything on the caller
+    ~ThreadPool() ;
+    
+    size_t NumWorkers(){return workers.size() + 1 ;}
+    
+    // Calls f(i, worker) for every i in [0,n) and blocks until all calls have
+    // returned. Indices are handed out dynamically; worker is in
+    // [0,NumWorkers()) and identifies the calling thread, so it can be used to
+    // index per-thread scratch data. Calls must not throw.
+    void ParallelFor(size_t n, std::function<void(size_t, size_t)> f) ;
+  private:
+    std::vector<std::thread> workers ;
+    std::mutex lock ;
+    std::condition_variable start ;
+    std::condition_variable done ;
+    
+    std::function<void(size_t, size_t)> job ;
+    size_t jobSize ;
+    std::atomic<size_t> nextIndex ;
+    size_t generation ;
+    size_t running ; // workers still busy with the current job
+    bool stop ;
+    
+    void Run(size_t) ;
+    void Work(size_t) ;
+} ;
+#endif // THREAD_POOL_H_
@@ -0,0 +1,249 @@
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <zlib.h>
+#include "TrajectoryArchive.h"
+
+namespace {
+void PutVarint(std::string & s, long long v){
+  unsigned long long z = ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63) ; // zigzag
+  while (z >= 0x80){
+    s.push_back((char)((z & 0x7f) | 0x80)) ;
+    z >>= 7 ;
+  }
+  s.push_back((char)z) ;
+}
+
+bool GetVarint(const std::string & s, size_t & pos, long long & v){
+  unsigned long long z = 0 ;
+  for (unsigned shift = 0; shift < 64 && pos < s.size(); shift += 7){
+    unsigned char c = s[pos++] ;
+    z |= (unsigned long long)(c & 0x7f) << shift ;
+    if (!(c & 0x80)){
+      v = (long long)(z >> 1) ^ -(long long)(z & 1) ;
+      return true ;
+    }
+  }
+  return false ;
+}
+} // namespace
+
+TrajectoryArchiveWriter::TrajectoryArchiveWriter(): positionQuantum(1e-3), headingQuantum(1e-4), level(1), offset(0){}
+
+TrajectoryArchiveWriter::~TrajectoryArchiveWriter(){
+  Close() ;
+}
+
+bool TrajectoryArchiveWriter::Open(std::string fileName, double pq, double hq, int l){
+  Close() ;
+  if (pq <= 0.0 || hq <= 0.0){
+    std::cout << "Error: trajectory quantisation steps must be positive!\n" ;
+    return false ;
+  }
+  out.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc) ;
+  if (!out.is_open()){
+    std::cout << "Error: unable to open " << fileName << " for writing!\n" ;
+    return false ;
+  }
+  positionQuantum = pq ;
+  headingQuantum = hq ;
+  level = l ;
+  index.clear() ;
+  
+  TrajectoryArchiveHeader header ;
+  std::memset(&header, 0, sizeof(header)) ;
+  std::memcpy(header.magic, "AADILTRA", 8) ;
+  header.version = TRAJECTORY_ARCHIVE_VERSION ;
+  header.positionQuantum = positionQuantum ;
+  header.headingQuantum = headingQuantum ;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header)) ;
+  offset = sizeof(header) ;
+  return true ;
+}
+
+bool TrajectoryArchiveWriter::Close(){
+  if (!out.is_open())
+    return false ;
+  TrajectoryArchiveFooter footer ;
+  footer.indexOffset = offset ;
+  footer.numBlocks = index.size() ;
+  std::memcpy(footer.magic, "TRAINDEX", 8) ;
+  out.write(reinterpret_cast<const char *>(index.data()), index.size()*sizeof(TrajectoryArchiveEntry)) ;
+  out.write(reinterpret_cast<const char *>(&footer), sizeof(footer)) ;
+  out.close() ;
+  index.clear() ;
+  if (out.fail()){
+    std::cout << "Error: failed to write trajectory archive!\n" ;
+    return false ;
+  }
+  return true ;
+}
+
+bool TrajectoryArchiveWriter::AddTrajectory(unsigned int epoch, unsigned int team, const std::vector<TrajectoryRecord> & records){
+  if (!out.is_open())
+    return false ;
+  size_t numAgents = 0, numSteps = 0 ;
+  for (size_t i = 0; i < records.size(); i++){
+    numAgents = std::max(numAgents, (size_t)records[i].agent + 1) ;
+    numSteps = std::max(numSteps, (size_t)records[i].step + 1) ;
+  }
+  if (numAgents*numSteps != records.size()){
+    std::cout << "Error: trajectory for epoch " << epoch << " team " << team << " does not have one record per agent and step!\n" ;
+    return false ;
+  }
+  
+  // Quantised values by agent then step
+  std::vector<long long> q(3*records.size()) ;
+  std::vector<bool> seen(records.size(), false) ;
+  for (size_t i = 0; i < records.size(); i++){
+    const TrajectoryRecord & r = records[i] ;
+    size_t k = r.agent*numSteps + r.step ;
+    if (seen[k]){
+      std::cout << "Error: trajectory for epoch " << epoch << " team " << team << " repeats agent " << r.agent << " at step " << r.step << "!\n" ;
+      return false ;
+    }
+    seen[k] = true ;
+    q[3*k] = std::llround(r.x/positionQuantum) ;
+    q[3*k+1] = std::llround(r.y/positionQuantum) ;
+    q[3*k+2] = std::llround(r.psi/headingQuantum) ;
+  }
+  
+  std::string raw ;
+  PutVarint(raw, numAgents) ;
+  PutVarint(raw, numSteps) ;
+  for (size_t a = 0; a < numAgents; a++){
+    for (size_t c = 0; c < 3; c++){
+      long long previous = 0 ;
+      for (size_t t = 0; t < numSteps; t++){
+        long long v = q[3*(a*numSteps + t) + c] ;
+        PutVarint(raw, v - previous) ;
+        previous = v ;
+      }
+    }
+  }
+  
+  uLongf compressedSize = compressBound(raw.size()) ;
+  std::string compressed(compressedSize, '\0') ;
+  if (compress2(reinterpret_cast<Bytef *>(&compressed[0]), &compressedSize, reinterpret_cast<const Bytef *>(raw.data()), raw.size(), level) != Z_OK){
+    std::cout << "Error: unable to compress trajectory for epoch " << epoch << " team " << team << "!\n" ;
+    return false ;
+  }
+  out.write(compressed.data(), compressedSize) ;
+  
+  TrajectoryArchiveEntry entry = {epoch, team, offset, compressedSize, raw.size()} ;
+  index.push_back(entry) ;
+  offset += compressedSize ;
+  return !out.fail() ;
+}
+
+bool TrajectoryArchiveWriter::FromRecorderFile(std::string recorderFile, std::string archiveFile, double pq, double hq){
+  std::vector<TrajectoryRecord> records ;
+  if (!TrajectoryRecorder::Read(recorderFile, records))
+    return false ;
+  TrajectoryArchiveWriter writer ;
+  if (!writer.Open(archiveFile, pq, hq))
+    return false ;
+  
+  // Consecutive records with the same epoch and team form one trajectory
+  size_t start = 0 ;
+  for (size_t i = 1; i <= records.size(); i++){
+    if (i < records.size() && records[i].epoch == records[start].epoch && records[i].team == records[start].team)
+      continue ;
+    std::vector<TrajectoryRecord> trajectory(records.begin() + start, records.begin() + i) ;
+    if (!writer.AddTrajectory(records[start].epoch, records[start].team, trajectory))
+      return false ;
+    start = i ;
+  }
+  return writer.Close() ;
+}
+
+bool TrajectoryArchiveReader::Open(std::string fileName){
+  index.clear() ;
+  if (in.is_open())
+    in.close() ;
+  in.clear() ;
+  in.open(fileName.c_str(), std::ios::in | std::ios::binary) ;
+  if (!in.is_open() || !in.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, "AADILTRA", 8) != 0 || header.version != TRAJECTORY_ARCHIVE_VERSION){
+    std::cout << "Error: " << fileName << " is not a trajectory archive!\n" ;
+    return false ;
+  }
+  
+  TrajectoryArchiveFooter footer ;
+  in.seekg(0, std::ios::end) ;
+  unsigned long long fileSize = in.tellg() ;
+  in.seekg(fileSize - sizeof(footer)) ;
+  if (fileSize < sizeof(header) + sizeof(footer) || !in.read(reinterpret_cast<char *>(&footer), sizeof(footer)) || std::memcmp(footer.magic, "TRAINDEX", 8) != 0 || footer.indexOffset + footer.numBlocks*sizeof(TrajectoryArchiveEntry) + sizeof(footer) != fileSize){
+    std::cout << "Error: " << fileName << " has no index, it was not closed!\n" ;
+    return false ;
+  }
+  std::vector<TrajectoryArchiveEntry> entries(footer.numBlocks) ;
+  in.seekg(footer.indexOffset) ;
+  if (!in.read(reinterpret_cast<char *>(entries.data()), entries.size()*sizeof(TrajectoryArchiveEntry))){
+    std::cout << "Error: unable to read the index of " << fileName << "!\n" ;
+    return false ;
+  }
+  for (size_t i = 0; i < entries.size(); i++)
+    index[std::make_pair(entries[i].epoch, entries[i].team)] = entries[i] ; // later blocks win
+  return true ;
+}
+
+std::vector< std::pair<unsigned int, unsigned int> > TrajectoryArchiveReader::GetKeys(){
+  std::vector< std::pair<unsigned int, unsigned int> > keys ;
+  for (std::map< std::pair<unsigned int, unsigned int>, TrajectoryArchiveEntry >::const_iterator it = index.begin(); it != index.end(); ++it)
+    keys.push_back(it->first) ;
+  return keys ;
+}
+
+bool TrajectoryArchiveReader::ReadTrajectory(unsigned int epoch, unsigned int team, std::vector<TrajectoryRecord> & records){
+  records.clear() ;
+  std::map< std::pair<unsigned int, unsigned int>, TrajectoryArchiveEntry >::const_iterator found = index.find(std::make_pair(epoch, team)) ;
+  if (found == index.end())
+    return false ;
+  const TrajectoryArchiveEntry & e = found->second ;
+  
+  std::string compressed(e.compressedSize, '\0') ;
+  std::string raw(e.rawSize, '\0') ;
+  uLongf rawSize = e.rawSize ;
+  in.clear() ;
+  in.seekg(e.offset) ;
+  if (!in.read(&compressed[0], compressed.size()) || uncompress(reinterpret_cast<Bytef *>(&raw[0]), &rawSize, reinterpret_cast<const Bytef *>(compressed.data()), compressed.size()) != Z_OK || rawSize != e.rawSize){
+    std::cout << "Error: trajectory for epoch " << epoch << " team " << team << " is corrupt!\n" ;
+    return false ;
+  }
+  
+  size_t pos = 0 ;
+  long long numAgents, numSteps ;
+  if (!GetVarint(raw, pos, numAgents) || !GetVarint(raw, pos, numSteps) || numAgents < 0 || numSteps < 0 || (unsigned long long)(numAgents*numSteps) > raw.size()){
+    std::cout << "Error: trajectory for epoch " << epoch << " team " << team << " is corrupt!\n" ;
+    return false ;
+  }
+  records.resize(numAgents*numSteps) ;
+  for (long long a = 0; a < numAgents; a++){
+    for (size_t c = 0; c < 3; c++){
+      long long v = 0 ;
+      for (long long t = 0; t < numSteps; t++){
+        long long d ;
+        if (!GetVarint(raw, pos, d)){
+          std::cout << "Error: trajectory for epoch " << epoch << " team " << team << " is corrupt!\n" ;
+          records.clear() ;
+          return false ;
+        }
+        v += d ;
+        TrajectoryRecord & r = records[t*numAgents + a] ;
+        if (c == 0){
+          r.epoch = epoch ;
+          r.team = team ;
+          r.step = t ;
+          r.agent = a ;
+          r.x = v*header.positionQuantum ;
+        }
+        else if (c == 1)
+          r.y = v*header.positionQuantum ;
+        else
+          r.psi = v*header.headingQuantum ;
+      }
+    }
+  }
+  return true ;
+}
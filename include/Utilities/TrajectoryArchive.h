@@ -0,0 +1,93 @@
+// Compressed trajectory archive with random access by epoch and team. Each
+// (epoch, team) trajectory is one block: positions and headings are quantised
+// to a fixed step, every agent's sequence is delta encoded as zigzag varints
+// (consecutive positions differ by at most one unit step, so most deltas take
+// one or two bytes) and the block is compressed with zlib. An index of block
+// offsets at the end of the file lets a reader decompress only the blocks it
+// asks for.
+//
+// File layout:
+//   header       TrajectoryArchiveHeader
+//   blocks       zlib streams, one per (epoch, team)
+//   index        numBlocks TrajectoryArchiveEntry
+//   footer       TrajectoryArchiveFooter
+// A block decodes to: numAgents, numSteps (varints), then per agent the x,
+// y and psi sequences, each a zigzag varint first value followed by deltas.
+#ifndef TRAJECTORY_ARCHIVE_H_
+#define TRAJECTORY_ARCHIVE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include "TrajectoryRecorder.h"
+
+struct TrajectoryArchiveHeader{
+  char magic[8] ; // "AADILTRA"
+  unsigned int version ;
+  unsigned int reserved ;
+  double positionQuantum ;
+  double headingQuantum ;
+} ;
+
+struct TrajectoryArchiveEntry{
+  unsigned int epoch ;
+  unsigned int team ;
+  unsigned long long offset ;
+  unsigned long long compressedSize ;
+  unsigned long long rawSize ;
+} ;
+
+struct TrajectoryArchiveFooter{
+  unsigned long long indexOffset ;
+  unsigned long long numBlocks ;
+  char magic[8] ; // "TRAINDEX"
+} ;
+
+const unsigned int TRAJECTORY_ARCHIVE_VERSION = 1 ;
+
+class TrajectoryArchiveWriter{
+  public:
+    TrajectoryArchiveWriter() ;
+    ~TrajectoryArchiveWriter() ; // closes the archive
+    
+    // Positions are rounded to multiples of positionQuantum and headings to
+    // multiples of headingQuantum. Level is the zlib compression level.
+    bool Open(std::string, double positionQuantum = 1e-3, double headingQuantum = 1e-4, int level = 1) ;
+    bool Close() ; // writes the index, the archive is unreadable until then
+    bool IsOpen(){return out.is_open() ;}
+    
+    // One team's trajectory, every agent must have a record for every step
+    // from 0. The records may be in any order. A later block with the same
+    // epoch and team replaces an earlier one.
+    bool AddTrajectory(unsigned int epoch, unsigned int team, const std::vector<TrajectoryRecord> &) ;
+    
+    // Archive every trajectory of a TrajectoryRecorder file
+    static bool FromRecorderFile(std::string recorderFile, std::string archiveFile, double positionQuantum = 1e-3, double headingQuantum = 1e-4) ;
+  private:
+    std::ofstream out ;
+    double positionQuantum ;
+    double headingQuantum ;
+    int level ;
+    unsigned long long offset ;
+    std::vector<TrajectoryArchiveEntry> index ;
+} ;
+
+class TrajectoryArchiveReader{
+  public:
+    bool Open(std::string) ; // false if missing, not an archive or not closed
+    
+    size_t NumTrajectories(){return index.size() ;}
+    std::vector< std::pair<unsigned int, unsigned int> > GetKeys() ; // (epoch, team) in order
+    bool Contains(unsigned int epoch, unsigned int team){return index.count(std::make_pair(epoch, team)) > 0 ;}
+    double GetPositionQuantum(){return header.positionQuantum ;}
+    
+    // Records ordered by step then agent, as written by TrajectoryRecorder
+    bool ReadTrajectory(unsigned int epoch, unsigned int team, std::vector<TrajectoryRecord> &) ;
+  private:
+    std::ifstream in ;
+    TrajectoryArchiveHeader header ;
+    std::map< std::pair<unsigned int, unsigned int>, TrajectoryArchiveEntry > index ;
+} ;
+#endif // TRAJECTORY_ARCHIVE_H_
@@ -0,0 +1,172 @@
+#include <cstring>
+#include <iostream>
+#include "TrajectoryRecorder.h"
+
+TrajectoryRecorder::TrajectoryRecorder(size_t n): blockRecords(n > 0 ? n : 1), busy(false), stop(false){}
+
+TrajectoryRecorder::~TrajectoryRecorder(){
+  Close() ;
+}
+
+bool TrajectoryRecorder::Open(std::string fileName){
+  Close() ;
+  out.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc) ;
+  if (!out.is_open()){
+    std::cout << "Error: unable to open " << fileName << " for writing!\n" ;
+    return false ;
+  }
+  TrajectoryFileHeader header ;
+  std::memset(&header, 0, sizeof(header)) ;
+  std::memcpy(header.magic, "AADILTRJ", 8) ;
+  header.version = TRAJECTORY_FILE_VERSION ;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header)) ;
+  
+  filling.reserve(blockRecords) ;
+  writing.reserve(blockRecords) ;
+  busy = false ;
+  stop = false ;
+  worker = std::thread(&TrajectoryRecorder::Run, this) ;
+  return true ;
+}
+
+void TrajectoryRecorder::Close(){
+  if (!out.is_open())
+    return ;
+  Flush() ;
+  {
+    std::unique_lock<std::mutex> guard(lock) ;
+    stop = true ;
+  }
+  signal.notify_all() ;
+  worker.join() ;
+  out.close() ;
+  std::vector<TrajectoryRecord>().swap(filling) ;
+  std::vector<TrajectoryRecord>().swap(writing) ;
+}
+
+void TrajectoryRecorder::Append(const TrajectoryRecord & r){
+  if (!out.is_open())
+    return ;
+  filling.push_back(r) ;
+  if (filling.size() >= blockRecords)
+    HandOff() ;
+}
+
+void TrajectoryRecorder::Append(unsigned int epoch, unsigned int team, unsigned int step, unsigned int agent, double x, double y, double psi){
+  TrajectoryRecord r = {epoch, team, step, agent, x, y, psi} ;
+  Append(r) ;
+}
+
+// Swap the filled block with the writer's, waiting for the previous write
+void TrajectoryRecorder::HandOff(){
+  if (filling.empty())
+    return ;
+  {
+    std::unique_lock<std::mutex> guard(lock) ;
+    signal.wait(guard, [this]{ return !busy ; }) ;
+    writing.swap(filling) ;
+    busy = true ;
+  }
+  signal.notify_all() ;
+  filling.clear() ;
+}
+
+void TrajectoryRecorder::Flush(){
+  HandOff() ;
+  std::unique_lock<std::mutex> guard(lock) ;
+  signal.wait(guard, [this]{ return !busy ; }) ;
+  out.flush() ;
+}
+
+void TrajectoryRecorder::Run(){
+  std::unique_lock<std::mutex> guard(lock) ;
+  while (true){
+    signal.wait(guard, [this]{ return busy || stop ; }) ;
+    if (!busy && stop)
+      break ;
+    guard.unlock() ;
+    
+    if (out.is_open())
+      WriteBlock(writing) ;
+    
+    guard.lock() ;
+    writing.clear() ;
+    busy = false ;
+    signal.notify_all() ;
+  }
+}
+
+void TrajectoryRecorder::WriteBlock(const std::vector<TrajectoryRecord> & records){
+  size_t n = records.size() ;
+  TrajectoryBlockHeader header ;
+  std::memcpy(header.magic, "TRJBLOCK", 8) ;
+  header.numRecords = n ;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header)) ;
+  
+  std::vector<unsigned int> ints(n) ;
+  for (size_t k = 0; k < 4; k++){
+    for (size_t i = 0; i < n; i++)
+      ints[i] = (k == 0) ? records[i].epoch : (k == 1) ? records[i].team : (k == 2) ? records[i].step : records[i].agent ;
+    out.write(reinterpret_cast<const char *>(ints.data()), n*sizeof(unsigned int)) ;
+  }
+  std::vector<double> values(n) ;
+  for (size_t k = 0; k < 3; k++){
+    for (size_t i = 0; i < n; i++)
+      values[i] = (k == 0) ? records[i].x : (k == 1) ? records[i].y : records[i].psi ;
+    out.write(reinterpret_cast<const char *>(values.data()), n*sizeof(double)) ;
+  }
+  if (out.fail())
+    std::cout << "Error: failed to write trajectory block!\n" ;
+}
+
+bool TrajectoryRecorder::Read(std::string fileName, std::vector<TrajectoryRecord> & records){
+  records.clear() ;
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary) ;
+  TrajectoryFileHeader header ;
+  if (!in.is_open() || !in.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, "AADILTRJ", 8) != 0 || header.version != TRAJECTORY_FILE_VERSION){
+    std::cout << "Error: " << fileName << " is not a trajectory file!\n" ;
+    return false ;
+  }
+  
+  TrajectoryBlockHeader block ;
+  while (in.read(reinterpret_cast<char *>(&block), sizeof(block))){
+    size_t n = block.numRecords ;
+    if (std::memcmp(block.magic, "TRJBLOCK", 8) != 0 || n > (1ULL << 32)){
+      std::cout << "Warning: ignoring malformed trajectory block in " << fileName << "\n" ;
+      break ;
+    }
+    std::vector<unsigned int> ints(4*n) ;
+    std::vector<double> values(3*n) ;
+    if (!in.read(reinterpret_cast<char *>(ints.data()), ints.size()*sizeof(unsigned int)) || !in.read(reinterpret_cast<char *>(values.data()), values.size()*sizeof(double))){
+      std::cout << "Warning: ignoring incomplete trajectory block at the end of " << fileName << "\n" ;
+      break ;
+    }
+    for (size_t i = 0; i < n; i++){
+      TrajectoryRecord r = {ints[i], ints[n+i], ints[2*n+i], ints[3*n+i], values[i], values[n+i], values[2*n+i]} ;
+      records.push_back(r) ;
+    }
+  }
+  return true ;
+}
+
+bool TrajectoryRecorder::WriteCSV(std::string binaryFile, std::string csvFile){
+  std::vector<TrajectoryRecord> records ;
+  if (!Read(binaryFile, records))
+    return false ;
+  return WriteCSV(records, csvFile) ;
+}
+
+bool TrajectoryRecorder::WriteCSV(const std::vector<TrajectoryRecord> & records, std::string csvFile){
+  std::ofstream csv(csvFile.c_str()) ;
+  if (!csv.is_open()){
+    std::cout << "Error: unable to open " << csvFile << " for writing!\n" ;
+    return false ;
+  }
+  csv.precision(17) ;
+  csv << "epoch,team,step,agent,x,y,psi\n" ;
+  for (size_t i = 0; i < records.size(); i++){
+    const TrajectoryRecord & r = records[i] ;
+    csv << r.epoch << "," << r.team << "," << r.step << "," << r.agent << "," << r.x << "," << r.y << "," << r.psi << "\n" ;
+  }
+  return csv.good() ;
+}
@@ -0,0 +1,79 @@
+// Binary trajectory log. Records are appended to one block while a background
+// thread writes the previous one, so the simulation thread only copies a few
+// numbers per agent and step. The blocks and the thread only exist while a
+// file is open, so an unused recorder costs nothing. On disk each block stores
+// its records column by column: a block header, then the epochs, teams, steps
+// and agents (uint32) and the x, y and psi values (double) of all its records.
+#ifndef TRAJECTORY_RECORDER_H_
+#define TRAJECTORY_RECORDER_H_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+
+struct TrajectoryRecord{
+  unsigned int epoch ;
+  unsigned int team ; // team column within the epoch
+  unsigned int step ;
+  unsigned int agent ;
+  double x ;
+  double y ;
+  double psi ;
+} ;
+
+struct TrajectoryFileHeader{
+  char magic[8] ; // "AADILTRJ"
+  unsigned int version ;
+  unsigned int reserved ;
+} ;
+
+struct TrajectoryBlockHeader{
+  char magic[8] ; // "TRJBLOCK"
+  unsigned long long numRecords ;
+} ;
+
+const unsigned int TRAJECTORY_FILE_VERSION = 1 ;
+
+class TrajectoryRecorder{
+  public:
+    TrajectoryRecorder(size_t blockRecords = 1 << 14) ;
+    ~TrajectoryRecorder() ; // closes the file after writing any buffered records
+    
+    bool Open(std::string) ; // starts a new file, replacing any existing one
+    void Close() ; // writes buffered records and stops the writer thread
+    bool IsOpen(){return out.is_open() ;}
+    
+    // Records appended while no file is open are dropped
+    void Append(const TrajectoryRecord &) ;
+    void Append(unsigned int epoch, unsigned int team, unsigned int step, unsigned int agent, double x, double y, double psi) ;
+    
+    // Block until every appended record is on disk
+    void Flush() ;
+    
+    // All records of a file in order. A block cut short at the end of the file
+    // is ignored. Returns false if the file is missing or not a trajectory file.
+    static bool Read(std::string, std::vector<TrajectoryRecord> &) ;
+    
+    // epoch,team,step,agent,x,y,psi with a header line
+    static bool WriteCSV(std::string binaryFile, std::string csvFile) ;
+    static bool WriteCSV(const std::vector<TrajectoryRecord> &, std::string csvFile) ;
+  private:
+    size_t blockRecords ;
+    std::ofstream out ;
+    std::vector<TrajectoryRecord> filling ; // appended to by the caller
+    std::vector<TrajectoryRecord> writing ; // owned by the writer thread while busy
+    
+    std::thread worker ;
+    std::mutex lock ;
+    std::condition_variable signal ;
+    bool busy ;
+    bool stop ;
+    
+    void HandOff() ;
+    void Run() ;
+    void WriteBlock(const std::vector<TrajectoryRecord> &) ;
+} ;
+#endif // TRAJECTORY_RECORDER_H_
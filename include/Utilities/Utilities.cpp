@@ -1,9 +1,35 @@
+#include <sstream>
 #include "Utilities.h"
 
 namespace easymath{
+std::mt19937 & generator(){
+  static thread_local std::mt19937 engine ;
+  return engine ;
+}
+
+void seed_generator(unsigned s){
+  generator().seed(s) ;
+}
+
+std::string get_generator_state(){
+  std::stringstream state ;
+  state << generator() ;
+  return state.str() ;
+}
+
+bool set_generator_state(const std::string & s){
+  std::stringstream state(s) ;
+  std::mt19937 engine ;
+  state >> engine ;
+  if (state.fail())
+    return false ;
+  generator() = engine ;
+  return true ;
+}
+
 double rand_interval(double low, double high){
-  double r = static_cast<double>(rand()) / static_cast<double>(RAND_MAX);
-  return r*(high - low) + low;
+  std::uniform_real_distribution<double> dist(0.0, 1.0) ;
+  return dist(generator())*(high - low) + low;
 }
 
 // Normalise angles between +/-PI
@@ -7,10 +7,24 @@
 #endif
 
 #include <vector>
+#include <string>
+#include <random>
 #include <math.h>
 #include <stdlib.h>
 
 namespace easymath{
+// Random engine used for every random draw in the library (weight
+// initialisation, mutation, team shuffling, world generation). Each thread owns
+// its own engine, so a thread's stream can be seeded, saved and restored.
+std::mt19937 & generator() ;
+
+// Reseed the calling thread's engine
+void seed_generator(unsigned) ;
+
+// Textual snapshot of the calling thread's engine state, and its inverse
+std::string get_generator_state() ;
+bool set_generator_state(const std::string &) ;
+
 // Returns a random number between two values
 double rand_interval(double low, double high) ;
 
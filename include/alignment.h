@@ -71,6 +71,14 @@ class Alignment {
     }
   }
 
+  // Rebuild a stored alignment from its score and magnitude
+  static Alignment fromParts(int score, double mag) {
+    Alignment a;
+    a.align_score = score;
+    a.align_mag = mag;
+    return a;
+  }
+
   int alignScore() const { return align_score; }
   double alignMag() const { return align_mag; }
   
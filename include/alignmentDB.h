@@ -0,0 +1,113 @@
+/*******************************************************************************
+alignmentDB.h
+
+Persistent alignment database. A file holds a header followed by any number
+of shards, each a set of state keys with their alignments and an implicit
+kd-tree over the keys. Files are memory mapped and searched in place, so
+opening one is cheap and processes using the same file share its pages.
+New shards are appended to the end without touching the existing ones.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef ALIGNMENT_DB_H_
+#define ALIGNMENT_DB_H_
+
+#include "alignment.h"
+
+#include <vector>
+#include <cstddef>
+
+/**
+   File layout, every section starts on an 8 byte boundary:
+     header                       AlignmentDBHeader
+     shards, one after the other:
+       shard header               AlignmentDBShard, offsets relative to the shard
+       keys                       numKeys x dim doubles, in implicit kd-tree order
+       split axes                 numKeys uint32
+       alignment scores           numKeys x numAlignments int32
+       alignment magnitudes       numKeys x numAlignments doubles
+   A shard cut short by an interrupted append is ignored when opening, and
+   removed by the next append.
+ **/
+struct AlignmentDBHeader {
+  char magic[8]; // "ALIGNDB\0"
+  unsigned int version;
+  unsigned int reserved;
+  unsigned long long dim;
+  unsigned long long numAlignments; // alignments stored per key
+};
+
+struct AlignmentDBShard {
+  char magic[8]; // "ALSHARD\0"
+  unsigned long long numKeys;
+  unsigned long long keysOffset;
+  unsigned long long axesOffset;
+  unsigned long long scoresOffset;
+  unsigned long long magsOffset;
+  unsigned long long shardSize;
+};
+
+const unsigned int ALIGNMENT_DB_VERSION = 1;
+
+class AlignmentDB {
+ public:
+  AlignmentDB();
+  ~AlignmentDB();
+  AlignmentDB(const AlignmentDB&) = delete;
+  AlignmentDB& operator=(const AlignmentDB&) = delete;
+
+  // Append a shard of keys (consecutive runs of dim values) and their
+  // alignments, creating the file if needed. Fails if the file holds keys of
+  // a different size or a different number of alignments per key.
+  static bool appendShard(const char* fName, size_t dim,
+			  const std::vector<double>& keys,
+			  const std::vector< std::vector<Alignment> >& values);
+
+  bool open(const char* fName); // false if the file is missing or malformed
+  void close();
+  bool isOpen() const { return data != NULL; }
+
+  size_t dim() const { return header->dim; }
+  size_t numAlignments() const { return header->numAlignments; }
+  size_t numShards() const { return shards.size(); }
+  size_t shardSize(size_t s) const { return shards[s]->numKeys; }
+  size_t size() const;
+
+  const double* getKey(size_t shard, size_t i) const;
+  std::vector<Alignment> getAlignments(size_t shard, size_t i) const;
+
+  // Alignments of the nearest stored state over all shards, the earliest
+  // shard wins ties. Empty if there are none or the state has the wrong size.
+  std::vector<Alignment> getAlignmentsNN(const std::vector<double>&) const;
+
+ private:
+  int fd;
+  const char* data;
+  size_t fileSize;
+  size_t validSize; // bytes up to the end of the last valid shard
+  const AlignmentDBHeader* header;
+  std::vector<const AlignmentDBShard*> shards;
+
+  const char* shardData(size_t s) const { return reinterpret_cast<const char*>(shards[s]); }
+};
+
+#endif // ALIGNMENT_DB_H_
@@ -28,55 +28,137 @@ SOFTWARE.
 #define ALIGNMENTS_H_
 
 #include "alignment.h"
+#include "alignmentDB.h"
 #include "Domains/MultiRover.h"
 #include "Domains/Env.h"
 #include "Domains/Objective.h"
-
-#include <unordered_map> // in place of kdtree (O(nd) nn search)
+#include "Utilities/KdTree.h"
+#include "Utilities/HnswIndex.h"
+#include "Utilities/ThreadPool.h"
 
 #include <vector>
+#include <deque>
+#include <atomic>
 #include <random>
 
-struct KeyHash {
-  std::size_t operator()(const std::vector<double>& vec) const {
-    std::size_t seed = 0;
-    for (const auto& v_i : vec) {
-      seed ^= std::hash<double>{}(v_i) + 0x9e37779b9 + (seed << 6) + (seed >> 2);
-    }
-    
-    return seed;
-  }
-};
-
-struct KeyEqual {
-  bool operator() (const std::vector<double> & lhs, const std::vector<double> & rhs) const {
-    if (lhs.size() != rhs.size()) return false;
-
-    for (size_t i = 0; i < lhs.size(); i++) {
-      if (lhs[i] != rhs[i]) return false;
-    }
-    
-    return true;
-  }
+// How a streaming table chooses which sample to drop when it is full.
+//   RESERVOIR keeps a uniform sample of every distinct state seen.
+//   LEAST_RECENTLY_QUERIED evicts a sample that has not been returned by
+//     getAlignmentsNN since the last pass of a clock hand over the table (an
+//     approximation of least recently used with one bit per sample).
+enum AlignmentEviction {RESERVOIR, LEAST_RECENTLY_QUERIED};
+
+// Monitoring counters for a streaming table
+struct AlignmentStats {
+  size_t live;      // samples currently stored
+  size_t budget;    // most samples stored at once, 0 if unbounded
+  size_t seen;      // samples that did not merge into a stored one
+  size_t merged;    // samples merged into a stored sample within epsilon
+  size_t evicted;   // stored samples removed to make room
+  size_t dropped;   // new samples not stored (reservoir only)
 };
 
+// State keys are indexed in a kd-tree, so nearest neighbour queries are
+// logarithmic in the number of stored samples. Key ids in the tree index the
+// stored alignments. A state that is already stored keeps its first
+// alignments, as with the map this replaced.
 class Alignments {
  public:
   Alignments(std::vector< Objective* >, int numberSamples);
+  ~Alignments();
+  Alignments(const Alignments&) = delete;
+  Alignments& operator=(const Alignments&) = delete;
 
+  // Generating many samples defers indexing and builds a balanced tree over
+  // all of them at the end.
   void addAlignments(int);
   void addAlignments();
+  // Generate samples on numThreads threads, each with its own worlds and
+  // copies of the objectives. A given seed gives the same table for any
+  // number of threads, streaming or not.
+  void addAlignments(int num, size_t numThreads, unsigned seed);
   void addAlignments(MultiRover* domain);
   void addAlignments(Env* env);
 
-  std::vector< Alignment > getAlignmentsNN(std::vector< double >);
+  // Alignments of the nearest stored state, empty if there are none or the
+  // state has a different size to the stored states.
+  std::vector< Alignment > getAlignmentsNN(const std::vector< double >&) const;
+
+  // Answer getAlignmentsNN from an approximate (HNSW) index instead of the
+  // kd-tree, for tables too large or high dimensional for exact search. The
+  // parameters trade build time and query time against recall, see
+  // HnswIndex.h. Queries are safe to make from many threads at once as long
+  // as no alignments are being added.
+  void useApproximateIndex(size_t M = 16, size_t efConstruction = 100, size_t efSearch = 50);
+  void setApproximateSearchWidth(size_t efSearch);
+  bool isApproximate() const { return approxIndex != NULL; }
+
+  // Fraction of the query states for which the approximate index returns a
+  // nearest state as close as the exact search does.
+  double approximateRecall(const std::vector< std::vector<double> >&) const;
+
+  size_t size() const;
+
+  // Streaming mode bounds memory for long running generators. A new sample
+  // within epsilon of a stored state is merged into it with
+  // Alignment::mappend, otherwise it is stored, evicting a sample chosen by
+  // the policy once maxSamples are stored. Streaming tables use the exact
+  // index only, and must be set up before any alignments are added.
+  void setStreaming(size_t maxSamples, double epsilon,
+		    AlignmentEviction policy = RESERVOIR);
+  bool isStreaming() const { return budget > 0; }
+  AlignmentStats getStats() const;
+
+  // Append the samples added since the last write (or read) to an alignment
+  // database file as a new shard, see alignmentDB.h. Stored samples of a
+  // streaming table change as samples merge into them and are evicted, so a
+  // streaming table replaces the file with a single shard of its samples.
+  bool writeDatabase(const char* fName);
+  // Add every sample stored in an alignment database.
+  bool readDatabase(const char* fName);
+  // Answer getAlignmentsNN straight from a mapped alignment database, without
+  // copying its samples into the table. The table must be empty, and is read
+  // only afterwards: samples cannot be added and it cannot stream or use an
+  // approximate index.
+  bool openDatabase(const char* fName);
+  bool isReadOnly() const { return db != NULL; }
   
  private:
-  std::unordered_map< std::vector< double >, std::vector< Alignment >, KeyHash, KeyEqual > alignments;
+  KdTree* index; // created with the size of the first state key
+  HnswIndex* approxIndex; // same ids as index when set
+  AlignmentDB* db; // set in read only mode, which has no index
+  std::vector< std::vector< Alignment > > values; // by key id
+  size_t numSaved; // samples already in the database file
   std::vector< Objective* > objs;
-  
-  double distance(std::vector<double>, std::vector<double>);
   int numSamples;
+
+  // Keys waiting for a bulk build, stored flat
+  bool deferIndex;
+  std::vector<double> pendingKeys;
+  std::vector< std::vector< Alignment > > pendingValues;
+
+  // Streaming state
+  size_t budget;
+  double mergeRadius;
+  AlignmentEviction eviction;
+  AlignmentStats stats;
+  std::mt19937 streamRng; // reservoir draws, apart from the per thread generators
+  std::vector<size_t> liveIds; // for uniform eviction
+  std::vector<size_t> livePos; // by key id, position in liveIds
+  mutable std::deque< std::atomic<unsigned char> > referenced; // by key id, set by queries
+  size_t clockHand;
+  size_t numRemoved; // key ids removed since the last compaction
+
+  void streamAlignment(const std::vector<double>&, const std::vector<Alignment>&);
+  void evict(size_t);
+  size_t clockVictim();
+  void compact();
+
+  std::vector<Alignment> scoreAlignments(Env*, const std::vector<Objective*>&) const;
+  void sampleWorld(const std::vector<Objective*>&, std::vector< std::vector<double> >&,
+		   std::vector<Alignment>&) const;
+  void insertAlignment(const std::vector<double>&, const std::vector<Alignment>&);
+  void buildIndex();
 };
 
 
@@ -0,0 +1,67 @@
+/*******************************************************************************
+experimentSweep.h
+
+Expands a parameter sweep in the config file into experiments, trains them
+on a pool of worker processes and gathers their fitness curves into one table.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef _EXPERIMENT_SWEEP_H
+#define _EXPERIMENT_SWEEP_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include "yaml-cpp/yaml.h"
+#include "yaml_constants.h"
+
+// One job of a sweep: the base experiment with some parameters replaced
+struct SweepJob {
+  std::string name;                 // <base>_<param><value>..., also its directory
+  std::vector<std::string> values;  // value of each of sweepParamsS in the job
+  YAML::Node node;                  // complete experiment node
+};
+
+// Expands the "sweep" node of the config into jobs. Every key of sweepParamsS
+//   given in the sweep holds a list of values; other parameters come from the
+//   base experiment. In grid mode every combination is a job, in random mode
+//   "samples" distinct combinations are drawn with the seed. Jobs are in the
+//   same order for the same config and seed. Returns no jobs if the sweep is
+//   malformed.
+std::vector<SweepJob> expandSweep(YAML::Node config, unsigned seed);
+
+// Trains one job in a worker process with the given seed, returning its exit
+//   status (runExperiment in the experiment driver)
+typedef std::function<int(const SweepJob&, unsigned)> SweepRunner;
+
+// Trains the jobs with run on a pool of worker processes (job i is seeded
+//   with seed + i) under topDir. As each job finishes, its exit status, wall time
+//   and peak resident memory are appended to <topDir>/sweep_jobs.csv. Jobs
+//   that already finished successfully according to that file are skipped,
+//   so rerunning an interrupted sweep resumes it. Finally every job's
+//   parameters, accounting and fitness curve (see trainDomain) are written
+//   as one row of <topDir>/sweep_summary.csv. Returns the number of jobs that
+//   have not finished successfully.
+int runSweep(const std::vector<SweepJob>& jobs, std::string topDir,
+	     unsigned seed, size_t workers, SweepRunner run);
+
+#endif // _EXPERIMENT_SWEEP_H
@@ -44,9 +44,18 @@ void setDomain(MultiRover* domain, YAML::Node root);
 MultiRover* getDomain(YAML::Node root);
 
 void trainDomain(MultiRover* domain, YAML::Node root, std::string key, std::string topDir,  Objective* o);
-// Trains domain for specified number of epochs
+// Trains domain for specified number of epochs. When the checkpoint period is
+//   non-zero, a checkpoint of the domain is written to <topDir>/<id>_checkpoint
+//   every period epochs. When resume is set and that checkpoint exists, training
+//   continues from the epoch after the stored one.
+// The best team evaluation of every epoch is written to <topDir>/<id>_fitness,
+//   one per line (appended to when resuming).
+// While phase timing is enabled (easytime::enable), per-epoch phase totals are
+//   appended as JSON lines to <topDir>/<id>_timing and the overall number of
+//   environment steps per second is printed at the end.
 void trainDomain(MultiRover*, size_t, bool, int, std::string, std::string,
-		 std::string, bool, Objective*);
+		 std::string, bool, Objective*, size_t checkpointPeriod = 0,
+		 bool resume = false);
 
 // Trains domain a single epoch.
 void trainDomainOnce(MultiRover*, bool, bool, Objective*);
@@ -61,6 +70,12 @@ std::vector<NeuralNet> getTeam(MultiRover* domain);
 //   networks (one per agent).
 std::vector<NeuralNet> trainAndGetTeam(YAML::Node root, std::string, std::string);
 
+// Seeds the random engines with the given seed and trains the experiment
+//   described by the node, writing its files to <topDir>/<id>. Meant to run in
+//   its own process (see ProcessPool); returns the process exit status.
+int runExperiment(YAML::Node expNode, std::string id, std::string topDir,
+		  unsigned seed);
+
 AgentType stringToAgentType(std::string);
 
 void configureOutput(MultiRover*, std::string, std::string);
@@ -29,6 +29,22 @@ const string objectiveS = "objective";
 const string obsRS = "obsR";
 const string teamS = "T";
 const string globalS = "G";
+// Optional keys
+const string checkpointS = "checkpoint"; // epochs between checkpoints
+const string resumeS = "resume";         // 1 to resume from the last checkpoint
+const string genomeCacheS = "genomeCache"; // > 0 stores policies as seed chains
+const string genomeDepthS = "genomeDepth"; // longest seed chain before a full copy
+const string timingS = "timing";           // 1 to write per-phase timings
+const string binaryTrajS = "binaryTrajectories"; // 1 binary trajectories, 2 compressed archive
+// Optional keys at the top level of the config file, beside "experiments"
+const string workersS = "workers"; // experiments trained at once, each in its own process
+const string seedS = "seed";       // experiment i is seeded with seed + i
+const string sweepS = "sweep";     // replaces "experiments" with a parameter sweep
+// Keys under "sweep", which also lists values for any of sweepParamsS
+const string sweepBaseS = "base";       // experiment the sweep starts from
+const string sweepModeS = "mode";       // grid (every combination) or random
+const string sweepSamplesS = "samples"; // combinations drawn in random mode
+const vector<string> sweepParamsS = {nRovsS, nPOIsS, couplingS, cceaPopS, nStepsS};
 // Accessor methods are overloaded to accept vectors -> will nest
 const vector<string> xminS = {"world", "xmin"};
 const vector<string> yminS = {"world", "ymin"};
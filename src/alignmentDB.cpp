@@ -0,0 +1,296 @@
+/*******************************************************************************
+alignmentDB.cpp
+
+Persistent alignment database. Comments and documentation can be found in the
+header file.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "alignmentDB.h"
+#include "Utilities/KdTree.h"
+#include "Utilities/BinaryIO.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+size_t padded(size_t bytes) {
+  return (bytes + 7) / 8 * 8;
+}
+
+void writePadding(std::ostream& out, size_t bytes) {
+  const char zeros[8] = {0};
+  out.write(zeros, padded(bytes) - bytes);
+}
+}
+
+AlignmentDB::AlignmentDB()
+  : fd(-1), data(NULL), fileSize(0), validSize(0), header(NULL) {}
+
+AlignmentDB::~AlignmentDB() {
+  close();
+}
+
+bool AlignmentDB::appendShard(const char* fName, size_t dim,
+			      const std::vector<double>& keys,
+			      const std::vector< std::vector<Alignment> >& values) {
+  size_t n = values.size();
+  if (dim == 0 || keys.size() != n*dim) {
+    std::cout << "Error: alignment keys do not match the number of values!\n";
+    return false;
+  }
+  size_t numAlign = n > 0 ? values[0].size() : 0;
+  for (const auto& v : values) {
+    if (v.size() != numAlign) {
+      std::cout << "Error: every key must have the same number of alignments!\n";
+      return false;
+    }
+  }
+
+  // Check an existing header, or write a new one
+  AlignmentDBHeader h;
+  std::ifstream in(fName, std::ios::binary);
+  bool exists = in.good() && in.read(reinterpret_cast<char*>(&h), sizeof(h)).good();
+  in.close();
+  if (exists) {
+    if (std::memcmp(h.magic, "ALIGNDB", 8) != 0 || h.version != ALIGNMENT_DB_VERSION) {
+      std::cout << "Error: " << fName << " is not an alignment database!\n";
+      return false;
+    }
+    if (h.dim != dim || (n > 0 && h.numAlignments != numAlign)) {
+      std::cout << "Error: shard does not match alignment database " << fName << "!\n";
+      return false;
+    }
+    numAlign = h.numAlignments;
+  }
+  if (n == 0) {
+    return true;
+  }
+
+  // Drop a shard cut short by an interrupted append, otherwise it would hide
+  // this shard and every later one from open
+  if (exists) {
+    AlignmentDB db;
+    if (!db.open(fName)) {
+      return false;
+    }
+    size_t validSize = db.validSize;
+    bool cutShort = validSize < db.fileSize;
+    db.close();
+    if (cutShort && truncate(fName, validSize) != 0) {
+      std::cout << "Error: unable to remove the incomplete shard from " << fName << "!\n";
+      return false;
+    }
+  }
+
+  std::ofstream out(fName, std::ios::binary | std::ios::app);
+  if (!out.is_open()) {
+    std::cout << "Error: unable to open " << fName << " for writing!\n";
+    return false;
+  }
+  if (!exists) {
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "ALIGNDB", 8);
+    h.version = ALIGNMENT_DB_VERSION;
+    h.dim = dim;
+    h.numAlignments = numAlign;
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  }
+
+  std::vector<double> sorted = keys;
+  std::vector<unsigned int> axes;
+  std::vector<size_t> order = KdTree::BuildImplicit(sorted, dim, axes);
+
+  std::vector<int> scores;
+  std::vector<double> mags;
+  for (size_t i = 0; i < n; i++) {
+    for (const auto& a : values[order[i]]) {
+      scores.push_back(a.alignScore());
+      mags.push_back(a.alignMag());
+    }
+  }
+
+  AlignmentDBShard s;
+  std::memset(&s, 0, sizeof(s));
+  std::memcpy(s.magic, "ALSHARD", 8);
+  s.numKeys = n;
+  s.keysOffset = padded(sizeof(s));
+  s.axesOffset = s.keysOffset + n*dim*sizeof(double);
+  s.scoresOffset = s.axesOffset + padded(n*sizeof(unsigned int));
+  s.magsOffset = s.scoresOffset + padded(scores.size()*sizeof(int));
+  s.shardSize = s.magsOffset + mags.size()*sizeof(double);
+
+  out.write(reinterpret_cast<const char*>(&s), sizeof(s));
+  writePadding(out, sizeof(s));
+  out.write(reinterpret_cast<const char*>(sorted.data()), sorted.size()*sizeof(double));
+  out.write(reinterpret_cast<const char*>(axes.data()), axes.size()*sizeof(unsigned int));
+  writePadding(out, axes.size()*sizeof(unsigned int));
+  out.write(reinterpret_cast<const char*>(scores.data()), scores.size()*sizeof(int));
+  writePadding(out, scores.size()*sizeof(int));
+  out.write(reinterpret_cast<const char*>(mags.data()), mags.size()*sizeof(double));
+  out.close();
+  if (out.fail()) {
+    std::cout << "Error: failed to write alignment shard to " << fName << "!\n";
+    return false;
+  }
+  return true;
+}
+
+// Map the file and walk its shards, checking each fits inside the file
+bool AlignmentDB::open(const char* fName) {
+  close();
+  fd = ::open(fName, O_RDONLY);
+  if (fd < 0) {
+    std::cout << "Error: unable to open alignment database " << fName << "!\n";
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(AlignmentDBHeader)) {
+    std::cout << "Error: " << fName << " is not an alignment database!\n";
+    close();
+    return false;
+  }
+  fileSize = st.st_size;
+  void* p = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    std::cout << "Error: unable to map alignment database " << fName << "!\n";
+    close();
+    return false;
+  }
+  data = static_cast<const char*>(p);
+  header = reinterpret_cast<const AlignmentDBHeader*>(data);
+  if (std::memcmp(header->magic, "ALIGNDB", 8) != 0 ||
+      header->version != ALIGNMENT_DB_VERSION || header->dim == 0) {
+    std::cout << "Error: " << fName << " is not a valid alignment database!\n";
+    close();
+    return false;
+  }
+
+  // Sizes in the file are untrusted: every product and sum is checked for
+  // overflow, and split axes must index a key
+  unsigned long long dimN = header->dim;
+  unsigned long long numAlign = header->numAlignments;
+  unsigned long long offset = padded(sizeof(AlignmentDBHeader));
+  validSize = std::min<unsigned long long>(offset, fileSize);
+  while (offset + sizeof(AlignmentDBShard) <= fileSize) {
+    const AlignmentDBShard* s = reinterpret_cast<const AlignmentDBShard*>(data + offset);
+    unsigned long long n = s->numKeys;
+    unsigned long long keyCount, alignCount, end;
+    bool valid = std::memcmp(s->magic, "ALSHARD", 8) == 0 &&
+      s->keysOffset >= sizeof(AlignmentDBShard) && s->shardSize % 8 == 0 &&
+      easyio::checked_add(offset, s->shardSize, end) && end <= fileSize &&
+      easyio::checked_multiply(n, dimN, keyCount) &&
+      easyio::checked_multiply(n, numAlign, alignCount) &&
+      easyio::section_fits(s->keysOffset, keyCount, sizeof(double), s->axesOffset) &&
+      easyio::section_fits(s->axesOffset, n, sizeof(unsigned int), s->scoresOffset) &&
+      easyio::section_fits(s->scoresOffset, alignCount, sizeof(int), s->magsOffset) &&
+      easyio::section_fits(s->magsOffset, alignCount, sizeof(double), s->shardSize);
+    if (valid) {
+      const unsigned int* axes = reinterpret_cast<const unsigned int*>(data + offset + s->axesOffset);
+      for (unsigned long long i = 0; i < n && valid; i++) {
+	valid = axes[i] < dimN;
+      }
+    }
+    if (!valid) {
+      std::cout << "Warning: ignoring invalid or incomplete shard at the end of " << fName << "\n";
+      break;
+    }
+    shards.push_back(s);
+    offset = end;
+    validSize = end;
+  }
+  return true;
+}
+
+void AlignmentDB::close() {
+  if (data != NULL) {
+    munmap(const_cast<char*>(data), fileSize);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  fd = -1;
+  data = NULL;
+  fileSize = 0;
+  validSize = 0;
+  header = NULL;
+  shards.clear();
+}
+
+size_t AlignmentDB::size() const {
+  size_t n = 0;
+  for (const auto& s : shards) {
+    n += s->numKeys;
+  }
+  return n;
+}
+
+const double* AlignmentDB::getKey(size_t shard, size_t i) const {
+  const double* keys = reinterpret_cast<const double*>(shardData(shard) + shards[shard]->keysOffset);
+  return keys + i*header->dim;
+}
+
+std::vector<Alignment> AlignmentDB::getAlignments(size_t shard, size_t i) const {
+  size_t numAlign = header->numAlignments;
+  const int* scores = reinterpret_cast<const int*>(shardData(shard) + shards[shard]->scoresOffset);
+  const double* mags = reinterpret_cast<const double*>(shardData(shard) + shards[shard]->magsOffset);
+  std::vector<Alignment> result;
+  for (size_t a = 0; a < numAlign; a++) {
+    result.push_back(Alignment::fromParts(scores[i*numAlign+a], mags[i*numAlign+a]));
+  }
+  return result;
+}
+
+std::vector<Alignment> AlignmentDB::getAlignmentsNN(const std::vector<double>& inputState) const {
+  if (data == NULL || inputState.size() != header->dim) {
+    return std::vector<Alignment>();
+  }
+
+  bool found = false;
+  size_t bestShard = 0, bestPos = 0;
+  double bestDist = 0.0;
+  for (size_t s = 0; s < shards.size(); s++) {
+    const double* keys = getKey(s, 0);
+    const unsigned int* axes = reinterpret_cast<const unsigned int*>(shardData(s) + shards[s]->axesOffset);
+    size_t pos;
+    double sqDist;
+    if (KdTree::NearestImplicit(keys, axes, shards[s]->numKeys, header->dim,
+				inputState.data(), pos, sqDist) &&
+	(!found || sqDist < bestDist)) {
+      found = true;
+      bestShard = s;
+      bestPos = pos;
+      bestDist = sqDist;
+    }
+  }
+
+  if (!found) {
+    return std::vector<Alignment>();
+  }
+  return getAlignments(bestShard, bestPos);
+}
@@ -26,31 +26,45 @@ SOFTWARE.
 
 #include "alignments.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
 Alignments::Alignments(std::vector< Objective* > objectives, int numberSamples)
-  : objs(objectives), numSamples(numberSamples) {}
+  : index(NULL), approxIndex(NULL), db(NULL), objs(objectives), numSamples(numberSamples), numSaved(0), deferIndex(false), budget(0),
+    mergeRadius(0), eviction(RESERVOIR), stats(), clockHand(0), numRemoved(0) {}
+
+Alignments::~Alignments() {
+  delete index;
+  delete approxIndex;
+  delete db;
+}
 
 void Alignments::addAlignments(Env* env) {
+  std::vector<Alignment> scores = scoreAlignments(env, objs);
+
+  for (const auto& agent : env->getAgents()) {
+    std::vector<double> stateV = agent->getVectorState(env->getCurrentStates());
+    insertAlignment(stateV, scores);
+  }
+}
+
+std::vector<Alignment> Alignments::scoreAlignments(Env* env,
+						   const std::vector<Objective*>& objectives) const {
   std::vector<Alignment> scores;
   std::vector<double> values;
   std::vector< std::vector<double> > postVals;
 
-  for (auto& obj : objs) {
+  // Every objective scores the whole block of perturbed steps against the
+  //   shared history, which is left unchanged
+  std::vector< std::vector<State> > steps = env->randomSteps(numSamples);
+  for (auto& obj : objectives) {
     values.push_back(obj->reward(env));
-    std::vector<double> postValsForOneObj;
-    postVals.push_back(postValsForOneObj);
-  }
-
-  for (int i = 0; i < numSamples; i++) {
-    env->reset();
-    env->randomStep();
-
-    for (size_t o = 0; o < objs.size(); o++) {
-      postVals[o].push_back(objs[o]->reward(env));
-    }
+    postVals.push_back(obj->rewardAfterSteps(env, steps));
   }
 
   std::vector< std::vector< double > > deltas;
-  for (size_t i = 0; i < objs.size(); i++) {
+  for (size_t i = 0; i < objectives.size(); i++) {
     std::vector<double> deltaO;
     for (int j = 0; j < numSamples; j++) {
       double diff = postVals[i][j] - values[i];
@@ -61,7 +75,7 @@ void Alignments::addAlignments(Env* env) {
   }
 
   std::vector< double > deltaG = deltas[0];
-  for (size_t i = 1; i < objs.size(); i++) {
+  for (size_t i = 1; i < objectives.size(); i++) {
     std::vector< double > deltaO = deltas[i];
     
     Alignment result;
@@ -73,11 +87,98 @@ void Alignments::addAlignments(Env* env) {
     scores.push_back(result);
   }
 
-  for (const auto& agent : env->getAgents()) {
-    std::vector<double> stateV = agent->getVectorState(env->getCurrentStates());
-    std::pair<std::vector<double>, std::vector<Alignment>> keyVal(stateV, scores);
-    alignments.insert(keyVal);
+  return scores;
+}
+
+void Alignments::insertAlignment(const std::vector<double>& key,
+				 const std::vector<Alignment>& scores) {
+  if (db != NULL) {
+    std::cout << "Error: alignments cannot be added to a read only table!\n";
+    return;
   }
+  if (index == NULL) {
+    index = new KdTree(key.size());
+  }
+  if (key.size() != index->Dim()) {
+    std::cout << "Error: alignment state has the wrong number of elements!\n";
+    return;
+  }
+
+  if (budget > 0) {
+    streamAlignment(key, scores);
+    return;
+  }
+
+  if (deferIndex) {
+    pendingKeys.insert(pendingKeys.end(), key.begin(), key.end());
+    pendingValues.push_back(scores);
+    return;
+  }
+
+  size_t id;
+  double sqDist;
+  if (index->Nearest(key.data(), id, sqDist) && sqDist == 0) {
+    return; // already stored
+  }
+  index->Insert(key.data());
+  if (approxIndex != NULL) {
+    approxIndex->Insert(key.data());
+  }
+  values.push_back(scores);
+}
+
+// Add the pending keys to the stored keys and rebuild the tree over all of them
+void Alignments::buildIndex() {
+  if (index == NULL || pendingValues.empty()) {
+    return;
+  }
+  size_t dim = index->Dim();
+  size_t numPending = pendingValues.size();
+
+  // Order pending keys so that exact duplicates are adjacent, earliest first
+  std::vector<size_t> order(numPending);
+  for (size_t i = 0; i < numPending; i++) {
+    order[i] = i;
+  }
+  const std::vector<double>& pk = pendingKeys;
+  std::sort(order.begin(), order.end(), [&pk, dim](size_t a, size_t b) {
+      int c = 0;
+      for (size_t d = 0; d < dim && c == 0; d++) {
+	c = (pk[a*dim+d] < pk[b*dim+d]) ? -1 : (pk[b*dim+d] < pk[a*dim+d]) ? 1 : 0;
+      }
+      return c == 0 ? a < b : c < 0;
+    });
+
+  std::vector<bool> keep(numPending, false);
+  for (size_t k = 0; k < numPending; k++) {
+    size_t i = order[k];
+    if (k > 0 && std::equal(pk.begin()+i*dim, pk.begin()+(i+1)*dim,
+			    pk.begin()+order[k-1]*dim)) {
+      continue;
+    }
+    size_t id;
+    double sqDist;
+    keep[i] = !(index->Nearest(&pk[i*dim], id, sqDist) && sqDist == 0);
+  }
+
+  std::vector<double> keys;
+  keys.reserve((values.size() + numPending)*dim);
+  for (size_t i = 0; i < values.size(); i++) {
+    keys.insert(keys.end(), index->GetPoint(i), index->GetPoint(i)+dim);
+  }
+  for (size_t i = 0; i < numPending; i++) {
+    if (keep[i]) {
+      keys.insert(keys.end(), pk.begin()+i*dim, pk.begin()+(i+1)*dim);
+      values.push_back(pendingValues[i]);
+      if (approxIndex != NULL) {
+	approxIndex->Insert(&pk[i*dim]);
+      }
+    }
+  }
+  index->Build(keys);
+
+  pendingKeys.clear();
+  pendingValues.clear();
 }
   
 void Alignments::addAlignments(MultiRover* domain) {
@@ -87,16 +188,76 @@ void Alignments::addAlignments(MultiRover* domain) {
 }
 
 void Alignments::addAlignments(int num) {
+  deferIndex = true;
   for (int i = 0; i < num; i++) {
     addAlignments();
   }
+  deferIndex = false;
+  buildIndex();
 }
 
 void Alignments::addAlignments() {
-  std::random_device rd;     // only used once to initialise (seed) engine
-  std::mt19937 rng(rd());    // random-number engine used (Mersenne-Twister in this case)
-  std::uniform_int_distribution<int> uni(3,10); // guaranteed unbiased
+  std::vector< std::vector<double> > keys;
+  std::vector<Alignment> scores;
+  sampleWorld(objs, keys, scores);
+  for (const auto& key : keys) {
+    insertAlignment(key, scores);
+  }
+}
+
+// Samples are generated in batches. Sample k draws from the thread's generator
+// seeded with seed + k, so results do not depend on the number of threads or
+// on which thread ran the sample, and are merged into the index in sample order.
+void Alignments::addAlignments(int num, size_t numThreads, unsigned seed) {
+  const size_t batchSize = 256;
+  ThreadPool pool(numThreads);
+  std::string callerState = easymath::get_generator_state();
+  streamRng.seed(seed);
+
+  // Each thread scores with its own copies of the objectives
+  std::vector< std::vector<Objective*> > threadObjs(pool.NumWorkers());
+  for (auto& o : threadObjs) {
+    for (const auto& obj : objs) {
+      o.push_back(obj->copyObjective());
+    }
+  }
+
+  deferIndex = true;
+  for (size_t done = 0; done < (size_t) std::max(num, 0); ) {
+    size_t b = std::min(batchSize, (size_t) num - done);
+    std::vector< std::vector< std::vector<double> > > keys(b);
+    std::vector< std::vector<Alignment> > scores(b);
+
+    pool.ParallelFor(b, [&](size_t k, size_t w) {
+	easymath::seed_generator(seed + done + k);
+	sampleWorld(threadObjs[w], keys[k], scores[k]);
+      });
+
+    for (size_t k = 0; k < b; k++) {
+      for (const auto& key : keys[k]) {
+	insertAlignment(key, scores[k]);
+      }
+    }
+    done += b;
+  }
+  deferIndex = false;
+  buildIndex();
+
+  for (auto& o : threadObjs) {
+    for (auto& obj : o) {
+      delete obj;
+    }
+  }
+  easymath::set_generator_state(callerState);
+}
+
+// Score a random world: 3 to 10 rovers and POIs in a world 10 to 100 units a side
+void Alignments::sampleWorld(const std::vector<Objective*>& objectives,
+			     std::vector< std::vector<double> >& keys,
+			     std::vector<Alignment>& scores) const {
+  std::uniform_int_distribution<int> uni(3,10);
   std::uniform_real_distribution<double> und(10,100);
+  std::mt19937& rng = easymath::generator();
   
   double max_x = und(rng);
   double max_y = und(rng);
@@ -107,34 +268,293 @@ void Alignments::addAlignments() {
 
   MultiRover domain(world, 1, 1, pois, "", rovs);
   domain.InitialiseEpoch();
-  addAlignments(&domain);
+  Env env(domain.getWorld(), domain.getAgents(), domain.getPOIs(), domain.getNPop());
+  env.init(domain.getInitialStates());
+
+  scores = scoreAlignments(&env, objectives);
+  for (const auto& agent : env.getAgents()) {
+    keys.push_back(agent->getVectorState(env.getCurrentStates()));
+  }
 }
 
-std::vector< Alignment > Alignments::getAlignmentsNN(std::vector< double > inputState) {
-  double minDistance = DBL_MAX;
-  std::vector< Alignment > bestAlign;
-  
-  for (auto it = alignments.begin(); it != alignments.end(); ++it) {
-    double dist = distance(inputState, it->first);
-    if (dist < minDistance) {
-      bestAlign = it->second;
-      minDistance = dist;
+std::vector< Alignment > Alignments::getAlignmentsNN(const std::vector< double >& inputState) const {
+  if (db != NULL) {
+    return db->getAlignmentsNN(inputState);
+  }
+  size_t id;
+  double sqDist;
+  if (index == NULL || inputState.size() != index->Dim()) {
+    return std::vector< Alignment >();
+  }
+  bool found = (approxIndex != NULL)
+    ? approxIndex->Nearest(inputState.data(), id, sqDist)
+    : index->Nearest(inputState.data(), id, sqDist);
+  if (!found) {
+    return std::vector< Alignment >();
+  }
+  if (budget > 0) {
+    referenced[id].store(1, std::memory_order_relaxed);
+  }
+
+  return values[id];
+}
+
+size_t Alignments::size() const {
+  if (db != NULL) {
+    return db->size();
+  }
+  return index == NULL ? 0 : index->Size();
+}
+
+void Alignments::useApproximateIndex(size_t M, size_t efConstruction, size_t efSearch) {
+  if (db != NULL) {
+    std::cout << "Error: read only alignment tables cannot use an approximate index!\n";
+    return;
+  }
+  if (budget > 0) {
+    std::cout << "Error: streaming alignment tables cannot use an approximate index!\n";
+    return;
+  }
+  if (index == NULL) {
+    std::cout << "Error: alignments must be added before they can be indexed!\n";
+    return;
+  }
+  delete approxIndex;
+  approxIndex = new HnswIndex(index->Dim(), M, efConstruction);
+  approxIndex->SetEfSearch(efSearch);
+  for (size_t i = 0; i < values.size(); i++) {
+    approxIndex->Insert(index->GetPoint(i));
+  }
+}
+
+void Alignments::setApproximateSearchWidth(size_t efSearch) {
+  if (approxIndex != NULL) {
+    approxIndex->SetEfSearch(efSearch);
+  }
+}
+
+double Alignments::approximateRecall(const std::vector< std::vector<double> >& queries) const {
+  if (approxIndex == NULL || queries.empty()) {
+    return 0.0;
+  }
+
+  size_t hits = 0;
+  for (const auto& q : queries) {
+    size_t exactId, approxId;
+    double exactDist, approxDist;
+    if (q.size() != index->Dim() || !index->Nearest(q.data(), exactId, exactDist)) {
+      continue;
+    }
+    approxIndex->Nearest(q.data(), approxId, approxDist);
+    if (approxDist <= exactDist) {
+      hits++;
+    }
+  }
+
+  return ((double) hits) / queries.size();
+}
+
+
+
+bool Alignments::writeDatabase(const char* fName) {
+  if (db != NULL) {
+    std::cout << "Error: a read only table has no alignments to write!\n";
+    return false;
+  }
+  if (index == NULL) {
+    std::cout << "Error: there are no alignments to write!\n";
+    return false;
+  }
+  size_t dim = index->Dim();
+  std::vector<double> keys;
+  std::vector< std::vector<Alignment> > newValues;
+  for (size_t i = (budget > 0) ? 0 : numSaved; i < values.size(); i++) {
+    if (index->IsRemoved(i)) {
+      continue;
+    }
+    keys.insert(keys.end(), index->GetPoint(i), index->GetPoint(i)+dim);
+    newValues.push_back(values[i]);
+  }
+
+  if (budget > 0) {
+    // Write the compacted table beside the file and swap it in, so an
+    // interrupted write leaves the previous file intact
+    std::string tmpName = std::string(fName) + ".tmp";
+    std::remove(tmpName.c_str());
+    if (!AlignmentDB::appendShard(tmpName.c_str(), dim, keys, newValues) ||
+	std::rename(tmpName.c_str(), fName) != 0) {
+      std::cout << "Error: unable to replace alignment database " << fName << "!\n";
+      std::remove(tmpName.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  if (!AlignmentDB::appendShard(fName, dim, keys, newValues)) {
+    return false;
+  }
+  numSaved = values.size();
+  return true;
+}
+
+bool Alignments::readDatabase(const char* fName) {
+  if (db != NULL) {
+    std::cout << "Error: alignments cannot be added to a read only table!\n";
+    return false;
+  }
+  AlignmentDB file;
+  if (!file.open(fName)) {
+    return false;
+  }
+  if (index != NULL && index->Dim() != file.dim()) {
+    std::cout << "Error: alignment database " << fName << " has states of the wrong size!\n";
+    return false;
+  }
+
+  deferIndex = true;
+  for (size_t s = 0; s < file.numShards(); s++) {
+    for (size_t i = 0; i < file.shardSize(s); i++) {
+      std::vector<double> key(file.getKey(s, i), file.getKey(s, i)+file.dim());
+      insertAlignment(key, file.getAlignments(s, i));
     }
   }
+  deferIndex = false;
+  buildIndex();
+  numSaved = values.size();
+  return true;
+}
+
+bool Alignments::openDatabase(const char* fName) {
+  if (index != NULL || db != NULL || budget > 0) {
+    std::cout << "Error: only an empty table can be opened read only!\n";
+    return false;
+  }
+  db = new AlignmentDB();
+  if (!db->open(fName)) {
+    delete db;
+    db = NULL;
+    return false;
+  }
+  return true;
+}
+
+void Alignments::setStreaming(size_t maxSamples, double epsilon, AlignmentEviction policy) {
+  if (index != NULL || approxIndex != NULL || db != NULL) {
+    std::cout << "Error: streaming must be set before alignments are added!\n";
+    return;
+  }
+  budget = maxSamples;
+  mergeRadius = epsilon;
+  eviction = policy;
+  streamRng.seed(easymath::generator()());
+  stats = AlignmentStats();
+  stats.budget = budget;
+}
 
-  return bestAlign;
+AlignmentStats Alignments::getStats() const {
+  AlignmentStats s = stats;
+  s.live = size();
+  s.budget = budget;
+  return s;
 }
 
-double Alignments::distance(std::vector<double> vec1, std::vector<double> vec2) {
-  if (vec1.size() != vec2.size()) return DBL_MAX;
+void Alignments::streamAlignment(const std::vector<double>& key,
+				 const std::vector<Alignment>& scores) {
+  size_t id;
+  double sqDist;
+  if (index->Nearest(key.data(), id, sqDist) && sqDist <= mergeRadius*mergeRadius &&
+      values[id].size() == scores.size()) {
+    for (size_t a = 0; a < scores.size(); a++) {
+      values[id][a] = values[id][a].mappend(scores[a]);
+    }
+    stats.merged++;
+    return;
+  }
+
+  stats.seen++;
+  if (index->Size() >= budget) {
+    if (eviction == RESERVOIR) {
+      // Keep the new sample with probability budget/seen, in place of a uniform pick
+      std::uniform_int_distribution<size_t> pick(0, stats.seen - 1);
+      size_t r = pick(streamRng);
+      if (r >= budget) {
+	stats.dropped++;
+	return;
+      }
+      evict(liveIds[r % liveIds.size()]);
+    } else {
+      evict(clockVictim());
+    }
+  }
+
+  id = index->Insert(key.data());
+  values.push_back(scores);
+  referenced.emplace_back(0);
+  livePos.push_back(liveIds.size());
+  liveIds.push_back(id);
 
-  double squared_dist = 0;
-  for (size_t i = 0; i < vec1.size(); i++) {
-    double diff = vec2[i] - vec1[i];
-    squared_dist += diff*diff;
+  // Removed keys still hold memory until the table is compacted
+  if (numRemoved > budget) {
+    compact();
   }
+}
+
+void Alignments::evict(size_t id) {
+  index->Remove(id);
+  std::vector<Alignment>().swap(values[id]);
+  size_t p = livePos[id];
+  liveIds[p] = liveIds.back();
+  livePos[liveIds[p]] = p;
+  liveIds.pop_back();
+  numRemoved++;
+  stats.evicted++;
+}
 
-  return squared_dist;
+// Clock sweep: clear the reference bit of queried samples and stop at the
+// first stored sample that has not been queried since the hand last passed
+size_t Alignments::clockVictim() {
+  while (true) {
+    if (clockHand >= values.size()) {
+      clockHand = 0;
+    }
+    size_t id = clockHand++;
+    if (index->IsRemoved(id)) {
+      continue;
+    }
+    if (referenced[id].exchange(0, std::memory_order_relaxed) == 0) {
+      return id;
+    }
+  }
 }
 
+// Rebuild the index and per sample data over the stored samples only
+void Alignments::compact() {
+  size_t dim = index->Dim();
+  std::vector<double> keys;
+  std::vector< std::vector<Alignment> > live;
+  std::deque< std::atomic<unsigned char> > liveReferenced;
+  size_t hand = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (index->IsRemoved(i)) {
+      continue;
+    }
+    if (i < clockHand) {
+      hand = live.size() + 1;
+    }
+    keys.insert(keys.end(), index->GetPoint(i), index->GetPoint(i)+dim);
+    live.push_back(values[i]);
+    liveReferenced.emplace_back(referenced[i].load(std::memory_order_relaxed));
+  }
 
+  index->Build(keys);
+  values.swap(live);
+  referenced.swap(liveReferenced);
+  liveIds.resize(values.size());
+  livePos.resize(values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    liveIds[i] = i;
+    livePos[i] = i;
+  }
+  clockHand = hand;
+  numRemoved = 0;
+}
@@ -0,0 +1,217 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <map>
+
+#include "experimentSweep.h"
+#include "experimentUtil.h"
+#include "Utilities/ProcessPool.h"
+
+// Finished jobs recorded by earlier runs of a sweep. Later lines win.
+std::map<string, ProcessResult> readSweepLog(string fileName) {
+  std::map<string, ProcessResult> done;
+  std::ifstream log(fileName.c_str());
+  string line;
+  std::getline(log, line); // header
+  while (std::getline(log, line)) {
+    std::stringstream row(line);
+    string name, field;
+    ProcessResult r;
+    if (!std::getline(row, name, ',')) continue;
+    if (!std::getline(row, field, ',')) continue;
+    r.status = std::atoi(field.c_str());
+    if (!std::getline(row, field, ',')) continue;
+    r.seconds = std::atof(field.c_str());
+    if (!std::getline(row, field, ',')) continue;
+    r.peakRSS = std::atol(field.c_str());
+    done[name] = r;
+  }
+  return done;
+}
+
+// Best team evaluation of every epoch of a job
+vector<double> readFitnessCurve(string fileName) {
+  vector<double> curve;
+  std::ifstream in(fileName.c_str());
+  double f;
+  while (in >> f) {
+    curve.push_back(f);
+  }
+  return curve;
+}
+
+vector<SweepJob> expandSweep(YAML::Node config, unsigned seed) {
+  vector<SweepJob> jobs;
+  YAML::Node sweep = config[sweepS];
+  if (!sweep[sweepBaseS] || !config[sweep[sweepBaseS].as<string>()]) {
+    std::cout << "Error: sweep needs a base experiment!\n";
+    return jobs;
+  }
+  string base = sweep[sweepBaseS].as<string>();
+  YAML::Node baseNode = config[base];
+
+  string mode = sweep[sweepModeS] ? sweep[sweepModeS].as<string>() : "grid";
+  if (mode != "grid" && mode != "random") {
+    std::cout << "Error: sweep mode must be grid or random!\n";
+    return jobs;
+  }
+
+  for (YAML::const_iterator it = sweep.begin(); it != sweep.end(); ++it) {
+    string key = it->first.as<string>();
+    if (key != sweepBaseS && key != sweepModeS && key != sweepSamplesS &&
+	std::find(sweepParamsS.begin(), sweepParamsS.end(), key) == sweepParamsS.end()) {
+      std::cout << "Error: " << key << " cannot be swept!\n";
+      return jobs;
+    }
+  }
+
+  // Values of each parameter, a single one (the base value) when not swept
+  vector< vector<YAML::Node> > values;
+  size_t combinations = 1;
+  for (auto& key : sweepParamsS) {
+    vector<YAML::Node> v;
+    if (sweep[key]) {
+      for (YAML::const_iterator it = sweep[key].begin(); it != sweep[key].end(); ++it) {
+	v.push_back(*it);
+      }
+      if (v.empty()) {
+	std::cout << "Error: sweep over " << key << " has no values!\n";
+	return jobs;
+      }
+    } else {
+      v.push_back(baseNode[key]);
+    }
+    values.push_back(v);
+    combinations *= v.size();
+  }
+
+  // Combinations are numbered with the first parameter varying slowest
+  vector<size_t> chosen(combinations);
+  std::iota(chosen.begin(), chosen.end(), 0);
+  if (mode == "random") {
+    size_t samples = sweep[sweepSamplesS] ? sweep[sweepSamplesS].as<size_t>() : 1;
+    samples = std::min(samples, combinations);
+    std::mt19937 engine(seed);
+    for (size_t i = 0; i < samples; i++) { // partial Fisher-Yates shuffle
+      std::uniform_int_distribution<size_t> pick(i, combinations - 1);
+      std::swap(chosen[i], chosen[pick(engine)]);
+    }
+    chosen.resize(samples);
+    std::sort(chosen.begin(), chosen.end());
+  }
+
+  for (auto c : chosen) {
+    SweepJob job;
+    job.name = base;
+    job.node = YAML::Clone(baseNode);
+    size_t stride = combinations;
+    for (size_t p = 0; p < sweepParamsS.size(); p++) {
+      stride /= values[p].size();
+      const YAML::Node& value = values[p][(c / stride) % values[p].size()];
+      job.values.push_back(value.as<string>());
+      if (sweep[sweepParamsS[p]]) {
+	job.node[sweepParamsS[p]] = value;
+	job.name += "_" + sweepParamsS[p] + job.values.back();
+      }
+    }
+    jobs.push_back(job);
+  }
+
+  return jobs;
+}
+
+void writeSweepSummary(const vector<SweepJob>& jobs,
+		       std::map<string, ProcessResult>& done, string topDir) {
+  vector< vector<double> > curves;
+  size_t nEpochs = 0;
+  for (auto& job : jobs) {
+    curves.push_back(readFitnessCurve(topDir + "/" + job.name + "/" + job.name
+				      + "_fitness"));
+    nEpochs = std::max(nEpochs, curves.back().size());
+  }
+
+  std::ofstream summary((topDir + "/sweep_summary.csv").c_str());
+  summary << "job";
+  for (auto& key : sweepParamsS) {
+    summary << "," << key;
+  }
+  summary << ",status,seconds,peakRSS_kB,final,best";
+  for (size_t n = 0; n < nEpochs; n++) {
+    summary << ",epoch_" << n;
+  }
+  summary << std::endl;
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    summary << jobs[i].name;
+    for (auto& v : jobs[i].values) {
+      summary << "," << v;
+    }
+    if (done.count(jobs[i].name)) {
+      const ProcessResult& r = done[jobs[i].name];
+      summary << "," << r.status << "," << r.seconds << "," << r.peakRSS;
+    } else {
+      summary << ",,,";
+    }
+    const vector<double>& curve = curves[i];
+    if (curve.empty()) {
+      summary << ",,";
+    } else {
+      summary << "," << curve.back() << ","
+	      << *std::max_element(curve.begin(), curve.end());
+    }
+    for (size_t n = 0; n < nEpochs; n++) {
+      summary << ",";
+      if (n < curve.size()) summary << curve[n];
+    }
+    summary << std::endl;
+  }
+}
+
+int runSweep(const vector<SweepJob>& jobs, string topDir, unsigned seed,
+	     size_t workers, SweepRunner run) {
+  string logName = topDir + "/sweep_jobs.csv";
+  std::map<string, ProcessResult> done = readSweepLog(logName);
+
+  vector<size_t> pending;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (!done.count(jobs[i].name) || done[jobs[i].name].status != 0) {
+      pending.push_back(i);
+    }
+  }
+  if (pending.size() < jobs.size()) {
+    std::cout << "Resuming sweep: " << jobs.size() - pending.size() << " of "
+	      << jobs.size() << " jobs already complete" << std::endl;
+  }
+
+  bool newLog = !std::ifstream(logName.c_str()).good();
+  std::ofstream log(logName.c_str(), std::ios::app);
+  if (newLog) {
+    log << "job,status,seconds,peakRSS_kB" << std::endl;
+  }
+
+  ProcessPool pool(workers);
+  pool.Run(pending.size(), [&](size_t k) {
+      const SweepJob& job = jobs[pending[k]];
+      return run(job, seed + pending[k]);
+    }, [&](size_t k, const ProcessResult& r) {
+      const string& name = jobs[pending[k]].name;
+      log << name << "," << r.status << "," << r.seconds << "," << r.peakRSS
+	  << std::endl;
+      done[name] = r;
+      if (r.status != 0) {
+	std::cout << "Error: sweep job " << name << " exited with status "
+		  << r.status << "!\n";
+      }
+    });
+
+  writeSweepSummary(jobs, done, topDir);
+
+  int failed = 0;
+  for (auto& job : jobs) {
+    if (!done.count(job.name) || done[job.name].status != 0) failed++;
+  }
+  return failed;
+}
@@ -25,6 +25,10 @@ SOFTWARE.
 #include <iostream>
 #include <vector>
 #include <string>
+#include <fstream>
+#include <algorithm>
+#include <ctime>
+#include <cstdlib>
 #include <Eigen/Eigen>
 
 #include "Domains/MultiRover.h"
@@ -35,6 +39,10 @@ SOFTWARE.
 #include "Domains/TeamForming.h"
 
 #include "alignments.h"
+#include "experimentSweep.h"
+#include "Utilities/PhaseTimer.h"
+#include "Utilities/ProcessPool.h"
+#include "Utilities/Utilities.h"
 
 using std::vector ;
 using std::string ;
@@ -72,8 +80,39 @@ AgentType stringToAgentType(std::string type) {
 }
 
 void trainDomain(MultiRover* domain, size_t epochs, bool output, int outputPeriod,
-		 string exp, string topDir, string id, bool init, Objective* o) {
-  for (size_t n = 0; n < epochs; n++) {
+		 string exp, string topDir, string id, bool init, Objective* o,
+		 size_t checkpointPeriod, bool resume) {
+  string checkpointFile = topDir + "/" + id + "_checkpoint";
+  size_t start = 0;
+  size_t lastEpoch;
+  if (resume && domain->ReadCheckpoint(checkpointFile, lastEpoch)) {
+    start = lastEpoch + 1;
+    std::cout << "Resuming " << id << " from epoch " << start << std::endl;
+  }
+
+  // Best team evaluation of every epoch, one per line. When resuming, epochs
+  //   after the checkpoint are dropped since they are trained again.
+  string fitnessName = topDir + "/" + id + "_fitness";
+  vector<string> kept;
+  std::ifstream previous(fitnessName.c_str());
+  string line;
+  while (kept.size() < start && std::getline(previous, line)) {
+    kept.push_back(line);
+  }
+  previous.close();
+  std::ofstream fitnessFile(fitnessName.c_str());
+  for (auto& l : kept) {
+    fitnessFile << l << std::endl;
+  }
+
+  std::ofstream timingFile;
+  if (easytime::is_enabled()) {
+    timingFile.open((topDir + "/" + id + "_timing").c_str(), std::ios::app);
+  }
+  unsigned long long totalSteps = 0;
+  unsigned long long totalNs = 0;
+  
+  for (size_t n = start; n < epochs; n++) {
     if (output && (n % outputPeriod == 0 || n == epochs - 1)) {
       std::cout << "Training " << id << " Episode " << n << "...";
       domain->setVerbose(true);
@@ -84,11 +123,31 @@ void trainDomain(MultiRover* domain, size_t epochs, bool output, int outputPerio
       configureOutput(domain, topDir, id);
     }
 
+    easytime::reset();
     trainDomainOnce(domain, (n==0), init, o);
+    fitnessFile << domain->getMaxEval() << std::endl;
+    if (easytime::is_enabled()) {
+      easytime::totals t = easytime::snapshot();
+      timingFile << easytime::to_json(t, n) << std::endl;
+      totalSteps += t.calls[easytime::STEP];
+      totalNs += t.ns[easytime::TRAIN];
+    }
+
+    if (checkpointPeriod > 0 && (n + 1) % checkpointPeriod == 0) {
+      domain->WriteCheckpoint(checkpointFile, n);
+    }
+  }
+
+  domain->FlushCheckpoints();
+
+  if (easytime::is_enabled() && totalNs > 0) {
+    std::cout << id << ": " << totalSteps << " steps at "
+	      << totalSteps/(totalNs/1.0e9) << " steps/sec" << std::endl;
   }
 }
 
 void trainDomainOnce(MultiRover* domain, bool evolve, bool init, Objective* o) {
+  easytime::ScopedTimer timer(easytime::TRAIN);
   domain->EvolvePolicies(evolve);
   if (init) {
     domain->InitialiseEpoch();
@@ -137,6 +196,14 @@ MultiRover* getDomain(YAML::Node root) {
     domain->setBias(false);
   }
 
+  if (root[genomeCacheS]) {
+    size_t cacheSize = size_tFromYAML(root, genomeCacheS);
+    size_t depth = root[genomeDepthS] ? size_tFromYAML(root, genomeDepthS) : 16;
+    if (cacheSize > 0) {
+      domain->setGenomeStorage(cacheSize, depth);
+    }
+  }
+
   return domain;
 }
 
@@ -173,7 +240,7 @@ void setDomain(MultiRover* domain, YAML::Node root) {
 }
 
 std::vector<NeuralNet> getTeam(MultiRover* domain) {
-  std::vector<NeuralNet*> myNets = domain->getNNTeam();
+  std::vector< std::shared_ptr<NeuralNet> > myNets = domain->getNNTeam();
   std::vector<NeuralNet> returnNets;
   
   for (auto& net : myNets) {
@@ -194,8 +261,14 @@ void trainDomain(MultiRover* domain, YAML::Node root, std::string key, std::stri
 
   int staticOrRandom = intFromYAML(root, staticOrRandomS);
   bool random = staticOrRandom == 1;
+
+  size_t checkpointPeriod = root[checkpointS] ? size_tFromYAML(root, checkpointS) : 0;
+  bool resume = root[resumeS] && intFromYAML(root, resumeS) == 1;
+  easytime::enable(root[timingS] && intFromYAML(root, timingS) == 1);
+  domain->setBinaryTrajectories(root[binaryTrajS] ? intFromYAML(root, binaryTrajS) : 0);
   
-  trainDomain(domain, nEps, toOutput, 20, type, topDir, key, random, o);
+  trainDomain(domain, nEps, toOutput, 20, type, topDir, key, random, o,
+	      checkpointPeriod, resume);
 }
 
 void configureOutput(MultiRover* domain, string fileDir, string id) {
@@ -204,7 +277,33 @@ void configureOutput(MultiRover* domain, string fileDir, string id) {
   string poiFile    = fileDir + "/" + id + "_POIs";
   string choiceFile = fileDir + "/" + id + "_choices";
   domain->OutputPerformance(resultFile);
-  domain->OutputTrajectories(trajFile, poiFile, choiceFile);
+  if (domain->getBinaryTrajectories() == 2) {
+    domain->ArchiveTrajectories(trajFile + ".tra", poiFile);
+  } else if (domain->getBinaryTrajectories() == 1) {
+    domain->RecordTrajectories(trajFile + ".bin", poiFile);
+  } else {
+    domain->OutputTrajectories(trajFile, poiFile, choiceFile);
+  }
+}
+
+// Trains one experiment with its own random stream, writing its files under
+//   topDir/id. Runs in a worker process; the return value is its exit
+//   status.
+int runExperiment(YAML::Node expNode, string id, string topDir,
+		  unsigned seed) {
+  easymath::seed_generator(seed);
+  std::srand(seed);
+
+  string expDir = topDir + "/" + id;
+  makeDir(expDir);
+
+  MultiRover* domain = getDomain(expNode);
+  Objective* g = objFromYAML(expNode, objectiveS);
+  trainDomain(domain, expNode, id, expDir, g);
+
+  delete domain; // closes output and trajectory files
+  delete g;
+  return 0;
 }
 
 int main() {
@@ -239,14 +338,46 @@ int main() {
   vector< Env* > envs;
   vector< vector<size_t>> inds;
 
-  MultiRover* domain;
-  Objective* g;
-  for (auto& expKey : experimentStrings) {
-    YAML::Node expNode = nodeFromYAML(config, expKey);
+  // Experiments run side by side in worker processes
+  unsigned seed = config[seedS] ? (unsigned) size_tFromYAML(config, seedS)
+                                : (unsigned) std::time(0);
 
-    domain = getDomain(expNode);
-    g = objFromYAML(expNode, objectiveS);
-    trainDomain(domain, expNode, expKey, fileDir, g);
+  // A sweep replaces the experiments list
+  if (config[sweepS]) {
+    vector<SweepJob> jobs = expandSweep(config, seed);
+    if (jobs.empty()) {
+      return 1;
+    }
+    size_t workers = config[workersS] ? size_tFromYAML(config, workersS) : 1;
+    workers = std::max(std::min(workers, jobs.size()), (size_t) 1);
+
+    std::cout << "Sweeping " << jobs.size() << " jobs on " << workers
+	      << " workers, seed " << seed << std::endl;
+    SweepRunner run = [&fileDir](const SweepJob& job, unsigned jobSeed) {
+      return runExperiment(job.node, job.name, fileDir, jobSeed);
+    };
+    return runSweep(jobs, fileDir, seed, workers, run) > 0 ? 1 : 0;
+  }
+
+  size_t workers = config[workersS] ? size_tFromYAML(config, workersS) : 1;
+  workers = std::max(std::min(workers, experimentStrings.size()), (size_t) 1);
+
+  std::cout << "Training " << experimentStrings.size() << " experiments on "
+	    << workers << " workers, seed " << seed << std::endl;
+
+  ProcessPool pool(workers);
+  vector<ProcessResult> results = pool.Run(experimentStrings.size(), [&](size_t i) {
+      return runExperiment(nodeFromYAML(config, experimentStrings[i]),
+			   experimentStrings[i], fileDir, seed + i);
+    });
+
+  int failed = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].status != 0) {
+      std::cout << "Error: experiment " << experimentStrings[i]
+		<< " exited with status " << results[i].status << "!\n";
+      failed++;
+    }
     //    Env* env = trainAndGetEnv(expNode, expKey, fileDir);
     // vector<size_t> ind = fromYAML<vector<size_t>>(expNode, "ind");
     //envs.push_back(env);
@@ -293,5 +424,5 @@ int main() {
   // domain.InitialiseEpoch();
   // domain.ResetEpochEvals();
   // domain.simulateWithAlignment(false, envs);
-  return 0 ;
+  return failed > 0 ? 1 : 0 ;
 }
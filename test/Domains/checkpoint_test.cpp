@@ -0,0 +1,160 @@
+/*******************************************************************************
+checkpoint_test.cpp
+
+Unit tests for MultiRover binary checkpointing.
+
+Author: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Domains/MultiRover.h"
+#include "Domains/G.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class CheckpointTest : public::testing::Test {
+protected:
+  std::vector<double> world = {0.0, 20.0, 0.0, 20.0};
+  std::string fileName = "checkpoint_test_file";
+
+  virtual void TearDown() { std::remove(fileName.c_str()); }
+
+  void trainOnce(MultiRover* domain, bool init, Objective* o) {
+    domain->EvolvePolicies(init);
+    domain->InitialiseEpoch();
+    domain->ResetEpochEvals();
+    domain->SimulateEpoch(true, o);
+  }
+};
+
+TEST_F(CheckpointTest, testRoundTripRestoresPopulationAndWorld) {
+  G g(1, 4, 1);
+  MultiRover original(world, 5, 3, 2, Fitness::G, 2, 1, AgentType::R);
+  original.setVerbose(false);
+  trainOnce(&original, true, &g);
+
+  original.WriteCheckpoint(fileName, 7);
+  original.FlushCheckpoints();
+
+  MultiRover restored(world, 5, 3, 2, Fitness::G, 2, 1, AgentType::R);
+  restored.setVerbose(false);
+  size_t epoch = 0;
+  ASSERT_TRUE(restored.ReadCheckpoint(fileName, epoch));
+  EXPECT_EQ(7, epoch);
+
+  std::vector<Target> pOrig = original.getPOIs();
+  std::vector<Target> pRest = restored.getPOIs();
+  ASSERT_EQ(pOrig.size(), pRest.size());
+  for (size_t i = 0; i < pOrig.size(); i++) {
+    EXPECT_DOUBLE_EQ(pOrig[i].GetValue(), pRest[i].GetValue());
+    EXPECT_TRUE(pOrig[i].equals(pRest[i]));
+  }
+
+  std::vector<Agent*> aOrig = original.getAgents();
+  std::vector<Agent*> aRest = restored.getAgents();
+  for (size_t i = 0; i < aOrig.size(); i++) {
+    std::vector<double> eOrig = aOrig[i]->GetEpochEvals();
+    std::vector<double> eRest = aRest[i]->GetEpochEvals();
+    ASSERT_EQ(eOrig.size(), eRest.size());
+    for (size_t j = 0; j < eOrig.size(); j++) {
+      EXPECT_DOUBLE_EQ(eOrig[j], eRest[j]);
+    }
+
+    for (size_t j = 0; j < 6; j++) {
+      NeuralNet* nOrig = aOrig[i]->GetNEPopulation()->GetNNIndex(j);
+      NeuralNet* nRest = aRest[i]->GetNEPopulation()->GetNNIndex(j);
+      EXPECT_TRUE(nOrig->GetWeightsA() == nRest->GetWeightsA());
+      EXPECT_TRUE(nOrig->GetWeightsB() == nRest->GetWeightsB());
+    }
+  }
+}
+
+// A resumed run must continue exactly as the uninterrupted run would have
+TEST_F(CheckpointTest, testResumedTrainingMatchesUninterrupted) {
+  G g(1, 4, 1);
+  MultiRover original(world, 5, 3, 2, Fitness::G, 2, 1, AgentType::R);
+  original.setVerbose(false);
+  trainOnce(&original, true, &g);
+  original.WriteCheckpoint(fileName, 0);
+  original.FlushCheckpoints();
+  trainOnce(&original, false, &g);
+
+  MultiRover restored(world, 5, 3, 2, Fitness::G, 2, 1, AgentType::R);
+  restored.setVerbose(false);
+  size_t epoch;
+  ASSERT_TRUE(restored.ReadCheckpoint(fileName, epoch));
+  trainOnce(&restored, false, &g);
+
+  std::vector<Agent*> aOrig = original.getAgents();
+  std::vector<Agent*> aRest = restored.getAgents();
+  for (size_t i = 0; i < aOrig.size(); i++) {
+    std::vector<double> eOrig = aOrig[i]->GetEpochEvals();
+    std::vector<double> eRest = aRest[i]->GetEpochEvals();
+    for (size_t j = 0; j < eOrig.size(); j++) {
+      EXPECT_DOUBLE_EQ(eOrig[j], eRest[j]);
+    }
+  }
+}
+
+TEST_F(CheckpointTest, testMismatchedDomainIsRejected) {
+  MultiRover original(world, 5, 3, 2, Fitness::G, 2, 1, AgentType::R);
+  original.setVerbose(false);
+  original.InitialiseEpoch();
+  original.ResetEpochEvals();
+  original.WriteCheckpoint(fileName, 0);
+  original.FlushCheckpoints();
+
+  MultiRover other(world, 5, 4, 2, Fitness::G, 2, 1, AgentType::R);
+  size_t epoch;
+  EXPECT_FALSE(other.ReadCheckpoint(fileName, epoch));
+  EXPECT_FALSE(other.ReadCheckpoint("no_such_checkpoint", epoch));
+}
+
+TEST_F(CheckpointTest, testCorruptLengthIsRejected) {
+  MultiRover original(world, 5, 3, 2, Fitness::G, 2, 1, AgentType::R);
+  original.setVerbose(false);
+  original.InitialiseEpoch();
+  original.ResetEpochEvals();
+  original.WriteCheckpoint(fileName, 0);
+  original.FlushCheckpoints();
+
+  // The world vector's length follows the magic, version, epoch, rover
+  //   count, population size and agent type
+  std::fstream file(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(8 + sizeof(unsigned) + 3*sizeof(unsigned long long) + sizeof(int));
+  unsigned long long huge = 1ULL << 61;
+  file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+  file.close();
+
+  MultiRover restored(world, 5, 3, 2, Fitness::G, 2, 1, AgentType::R);
+  size_t epoch;
+  EXPECT_FALSE(restored.ReadCheckpoint(fileName, epoch));
+
+  std::stringstream stream;
+  easyio::write_binary(stream, huge);
+  std::vector<double> v;
+  EXPECT_FALSE(easyio::read_binary(stream, v));
+  EXPECT_TRUE(v.empty());
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+map_elites_rover_test.cpp
+
+Unit tests for batched MAP-Elites in the rover domain.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Domains/MAPElitesRover.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+class MAPElitesRoverTest : public::testing::Test {
+protected:
+  std::vector<double> world = {0.0, 30.0, 0.0, 30.0};
+  MatrixXd bins;
+  std::vector<std::string> files = {"mer_test_bp", "mer_test_perf", "mer_test_vis"};
+
+  virtual void SetUp() {
+    bins.setZero(4, 5);
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 5; j++) {
+        bins(i, j) = 0.25 * j;
+      }
+    }
+  }
+
+  virtual void TearDown() {
+    for (size_t i = 0; i < files.size(); i++) {
+      std::remove((files[i] + "0").c_str());
+      std::remove((files[i] + "1").c_str());
+    }
+  }
+
+  // Runs a seeded batched map and writes it out with the given suffix
+  void runMap(size_t threads, bool deterministic, bool evolve, std::string suffix) {
+    easymath::seed_generator(17);
+    MAPElitesRover rover(world, 5, 20, bins);
+    rover.SetThreads(threads, deterministic);
+    rover.InitialiseMapBatched(40, 16);
+    if (evolve) {
+      rover.EvolveMapBatched(60, 16);
+    }
+    std::string a = files[0] + suffix, b = files[1] + suffix, c = files[2] + suffix;
+    rover.WriteToBinary(&a[0], &b[0], &c[0]);
+  }
+
+  std::string readFile(std::string name) {
+    std::ifstream in(name.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+  }
+
+
+  void expectSameFiles() {
+    for (size_t i = 0; i < files.size(); i++) {
+      std::string a = readFile(files[i] + "0");
+      EXPECT_FALSE(a.empty());
+      EXPECT_TRUE(a == readFile(files[i] + "1"));
+    }
+  }
+};
+
+TEST_F(MAPElitesRoverTest, testDeterministicMapIndependentOfThreads) {
+  runMap(1, true, true, "0");
+  runMap(4, true, true, "1");
+  expectSameFiles();
+}
+
+TEST_F(MAPElitesRoverTest, testConcurrentInsertIndependentOfOrder) {
+  runMap(1, true, false, "0");
+  runMap(4, false, false, "1");
+  expectSameFiles();
+}
+
+TEST_F(MAPElitesRoverTest, testCVTMapWithActionBehaviours) {
+  easymath::seed_generator(3);
+  MAPElitesRover rover(world, 5, 20, 50, 8);
+  rover.InitialiseMap(30);
+  rover.EvolveMap(30);
+  EXPECT_GT(rover.PercentageFilled(), 0.0);
+  EXPECT_LE(rover.PercentageFilled(), 1.0);
+}
+
+TEST_F(MAPElitesRoverTest, testSingleWorldBatchMatchesSerial) {
+  easymath::seed_generator(5);
+  MAPElitesRover rover(world, 5, 20, 50, 8);
+  rover.SetEvaluationWorlds(1);
+  for (int k = 0; k < 10; k++) {
+    NeuralNet nn(4, 2, 8);
+    VectorXd serial, batch;
+    serial.setZero(8);
+    batch.setZero(8);
+    double variance = -1.0;
+    double evalSerial = rover.SimulateController(&nn, serial);
+    double evalBatch = rover.SimulateControllerBatch(&nn, batch, variance);
+    EXPECT_NEAR(evalSerial, evalBatch, 1e-9);
+    EXPECT_EQ(0.0, variance);
+    EXPECT_TRUE(serial.isApprox(batch, 1e-9) || serial == batch);
+  }
+}
+
+TEST_F(MAPElitesRoverTest, testMultiWorldEvaluation) {
+  easymath::seed_generator(7);
+  MAPElitesRover rover(world, 5, 20, bins);
+  rover.SetEvaluationWorlds(8);
+  EXPECT_EQ(8, rover.GetNumEvaluationWorlds());
+
+  NeuralNet nn(4, 2, 8);
+  VectorXd bVec;
+  bVec.setZero(4);
+  double variance;
+  double mean = rover.SimulateControllerBatch(&nn, bVec, variance);
+  EXPECT_GE(mean, 0.0);
+  EXPECT_LE(mean, 1.0);
+  EXPECT_GE(variance, 0.0);
+  for (int i = 0; i < bVec.size(); i++) {
+    EXPECT_GE(bVec(i), 0.0);
+    EXPECT_LE(bVec(i), 1.0);
+  }
+
+  rover.InitialiseMap(20);
+  rover.EvolveMap(20);
+  EXPECT_GT(rover.PercentageFilled(), 0.0);
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************
+objective_test.cpp
+
+Unit tests for batched objective evaluation.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Domains/MultiRover.h"
+#include "Domains/Env.h"
+#include "Domains/G.h"
+#include "Domains/TeamForming.h"
+
+#include <vector>
+
+class ObjectiveTest : public::testing::Test {
+protected:
+  // Batched rewards must match applying each step to a fresh history
+  void expectBatchMatchesReplay(Objective* obj) {
+    easymath::seed_generator(4);
+    std::vector<double> world = {0, 20, 0, 20};
+    MultiRover domain(world, 1, 1, 6, "", 5);
+    domain.InitialiseEpoch();
+    Env env(domain.getWorld(), domain.getAgents(), domain.getPOIs(), domain.getNPop());
+    env.init(domain.getInitialStates());
+
+    std::vector< std::vector<State> > steps = env.randomSteps(20);
+    ASSERT_EQ(steps.size(), 20);
+    std::vector<double> batched = obj->rewardAfterSteps(&env, steps);
+    ASSERT_EQ(batched.size(), 20);
+    EXPECT_EQ(env.getHistoryStates().size(), 1);
+
+    for (size_t k = 0; k < steps.size(); k++) {
+      env.reset();
+      env.applyStep(steps[k]);
+      EXPECT_DOUBLE_EQ(obj->reward(&env), batched[k]);
+    }
+  }
+};
+
+TEST_F(ObjectiveTest, testGRewardAfterSteps) {
+  G g(1, 10, 1);
+  expectBatchMatchesReplay(&g);
+}
+
+TEST_F(ObjectiveTest, testTeamFormingRewardAfterSteps) {
+  TeamForming t(2, 10, 1);
+  expectBatchMatchesReplay(&t);
+}
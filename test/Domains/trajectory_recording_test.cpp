@@ -0,0 +1,105 @@
+/*******************************************************************************
+trajectory_recording_test.cpp
+
+Unit tests for recording MultiRover trajectories.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Domains/MultiRover.h"
+#include "Domains/G.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class TrajectoryRecordingTest : public::testing::Test {
+protected:
+  std::vector<double> world = {0.0, 20.0, 0.0, 20.0};
+  std::string trajName = "trajectory_recording_test_file";
+  std::string poiName = "trajectory_recording_test_pois";
+
+  virtual void TearDown() {
+    std::remove(trajName.c_str());
+    std::remove(poiName.c_str());
+  }
+};
+
+TEST_F(TrajectoryRecordingTest, testEveryStepRecorded) {
+  G g(1, 4, 1);
+  size_t nSteps = 5, nPop = 3, nRovs = 2;
+  {
+    MultiRover domain(world, nSteps, nPop, 2, Fitness::G, nRovs, 1, AgentType::R);
+    domain.setVerbose(false);
+    domain.RecordTrajectories(trajName, poiName);
+    domain.EvolvePolicies(true);
+    for (size_t e = 0; e < 2; e++) {
+      domain.InitialiseEpoch();
+      domain.ResetEpochEvals();
+      domain.SimulateEpoch(true, &g);
+    }
+  }
+
+  std::vector<TrajectoryRecord> records;
+  ASSERT_TRUE(TrajectoryRecorder::Read(trajName, records));
+  ASSERT_EQ(2*(2*nPop)*nSteps*nRovs, records.size());
+  size_t i = 0;
+  for (unsigned int e = 0; e < 2; e++) {
+    for (unsigned int team = 0; team < 2*nPop; team++) {
+      for (unsigned int t = 0; t < nSteps; t++) {
+	for (unsigned int a = 0; a < nRovs; a++, i++) {
+	  EXPECT_EQ(e, records[i].epoch);
+	  EXPECT_EQ(team, records[i].team);
+	  EXPECT_EQ(t, records[i].step);
+	  EXPECT_EQ(a, records[i].agent);
+	}
+      }
+    }
+  }
+}
+
+TEST_F(TrajectoryRecordingTest, testArchiveByEpochAndTeam) {
+  G g(1, 4, 1);
+  size_t nSteps = 5, nPop = 3, nRovs = 2;
+  {
+    MultiRover domain(world, nSteps, nPop, 2, Fitness::G, nRovs, 1, AgentType::R);
+    domain.setVerbose(false);
+    domain.ArchiveTrajectories(trajName, poiName);
+    domain.EvolvePolicies(true);
+    for (size_t e = 0; e < 2; e++) {
+      domain.InitialiseEpoch();
+      domain.ResetEpochEvals();
+      domain.SimulateEpoch(true, &g);
+    }
+  }
+
+  TrajectoryArchiveReader reader;
+  ASSERT_TRUE(reader.Open(trajName));
+  EXPECT_EQ(2*(2*nPop), reader.NumTrajectories());
+  std::vector<TrajectoryRecord> records;
+  ASSERT_TRUE(reader.ReadTrajectory(1, 4, records));
+  ASSERT_EQ(nSteps*nRovs, records.size());
+  EXPECT_EQ(1, records.back().epoch);
+  EXPECT_EQ(4, records.back().team);
+  EXPECT_EQ(nSteps - 1, records.back().step);
+  EXPECT_EQ(nRovs - 1, records.back().agent);
+}
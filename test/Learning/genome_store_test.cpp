@@ -0,0 +1,120 @@
+/*******************************************************************************
+genome_store_test.cpp
+
+Unit tests for seed-chain genome storage.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Learning/GenomeStore.h"
+#include "Learning/NeuroEvo.h"
+
+class GenomeStoreTest : public::testing::Test {};
+
+TEST_F(GenomeStoreTest, testReplayMatchesDirectMutation) {
+  NeuralNet root(4, 2, 6);
+  GenomeStore store(4, 2, 6, 2, 100);
+  size_t r = store.AddRoot(root.GetWeightsA(), root.GetWeightsB());
+  size_t c1 = store.AddChild(r, 11);
+  size_t c2 = store.AddChild(c1, 12);
+  size_t c3 = store.AddChild(c2, 13);
+
+  NeuralNet direct(4, 2, 6);
+  direct.SetWeights(root.GetWeightsA(), root.GetWeightsB());
+  direct.MutateWeights(11);
+  direct.MutateWeights(12);
+  direct.MutateWeights(13);
+
+  std::shared_ptr<NeuralNet> replayed = store.Materialise(c3);
+  EXPECT_TRUE(replayed->GetWeightsA().isApprox(direct.GetWeightsA()));
+  EXPECT_TRUE(replayed->GetWeightsB().isApprox(direct.GetWeightsB()));
+  EXPECT_EQ(store.GetDepth(c3), 3);
+}
+
+TEST_F(GenomeStoreTest, testDepthLimitCreatesRoot) {
+  NeuralNet root(3, 2, 4);
+  GenomeStore store(3, 2, 4, 1, 2);
+  size_t id = store.AddRoot(root.GetWeightsA(), root.GetWeightsB());
+  for (unsigned s = 0; s < 5; s++) {
+    size_t child = store.AddChild(id, s);
+    store.Release(id);
+    id = child;
+    EXPECT_LE(store.GetDepth(id), 2);
+  }
+  // Only the live chain remains: a root and two children
+  EXPECT_EQ(store.NumGenomes(), 3);
+}
+
+TEST_F(GenomeStoreTest, testReleaseFreesChains) {
+  NeuralNet root(3, 2, 4);
+  GenomeStore store(3, 2, 4, 4, 10);
+  size_t r = store.AddRoot(root.GetWeightsA(), root.GetWeightsB());
+  size_t c = store.AddChild(r, 1);
+  store.Release(r);
+  EXPECT_EQ(store.NumGenomes(), 2); // child still references the root
+  store.Materialise(c);
+  store.Release(c);
+  EXPECT_EQ(store.NumGenomes(), 0);
+  EXPECT_EQ(store.NumRoots(), 0);
+  EXPECT_EQ(store.NumCached(), 0);
+}
+
+TEST_F(GenomeStoreTest, testCompressedPopulationEvolves) {
+  NeuroEvo ne(4, 2, 5, 6);
+  ne.CompressPopulation(3, 4);
+  for (size_t epoch = 0; epoch < 10; epoch++) {
+    ne.MutatePopulation();
+    ASSERT_EQ(ne.GetCurrentPopSize(), 12);
+    std::vector<double> evals;
+    for (size_t i = 0; i < 12; i++) {
+      VectorXd in = VectorXd::Ones(4);
+      evals.push_back(ne.GetNNIndex(i)->EvaluateNN(in).sum());
+    }
+    ne.EvolvePopulation(evals);
+    ASSERT_EQ(ne.GetCurrentPopSize(), 6);
+  }
+  EXPECT_LE(ne.GetGenomeStore()->NumCached(), 3);
+  EXPECT_LE(ne.GetGenomeStore()->NumGenomes(), 6 * 5);
+}
+
+TEST_F(GenomeStoreTest, testSharedNetsOutliveEviction) {
+  // The cache holds fewer nets than the team fetched at once
+  NeuroEvo ne(4, 2, 5, 6);
+  ne.CompressPopulation(2, 4);
+  ne.MutatePopulation();
+  size_t n = 12;
+  VectorXd in = VectorXd::LinSpaced(4, -1.0, 1.0);
+
+  std::vector<VectorXd> expected;
+  for (size_t i = 0; i < n; i++) {
+    expected.push_back(ne.GetNNIndex(i)->EvaluateNN(in));
+  }
+
+  std::vector< std::shared_ptr<NeuralNet> > team;
+  for (size_t i = 0; i < n; i++) {
+    team.push_back(ne.GetSharedNN(i));
+  }
+  EXPECT_LE(ne.GetGenomeStore()->NumCached(), 2);
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_TRUE(team[i]->EvaluateNN(in).isApprox(expected[i]));
+  }
+}
@@ -0,0 +1,329 @@
+/*******************************************************************************
+map_elites_test.cpp
+
+Unit tests for the sparse MAP-Elites archive.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Learning/MAPElites.h"
+#include "Learning/MAPElitesArchive.h"
+#include "Learning/CVTMAPElites.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class MAPElitesTest : public::testing::Test {
+protected:
+  MatrixXd bins;
+
+  virtual void SetUp() {
+    bins.setZero(4, 5);
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 5; j++) {
+        bins(i, j) = 0.25 * j;
+      }
+    }
+  }
+};
+
+TEST_F(MAPElitesTest, testOnlyFilledCellsAreStored) {
+  MAPElites map(bins, 4, 2, 8);
+  EXPECT_EQ(map.GetNumCells(), 625);
+  EXPECT_EQ(map.GetNumFilled(), 0);
+
+  VectorXd b(4);
+  b << 0.0, 0.25, 0.5, 1.0;
+  EXPECT_FALSE(map.IsVisited(b));
+  EXPECT_TRUE(map.GetNeuralNet(b) == 0);
+
+  NeuralNet nn(4, 2, 8);
+  map.UpdateMap(&nn, b, 0.3);
+  EXPECT_TRUE(map.IsVisited(b));
+  EXPECT_EQ(map.GetNumFilled(), 1);
+  EXPECT_EQ(map.GetRandomFilledIndex(), map.GetIndex(b));
+  EXPECT_DOUBLE_EQ(map.GetPerformance(b), 0.3);
+
+  // Worse controllers do not replace the elite, better ones do
+  NeuralNet worse(4, 2, 8);
+  map.UpdateMap(&worse, b, 0.1);
+  EXPECT_TRUE(map.GetNeuralNet(b)->GetWeightsA().isApprox(nn.GetWeightsA()));
+  NeuralNet better(4, 2, 8);
+  map.UpdateMap(&better, b, 0.9);
+  EXPECT_TRUE(map.GetNeuralNet(b)->GetWeightsA().isApprox(better.GetWeightsA()));
+  EXPECT_EQ(map.GetNumFilled(), 1);
+}
+
+TEST_F(MAPElitesTest, testRandomFilledIndexIsFilled) {
+  MAPElites map(bins, 4, 2, 8);
+  NeuralNet nn(4, 2, 8);
+  for (int i = 0; i < 20; i++) {
+    VectorXd b(4);
+    for (int j = 0; j < 4; j++) b(j) = easymath::rand_interval(0.0, 1.0);
+    map.UpdateMap(&nn, b, 0.5);
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(map.IsVisited(map.GetRandomFilledIndex()));
+  }
+}
+
+TEST_F(MAPElitesTest, testNearestFilledCellQueries) {
+  easymath::seed_generator(11);
+  MAPElites map(bins, 4, 2, 8);
+  EXPECT_TRUE(map.GetNearestNeuralNet(VectorXd::Zero(4)) == 0);
+
+  NeuralNet nn(4, 2, 8);
+  for (int i = 0; i < 60; i++) {
+    VectorXd b = (VectorXd::Random(4).array() + 1.0) / 2.0;
+    map.UpdateMap(&nn, b, 0.5);
+  }
+
+  for (int t = 0; t < 20; t++) {
+    VectorXd q = VectorXd::Random(4) * 1.5; // partly outside the map limits
+    double best = DBL_MAX;
+    std::vector<double> dists;
+    for (size_t k = 0; k < map.GetNumFilled(); k++) {
+      double d = (map.GetBehaviour(map.GetFilledIndex(k)) - q).norm();
+      best = std::min(best, d);
+      dists.push_back(d);
+    }
+    size_t n = map.GetNearestFilledIndex(q);
+    EXPECT_TRUE(map.IsVisited(n));
+    EXPECT_DOUBLE_EQ(best, (map.GetBehaviour(n) - q).norm());
+    EXPECT_TRUE(map.GetNearestNeuralNet(q) == map.GetNeuralNet(n));
+
+    std::vector<size_t> knn = map.GetNearestFilledIndices(q, 5);
+    ASSERT_EQ(knn.size(), 5);
+    std::sort(dists.begin(), dists.end());
+    for (size_t k = 0; k < knn.size(); k++) {
+      EXPECT_DOUBLE_EQ(dists[k], (map.GetBehaviour(knn[k]) - q).norm());
+    }
+
+    size_t inside = std::count_if(dists.begin(), dists.end(),
+                                  [](double d) { return d <= 0.6; });
+    std::vector<size_t> near = map.GetFilledIndicesInRadius(q, 0.6);
+    EXPECT_EQ(inside, near.size());
+  }
+
+  map.ClearMap();
+  EXPECT_EQ(map.GetNearestFilledIndices(VectorXd::Zero(4), 3).size(), 0);
+}
+
+TEST_F(MAPElitesTest, testBinaryRoundTrip) {
+  std::string bp = "map_elites_test_bp", perf = "map_elites_test_perf", vis = "map_elites_test_vis";
+  MAPElites map(bins, 4, 2, 8);
+  for (int i = 0; i < 10; i++) {
+    NeuralNet nn(4, 2, 8);
+    VectorXd b(4);
+    for (int j = 0; j < 4; j++) b(j) = easymath::rand_interval(0.0, 1.0);
+    map.UpdateMap(&nn, b, 0.1 * i);
+  }
+  map.WriteBPMapBinary(&bp[0]);
+  map.WritePerformanceBinary(&perf[0]);
+  map.WriteVisitedBinary(&vis[0]);
+
+  MAPElites loaded(bins, 4, 2, 8);
+  loaded.ReadBPMapBinary(&bp[0]);
+  loaded.ReadPerformanceBinary(&perf[0]);
+  loaded.ReadVisitedBinary(&vis[0]);
+
+  ASSERT_EQ(loaded.GetNumFilled(), map.GetNumFilled());
+  for (size_t k = 0; k < map.GetNumFilled(); k++) {
+    size_t i = map.GetFilledIndex(k);
+    ASSERT_TRUE(loaded.IsVisited(i));
+    EXPECT_DOUBLE_EQ(loaded.GetPerformance(i), map.GetPerformance(i));
+    EXPECT_TRUE(loaded.GetNeuralNet(i)->GetWeightsA().isApprox(map.GetNeuralNet(i)->GetWeightsA()));
+    EXPECT_TRUE(loaded.GetNeuralNet(i)->GetWeightsB().isApprox(map.GetNeuralNet(i)->GetWeightsB()));
+  }
+
+  std::remove(bp.c_str());
+  std::remove(perf.c_str());
+  std::remove(vis.c_str());
+}
+
+TEST_F(MAPElitesTest, testUntaggedBPMapIsRejected) {
+  // A map in the original layout: raw weights for every cell, no tag
+  std::string bp = "map_elites_test_legacy_bp";
+  MAPElites map(bins, 4, 2, 8);
+  std::ofstream out(bp.c_str(), std::ios::binary);
+  size_t nWeights = 4 * 8 + 9 * 2;
+  std::vector<double> weights(map.GetNumCells() * nWeights, 0.5);
+  out.write(reinterpret_cast<const char*>(&weights[0]), weights.size() * sizeof(double));
+  out.close();
+
+  map.ReadBPMapBinary(&bp[0]);
+  EXPECT_EQ(map.GetNumFilled(), 0);
+  std::remove(bp.c_str());
+}
+
+TEST_F(MAPElitesTest, testArchiveRoundTrip) {
+  std::string name = "map_elites_test_archive";
+  MAPElites map(bins, 4, 2, 8);
+  for (int i = 0; i < 30; i++) {
+    NeuralNet nn(4, 2, 8);
+    VectorXd b(4);
+    for (int j = 0; j < 4; j++) b(j) = easymath::rand_interval(0.0, 1.0);
+    map.UpdateMap(&nn, b, 0.01 * i);
+  }
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+
+  MAPElites loaded(bins, 4, 2, 8);
+  ASSERT_TRUE(loaded.ReadArchive(name.c_str()));
+  ASSERT_EQ(loaded.GetNumFilled(), map.GetNumFilled());
+
+  MAPElitesArchive view;
+  ASSERT_TRUE(view.Open(name.c_str()));
+  EXPECT_EQ(view.GetNumCells(), 625);
+  EXPECT_EQ(view.GetNumFilled(), map.GetNumFilled());
+  EXPECT_TRUE(view.GetBinLimits() == bins);
+
+  for (size_t i = 0; i < map.GetNumCells(); i++) {
+    ASSERT_EQ(view.IsVisited(i), map.IsVisited(i));
+    ASSERT_EQ(loaded.IsVisited(i), map.IsVisited(i));
+    if (!map.IsVisited(i)) continue;
+    EXPECT_DOUBLE_EQ(view.GetPerformance(i), map.GetPerformance(i));
+    EXPECT_DOUBLE_EQ(loaded.GetPerformance(i), map.GetPerformance(i));
+    EXPECT_TRUE(view.GetWeightsA(i) == map.GetNeuralNet(i)->GetWeightsA());
+    EXPECT_TRUE(view.GetWeightsB(i) == map.GetNeuralNet(i)->GetWeightsB());
+    EXPECT_TRUE(loaded.GetNeuralNet(i)->GetWeightsB() == map.GetNeuralNet(i)->GetWeightsB());
+    EXPECT_EQ(view.GetIndex(view.GetBehaviour(i)), i);
+  }
+
+  // Cells are listed in increasing order
+  for (size_t k = 1; k < view.GetNumFilled(); k++) {
+    EXPECT_LT(view.GetFilledIndex(k-1), view.GetFilledIndex(k));
+  }
+
+  NeuralNet copy(4, 2, 8);
+  EXPECT_TRUE(view.GetNeuralNet(view.GetFilledIndex(0), &copy));
+  view.Close();
+  std::remove(name.c_str());
+}
+
+TEST_F(MAPElitesTest, testArchiveRejectsMismatch) {
+  std::string name = "map_elites_test_archive_bad";
+  MAPElites map(bins, 4, 2, 8);
+  NeuralNet nn(4, 2, 8);
+  VectorXd b = VectorXd::Zero(4);
+  map.UpdateMap(&nn, b, 1.0);
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+
+  MAPElites other(bins, 4, 2, 6);
+  EXPECT_FALSE(other.ReadArchive(name.c_str()));
+
+  // Truncated files are rejected
+  std::ofstream out(name.c_str(), std::ios::binary | std::ios::trunc);
+  out << "MAPEARCH";
+  out.close();
+  MAPElitesArchive view;
+  EXPECT_FALSE(view.Open(name.c_str()));
+  EXPECT_FALSE(view.IsOpen());
+  std::remove(name.c_str());
+}
+
+// Overwrite one header field of an archive on disk
+template <typename T>
+static void PatchArchive(const std::string & name, size_t offset, T value) {
+  std::fstream f(name.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  f.seekp(offset);
+  f.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+TEST_F(MAPElitesTest, testArchiveRejectsBadHeader) {
+  std::string name = "map_elites_test_archive_header";
+  MAPElites map(bins, 4, 2, 8);
+  NeuralNet nn(4, 2, 8);
+  VectorXd b = VectorXd::Zero(4);
+  map.UpdateMap(&nn, b, 1.0);
+  MAPElitesArchive view;
+
+  // Version 1 archives have no kind field
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+  PatchArchive(name, offsetof(MAPElitesArchiveHeader, version), 1u);
+  EXPECT_FALSE(view.Open(name.c_str()));
+
+  // Counts whose byte sizes wrap around must not pass the size checks
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+  PatchArchive(name, offsetof(MAPElitesArchiveHeader, numIn), 1ULL << 62);
+  EXPECT_FALSE(view.Open(name.c_str()));
+
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+  PatchArchive(name, offsetof(MAPElitesArchiveHeader, numFilled), (~0ULL)/8 + 2);
+  EXPECT_FALSE(view.Open(name.c_str()));
+
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+  PatchArchive(name, offsetof(MAPElitesArchiveHeader, cellsOffset), ~0ULL - 7);
+  EXPECT_FALSE(view.Open(name.c_str()));
+
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+  EXPECT_TRUE(view.Open(name.c_str()));
+  view.Close();
+  std::remove(name.c_str());
+}
+
+TEST_F(MAPElitesTest, testCVTIndexIsNearestCentroid) {
+  MatrixXd centroids = CVTMAPElites::ComputeCentroids(8, 64, 10, 5);
+  ASSERT_EQ(centroids.rows(), 8);
+  ASSERT_EQ(centroids.cols(), 64);
+  CVTMAPElites map(centroids, 4, 2, 8);
+  EXPECT_EQ(map.GetNumCells(), 64);
+  EXPECT_EQ(map.GetBDim(), 8);
+
+  for (int t = 0; t < 50; t++) {
+    VectorXd b(8);
+    for (int j = 0; j < 8; j++) b(j) = easymath::rand_interval(0.0, 1.0);
+    size_t best = 0;
+    for (int n = 1; n < 64; n++) {
+      if ((centroids.col(n) - b).squaredNorm() < (centroids.col(best) - b).squaredNorm()) best = n;
+    }
+    EXPECT_EQ(map.GetIndex(b), best);
+  }
+  EXPECT_TRUE(map.GetBehaviour(3) == centroids.col(3));
+}
+
+TEST_F(MAPElitesTest, testCVTArchiveRoundTrip) {
+  std::string name = "map_elites_test_cvt_archive";
+  CVTMAPElites map(CVTMAPElites::ComputeCentroids(8, 32, 5, 3), 4, 2, 8);
+  for (int i = 0; i < 20; i++) {
+    NeuralNet nn(4, 2, 8);
+    VectorXd b(8);
+    for (int j = 0; j < 8; j++) b(j) = easymath::rand_interval(0.0, 1.0);
+    map.UpdateMap(&nn, b, 0.05 * i);
+  }
+  ASSERT_TRUE(map.WriteArchive(name.c_str()));
+
+  MAPElitesArchive view;
+  ASSERT_TRUE(view.Open(name.c_str()));
+  EXPECT_EQ(view.GetHeader().kind, (unsigned int)CVT);
+  VectorXd b = map.GetBehaviour(map.GetFilledIndex(0));
+  EXPECT_EQ(view.GetIndex(b), map.GetFilledIndex(0));
+  view.Close();
+
+  // A grid map cannot load a CVT archive
+  MAPElites grid(bins, 4, 2, 8);
+  EXPECT_FALSE(grid.ReadArchive(name.c_str()));
+  std::remove(name.c_str());
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+belief_tracker_test.cpp
+
+Unit tests for batched belief tracking.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "POMDPs/BeliefTracker.h"
+
+#include <string>
+#include <vector>
+
+class BeliefTrackerTest : public TempFileTest {
+protected:
+  virtual void SetUp() {
+    model = writeFile(
+      "discount: 0.95\nvalues: reward\nstates: a b c\nactions: stay go\nobservations: lo hi\n"
+      "start: 0.2 0.3 0.5\n"
+      "T: stay identity\n"
+      "T: go\n0.7 0.2 0.1\n0 0.6 0.4\n0.3 0 0.7\n"
+      "O: stay\n0.9 0.1\n0.5 0.5\n0 1\n"
+      "O: go\n0.9 0.1\n0.4 0.6\n0.2 0.8\n");
+    policy = writeFile("0,10,0,0\n1,0,10,0\n0,0,0,10\n1,4,4,4\n");
+  }
+
+  std::string model;
+  std::string policy;
+};
+
+TEST_F(BeliefTrackerTest, testBatchMatchesSingleUpdates) {
+  POMDPEnvironment env(&model[0]);
+  POMDPPolicy pol(&policy[0]);
+  ASSERT_TRUE(env.IsValid());
+  ASSERT_TRUE(pol.IsValid());
+
+  size_t n = 7;
+  BeliefTracker tracker(&env, &pol, n);
+  std::vector<VectorXd> single(n, env.GetInitialBelief());
+  EXPECT_TRUE(tracker.GetBelief(3).isApprox(env.GetInitialBelief()));
+
+  for (size_t step = 0; step < 5; step++) {
+    std::vector<size_t> actions, observations;
+    for (size_t i = 0; i < n; i++) {
+      actions.push_back((i + step) % 2);
+      observations.push_back((i*step) % 2);
+    }
+    EXPECT_EQ(0, tracker.Update(actions, observations));
+
+    std::vector<size_t> best = tracker.GetBestActions();
+    for (size_t i = 0; i < n; i++) {
+      single[i] = env.UpdateBelief(single[i], actions[i], observations[i]);
+      EXPECT_TRUE(tracker.GetBelief(i).isApprox(single[i]));
+      EXPECT_EQ(pol.GetBestAction(single[i]), best[i]);
+    }
+  }
+
+  tracker.Reset();
+  EXPECT_TRUE(tracker.GetBeliefs().col(n - 1).isApprox(env.GetInitialBelief()));
+}
+
+TEST_F(BeliefTrackerTest, testImpossibleObservation) {
+  POMDPEnvironment env(&model[0]);
+  POMDPPolicy pol(&policy[0]);
+  BeliefTracker tracker(&env, &pol, 2);
+
+  VectorXd certain(3);
+  certain << 0, 0, 1;
+  tracker.SetBelief(0, certain);
+  std::vector<size_t> actions = {0, 0};
+  std::vector<size_t> observations = {0, 0};
+  EXPECT_EQ(1, tracker.Update(actions, observations));
+  EXPECT_TRUE(tracker.GetBelief(0).isApprox(certain));
+  EXPECT_TRUE(tracker.GetBelief(1).isApprox(env.UpdateBelief(env.GetInitialBelief(), 0, 0)));
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+pbvi_solver_test.cpp
+
+Unit tests for the point-based value iteration solver.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "POMDPs/PBVISolver.h"
+#include "POMDPs/POMDPPolicy.h"
+
+#include <string>
+
+class PBVISolverTest : public TempFileTest {
+protected:
+  // Two hidden states, listening is noisy and costs a little, guessing
+  // resets the state
+  std::string tiger() {
+    return writeFile(
+      "discount: 0.95\nvalues: reward\nstates: left right\nactions: listen open-left open-right\n"
+      "observations: hear-left hear-right\n"
+      "T: listen identity\nT: open-left uniform\nT: open-right uniform\n"
+      "O: listen\n0.85 0.15\n0.15 0.85\nO: open-left uniform\nO: open-right uniform\n"
+      "R: listen : * : * : * -1\n"
+      "R: open-left : left : * : * -100\nR: open-left : right : * : * 10\n"
+      "R: open-right : left : * : * 10\nR: open-right : right : * : * -100\n");
+  }
+};
+
+TEST_F(PBVISolverTest, testSingleStateValue) {
+  std::string model = writeFile(
+    "discount: 0.5\nvalues: reward\nstates: 1\nactions: a b\nobservations: 1\n"
+    "T: * identity\nO: * uniform\nR: a : * : * : * 1\nR: b : * : * : * 0.5\n");
+  POMDPEnvironment env(&model[0]);
+  ASSERT_TRUE(env.IsValid());
+  PBVISolver solver(&env);
+  PBVIStats stats = solver.Solve(10, 200, 1e-9);
+  EXPECT_TRUE(stats.converged);
+  EXPECT_EQ(stats.iterations, stats.iterationSeconds.size());
+  ASSERT_EQ(1, solver.GetActionVector().size());
+  EXPECT_EQ(0, solver.GetActionVector()[0]);
+  EXPECT_NEAR(2.0, solver.GetAlphaMatrix()(0, 0), 1e-6);
+}
+
+TEST_F(PBVISolverTest, testTigerPolicy) {
+  std::string model = tiger();
+  POMDPEnvironment env(&model[0]);
+  ASSERT_TRUE(env.IsValid());
+  PBVISolver solver(&env, 2, 3);
+  PBVIStats stats = solver.Solve(100, 1000, 1e-6);
+  EXPECT_TRUE(stats.converged);
+  EXPECT_LE(stats.residual, 1e-6);
+  EXPECT_EQ(stats.numVectors, solver.GetActionVector().size());
+  EXPECT_GT(stats.numBeliefs, 10);
+
+  std::string out = tempName();
+  ASSERT_TRUE(solver.WritePolicy(out.c_str()));
+  POMDPPolicy policy(&out[0]);
+  ASSERT_TRUE(policy.IsValid());
+  EXPECT_TRUE(policy.GetAlphaMatrix().isApprox(solver.GetAlphaMatrix(), 1e-9));
+
+  VectorXd b(2);
+  b << 0.5, 0.5;
+  EXPECT_EQ(0, policy.GetBestAction(b)); // listen when unsure
+  b << 0.01, 0.99;
+  EXPECT_EQ(1, policy.GetBestAction(b)); // open the door away from the tiger
+  b << 0.99, 0.01;
+  EXPECT_EQ(2, policy.GetBestAction(b));
+}
+
+TEST_F(PBVISolverTest, testThreadCountDoesNotChangeResult) {
+  std::string model = tiger();
+  POMDPEnvironment env(&model[0]);
+  PBVISolver serial(&env, 1, 5);
+  PBVISolver parallel(&env, 3, 5);
+  PBVIStats a = serial.Solve(50, 100, 1e-6);
+  PBVIStats b = parallel.Solve(50, 100, 1e-6);
+  EXPECT_EQ(a.iterations, b.iterations);
+  EXPECT_EQ(serial.GetActionVector(), parallel.GetActionVector());
+  EXPECT_TRUE(serial.GetAlphaMatrix() == parallel.GetAlphaMatrix());
+}
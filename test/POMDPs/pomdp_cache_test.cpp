@@ -0,0 +1,190 @@
+/*******************************************************************************
+pomdp_cache_test.cpp
+
+Unit tests for the compiled POMDP cache.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "POMDPs/POMDPCache.h"
+#include "POMDPs/POMDP.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+class POMDPCacheTest : public TempFileTest {
+protected:
+  virtual void SetUp() {
+    base = tempDir();
+    model = removeLater(base + "/model.pomdp");
+    policy = removeLater(base + "/model.policy");
+    removeLater(POMDPCache::CachePath(model.c_str()));
+    writeFile(model,
+      "discount: 0.95\nvalues: reward\nstates: N E\nactions: noAsk ask\n"
+      "observations: poor avg high\n"
+      "start: 0.3 0.7\n"
+      "T: noAsk\n0.99 0.01\n0.01 0.99\nT: ask identity\n"
+      "O: noAsk\n0.85 0.1 0.05\n0.05 0.1 0.85\nO: ask uniform\n"
+      "R: noAsk : N : * : poor -2000\nR: ask : E : E : * 50\n");
+    writeFile(policy, "0,10,0\n1,0,10\n0,6,6\n1,4,4\n");
+  }
+
+  bool load(POMDPEnvironment*& env, POMDPPolicy*& pol) {
+    bool used = false;
+    bool ok = POMDPCache::Load(model.c_str(), policy.c_str(), env, pol, "", &used);
+    EXPECT_TRUE(ok);
+    return used;
+  }
+
+  std::string base;
+  std::string model;
+  std::string policy;
+};
+
+TEST_F(POMDPCacheTest, testCachePath) {
+  EXPECT_EQ("a/rover_3.pomdpb", POMDPCache::CachePath("a/rover_3.pomdp"));
+  EXPECT_EQ("a.b/rover", POMDPCache::CachePath("a.b/rover").substr(0, 9));
+  EXPECT_EQ("a.b/rover.pomdpb", POMDPCache::CachePath("a.b/rover"));
+}
+
+TEST_F(POMDPCacheTest, testRoundTrip) {
+  POMDPEnvironment *parsedEnv, *cachedEnv;
+  POMDPPolicy *parsedPol, *cachedPol;
+  EXPECT_FALSE(load(parsedEnv, parsedPol));
+  EXPECT_TRUE(load(cachedEnv, cachedPol));
+  ASSERT_TRUE(cachedEnv->IsValid());
+  ASSERT_TRUE(cachedPol->IsValid());
+
+  EXPECT_DOUBLE_EQ(0.95, cachedEnv->GetDiscount());
+  EXPECT_EQ("reward", cachedEnv->GetValues());
+  EXPECT_EQ(parsedEnv->GetStates(), cachedEnv->GetStates());
+  EXPECT_EQ(parsedEnv->GetActions(), cachedEnv->GetActions());
+  EXPECT_EQ(parsedEnv->GetObservations(), cachedEnv->GetObservations());
+  EXPECT_TRUE(parsedEnv->GetInitialBelief() == cachedEnv->GetInitialBelief());
+  for (size_t a = 0; a < 2; a++) {
+    EXPECT_TRUE(parsedEnv->GetTransitions()[a] == cachedEnv->GetTransitions()[a]);
+    EXPECT_TRUE(parsedEnv->GetObservationProbabilities()[a] == cachedEnv->GetObservationProbabilities()[a]);
+  }
+  EXPECT_EQ(parsedEnv->GetNumRewards(), cachedEnv->GetNumRewards());
+  EXPECT_DOUBLE_EQ(-2000, cachedEnv->GetReward(0, 0, 1, 0));
+  EXPECT_DOUBLE_EQ(50, cachedEnv->GetReward(1, 1, 1, 2));
+
+  // The cached policy is the pruned one
+  EXPECT_EQ(3, cachedPol->GetNumVectors());
+  EXPECT_TRUE(parsedPol->GetAlphaMatrix() == cachedPol->GetAlphaMatrix());
+  EXPECT_EQ(parsedPol->GetActionVector(), cachedPol->GetActionVector());
+
+  VectorXd b = cachedEnv->GetInitialBelief();
+  EXPECT_TRUE(parsedEnv->UpdateBelief(b, 0, 2).isApprox(cachedEnv->UpdateBelief(b, 0, 2)));
+
+  delete parsedEnv;
+  delete parsedPol;
+  delete cachedEnv;
+  delete cachedPol;
+}
+
+TEST_F(POMDPCacheTest, testRebuiltWhenStale) {
+  POMDPEnvironment* env;
+  POMDPPolicy* pol;
+  EXPECT_FALSE(load(env, pol));
+  delete env;
+  delete pol;
+
+  writeFile(policy, "0,10,0\n1,0,10\n");
+  EXPECT_FALSE(load(env, pol));
+  EXPECT_EQ(2, pol->GetNumVectors());
+  delete env;
+  delete pol;
+  EXPECT_TRUE(load(env, pol));
+  delete env;
+  delete pol;
+
+  // Truncated cache file
+  std::string cache = POMDPCache::CachePath(model.c_str());
+  EXPECT_EQ(0, truncate(cache.c_str(), 100));
+  EXPECT_FALSE(load(env, pol));
+  EXPECT_EQ(2, env->GetActions().size());
+  delete env;
+  delete pol;
+}
+
+TEST_F(POMDPCacheTest, testCorruptArraysRebuilt) {
+  POMDPEnvironment* env;
+  POMDPPolicy* pol;
+  std::string cache = POMDPCache::CachePath(model.c_str());
+
+  // The first transition matrix is 2x2 with 4 entries, stored as the sizes
+  // then the row starts 0, 2, 4
+  unsigned long long sizes[3] = {2, 2, 4};
+  int outer[3] = {0, 2, 4};
+  std::string pattern(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+  pattern.append(reinterpret_cast<const char*>(outer), sizeof(outer));
+
+  for (int corruption = 0; corruption < 2; corruption++) {
+    EXPECT_FALSE(load(env, pol));
+    delete env;
+    delete pol;
+    std::ifstream in(cache.c_str(), std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    std::fstream f(cache.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (corruption == 0) {
+      // A row start past the number of entries
+      size_t at = bytes.find(pattern);
+      ASSERT_NE(std::string::npos, at);
+      int bad = 5;
+      f.seekp(at + sizeof(sizes) + sizeof(int));
+      f.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    } else {
+      // An alpha length that wraps the alpha count around to 2. The policy
+      // section ends the file: 3 vectors, length, 3 actions and 6 alphas.
+      unsigned long long length = 6148914691236517206ULL;
+      f.seekp(bytes.size() - 10*sizeof(double));
+      f.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    }
+    f.close();
+
+    EXPECT_FALSE(load(env, pol));
+    EXPECT_EQ(3, pol->GetNumVectors());
+    EXPECT_EQ(2, env->GetStates().size());
+    delete env;
+    delete pol;
+    std::remove(cache.c_str());
+  }
+}
+
+TEST_F(POMDPCacheTest, testPOMDPUsesCache) {
+  VectorXd b(2);
+  b << 0.5, 0.5;
+  POMDP first(&model[0], &policy[0], b);
+  POMDP second(&model[0], &policy[0], b);
+  std::ifstream cache(POMDPCache::CachePath(model.c_str()).c_str());
+  EXPECT_TRUE(cache.is_open());
+  EXPECT_EQ(first.GetBestAction(), second.GetBestAction());
+  second.UpdateBelief(1, 0);
+  EXPECT_TRUE(second.GetBelief().isApprox(b));
+}
@@ -0,0 +1,165 @@
+/*******************************************************************************
+pomdp_environment_test.cpp
+
+Unit tests for reading .pomdp models.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "POMDPs/POMDPEnvironment.h"
+
+#include <string>
+
+class POMDPEnvironmentTest : public TempFileTest {};
+
+TEST_F(POMDPEnvironmentTest, testMatrixFormat) {
+  std::string f = writeFile(
+    "# comment\n"
+    "discount: 0.95\nvalues: reward\nstates: N E\nactions: noAsk ask\n"
+    "observations: poorReward avgReward highReward\n\n"
+    "T: noAsk\n0.99 0.01\n0.01 0.99\n"
+    "T: ask\n0.9\t0.1\n0.1\t0.9\n"
+    "O: noAsk\n0.85 0.1 0.05\n0.05 0.1 0.85\n"
+    "O: ask\n0.1 0.3 0.6\n0.05 0.1 0.85\n"
+    "R: noAsk : N : * : poorReward -2000\n"
+    "R: ask : E : * : highReward 50 # trailing comment\n");
+  POMDPEnvironment env(&f[0]);
+  ASSERT_TRUE(env.IsValid());
+
+  EXPECT_DOUBLE_EQ(0.95, env.GetDiscount());
+  EXPECT_EQ("reward", env.GetValues());
+  ASSERT_EQ(2, env.GetStates().size());
+  ASSERT_EQ(2, env.GetActions().size());
+  ASSERT_EQ(3, env.GetObservations().size());
+  EXPECT_EQ("avgReward", env.GetObservations()[1]);
+
+  EXPECT_DOUBLE_EQ(0.01, env.GetTransitions(0).coeff(0, 1));
+  EXPECT_DOUBLE_EQ(0.9, env.GetTransitions(1).coeff(1, 1));
+  EXPECT_DOUBLE_EQ(0.3, env.GetObservationProbabilities(1).coeff(0, 1));
+
+  EXPECT_DOUBLE_EQ(-2000, env.GetReward(0, 0, 0, 0));
+  EXPECT_DOUBLE_EQ(-2000, env.GetReward(0, 0, 1, 0));
+  EXPECT_DOUBLE_EQ(50, env.GetReward(1, 1, 0, 2));
+  EXPECT_DOUBLE_EQ(0, env.GetReward(1, 0, 0, 2));
+  EXPECT_EQ(4, env.GetNumRewards());
+  EXPECT_DOUBLE_EQ(50, env.GetRewards()[1][1](1, 2));
+
+  EXPECT_DOUBLE_EQ(0.5, env.GetInitialBelief()(0));
+  EXPECT_DOUBLE_EQ(0.5, env.GetInitialBelief()(1));
+}
+
+TEST_F(POMDPEnvironmentTest, testShorthandsAndOverwrites) {
+  std::string f = writeFile(
+    "discount: 0.9\nvalues: cost\nstates: 3\nactions: stay move\nobservations: 2\n"
+    "start include: 1 2\n"
+    "T: stay identity\n"
+    "T: move uniform\n"
+    "T: move : 2\n0 0 1\n"
+    "T: move : 0 : 1 0.5\nT: move : 0 : 0 0\nT: move : 0 : 2 0.5\n"
+    "O: * uniform\n"
+    "O: stay : 2 : 0 1.0\nO: stay : 2 : 1 0.0\n"
+    "R: * : * : * : * 1\n"
+    "R: move : 0 : 2\n3 4\n"
+    "R: stay : 1\n0 0\n5 5\n0 0\n");
+  POMDPEnvironment env(&f[0]);
+  ASSERT_TRUE(env.IsValid());
+  EXPECT_EQ("2", env.GetStates()[2]);
+
+  MatrixXd tStay = env.GetTransitions()[0];
+  EXPECT_TRUE(tStay.isApprox(MatrixXd::Identity(3, 3)));
+  EXPECT_EQ(3, env.GetTransitions(0).nonZeros());
+
+  MatrixXd tMove = env.GetTransitions()[1];
+  EXPECT_DOUBLE_EQ(0.0, tMove(0, 0));
+  EXPECT_DOUBLE_EQ(0.5, tMove(0, 1));
+  EXPECT_DOUBLE_EQ(1.0/3.0, tMove(1, 0));
+  EXPECT_DOUBLE_EQ(1.0, tMove(2, 2));
+  EXPECT_EQ(6, env.GetTransitions(1).nonZeros());
+
+  EXPECT_DOUBLE_EQ(0.5, env.GetObservationProbabilities(1).coeff(0, 1));
+  EXPECT_DOUBLE_EQ(1.0, env.GetObservationProbabilities(0).coeff(2, 0));
+  EXPECT_DOUBLE_EQ(0.0, env.GetObservationProbabilities(0).coeff(2, 1));
+
+  EXPECT_DOUBLE_EQ(1, env.GetReward(1, 2, 0, 1));
+  EXPECT_DOUBLE_EQ(4, env.GetReward(1, 0, 2, 1));
+  EXPECT_DOUBLE_EQ(5, env.GetReward(0, 1, 1, 0));
+  EXPECT_DOUBLE_EQ(0, env.GetReward(0, 1, 2, 0));
+
+  VectorXd start = env.GetInitialBelief();
+  EXPECT_DOUBLE_EQ(0.0, start(0));
+  EXPECT_DOUBLE_EQ(0.5, start(1));
+  EXPECT_DOUBLE_EQ(0.5, start(2));
+}
+
+TEST_F(POMDPEnvironmentTest, testUpdateBeliefMatchesDense) {
+  std::string f = writeFile(
+    "discount: 0.95\nvalues: reward\nstates: a b c\nactions: go\nobservations: lo hi\n"
+    "start: 0.2 0.3 0.5\n"
+    "T: go\n0.7 0.2 0.1\n0 0.6 0.4\n0.3 0 0.7\n"
+    "O: go\n0.9 0.1\n0.4 0.6\n0.2 0.8\n");
+  POMDPEnvironment env(&f[0]);
+  ASSERT_TRUE(env.IsValid());
+
+  VectorXd b = env.GetInitialBelief();
+  MatrixXd T = env.GetTransitions()[0];
+  MatrixXd Z = env.GetObservationProbabilities()[0];
+  VectorXd expected = (T.transpose()*b).cwiseProduct(Z.col(1));
+  expected /= expected.sum();
+
+  VectorXd belief = env.UpdateBelief(b, 0, 1);
+  EXPECT_TRUE(belief.isApprox(expected));
+
+  VectorXd buffer;
+  ASSERT_TRUE(env.UpdateBelief(b, 0, 1, buffer));
+  EXPECT_TRUE(buffer.isApprox(expected));
+}
+
+TEST_F(POMDPEnvironmentTest, testUpdateBeliefImpossibleObservation) {
+  std::string f = writeFile(
+    "discount: 0.95\nvalues: reward\nstates: a b\nactions: go\nobservations: seen unseen\n"
+    "start: a\n"
+    "T: go identity\n"
+    "O: go\n1 0\n0 1\n");
+  POMDPEnvironment env(&f[0]);
+  ASSERT_TRUE(env.IsValid());
+  EXPECT_DOUBLE_EQ(1.0, env.GetInitialBelief()(0));
+
+  VectorXd buffer;
+  EXPECT_TRUE(env.UpdateBelief(env.GetInitialBelief(), 0, 0, buffer));
+  EXPECT_DOUBLE_EQ(1.0, buffer(0));
+  EXPECT_FALSE(env.UpdateBelief(env.GetInitialBelief(), 0, 1, buffer));
+}
+
+TEST_F(POMDPEnvironmentTest, testInvalidModels) {
+  std::string missing = "/tmp/pomdp_environment_test_missing";
+  POMDPEnvironment none(&missing[0]);
+  EXPECT_FALSE(none.IsValid());
+
+  std::string f = writeFile("states: 2\nactions: 1\nobservations: 1\nT: 0 : 5 : 0 1.0\n");
+  POMDPEnvironment unknown(&f[0]);
+  EXPECT_FALSE(unknown.IsValid());
+
+  std::string g = writeFile("T: 0\n1 0\n0 1\n");
+  POMDPEnvironment unsized(&g[0]);
+  EXPECT_FALSE(unsized.IsValid());
+}
@@ -0,0 +1,113 @@
+/*******************************************************************************
+pomdp_policy_test.cpp
+
+Unit tests for reading and pruning alpha vector policies.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "POMDPs/POMDPPolicy.h"
+
+#include <string>
+#include <vector>
+
+class POMDPPolicyTest : public TempFileTest {
+protected:
+  VectorXd belief(double p) {
+    VectorXd b(2);
+    b << p, 1.0 - p;
+    return b;
+  }
+};
+
+TEST_F(POMDPPolicyTest, testXMLMatchesCSV) {
+  std::string xml = writeFile(
+    "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n"
+    "<Policy version=\"0.1\" type=\"value\">\n"
+    "<AlphaVector vectorLength=\"2\" numObsValue=\"1\" numVectors=\"3\">\n"
+    "<Vector action=\"0\" obsValue=\"0\">-0.694065 5696.2 </Vector>\n"
+    "<Vector action=\"1\" obsValue=\"0\">2239.36 2816.83 </Vector>\n"
+    "<Vector action=\"2\" obsValue=\"0\">10 10 </Vector>\n"
+    "</AlphaVector> </Policy>\n");
+  std::string csv = writeFile("0,-0.694065,5696.2\n1,2239.36,2816.83\n2,10,10\n");
+  POMDPPolicy fromXML(&xml[0]);
+  POMDPPolicy fromCSV(&csv[0]);
+  ASSERT_TRUE(fromXML.IsValid());
+  ASSERT_TRUE(fromCSV.IsValid());
+
+  ASSERT_EQ(3, fromXML.GetNumVectors());
+  EXPECT_TRUE(fromXML.GetAlphaMatrix().isApprox(fromCSV.GetAlphaMatrix()));
+  EXPECT_EQ(fromCSV.GetActionVector(), fromXML.GetActionVector());
+  EXPECT_DOUBLE_EQ(2816.83, fromXML.GetPolicyMatrix()[1](1));
+
+  EXPECT_EQ(0, fromXML.GetBestAction(belief(0.0)));
+  EXPECT_EQ(1, fromXML.GetBestAction(belief(1.0)));
+}
+
+TEST_F(POMDPPolicyTest, testNegativeValues) {
+  std::string csv = writeFile("3,-5,-5\n4,-10,-1\n");
+  POMDPPolicy policy(&csv[0]);
+  ASSERT_TRUE(policy.IsValid());
+  EXPECT_EQ(3, policy.GetBestAction(belief(1.0)));
+  EXPECT_EQ(4, policy.GetBestAction(belief(0.0)));
+}
+
+TEST_F(POMDPPolicyTest, testPruneDominated) {
+  std::string csv = writeFile(
+    "0,10,0\n"   // best near belief(1)
+    "1,0,10\n"   // best near belief(0)
+    "2,6,6\n"    // best in the middle
+    "3,5,5\n"    // pointwise dominated by 2
+    "0,10,0\n"   // duplicate of the first
+    "1,4,4.5\n"  // pointwise dominated by 2
+    "2,7,2\n");  // below the upper envelope everywhere but not pointwise dominated
+  POMDPPolicy policy(&csv[0]);
+  POMDPPolicy unpruned(&csv[0]);
+  ASSERT_TRUE(policy.IsValid());
+
+  EXPECT_EQ(4, policy.PruneDominated());
+  ASSERT_EQ(3, policy.GetNumVectors());
+  std::vector<size_t> actions = {0, 1, 2};
+  EXPECT_EQ(actions, policy.GetActionVector());
+
+  for (int k = 0; k <= 100; k++) {
+    VectorXd b = belief(k/100.0);
+    EXPECT_EQ(unpruned.GetBestAction(b), policy.GetBestAction(b));
+    EXPECT_DOUBLE_EQ((unpruned.GetAlphaMatrix()*b).maxCoeff(), (policy.GetAlphaMatrix()*b).maxCoeff());
+  }
+  EXPECT_EQ(0, policy.PruneDominated());
+}
+
+TEST_F(POMDPPolicyTest, testInvalidPolicies) {
+  std::string missing = "/tmp/pomdp_policy_test_missing";
+  POMDPPolicy none(&missing[0]);
+  EXPECT_FALSE(none.IsValid());
+
+  std::string ragged = writeFile("0,1,2\n1,3\n");
+  POMDPPolicy raggedPolicy(&ragged[0]);
+  EXPECT_FALSE(raggedPolicy.IsValid());
+
+  std::string shortXML = writeFile("<AlphaVector vectorLength=\"2\">\n<Vector action=\"0\" obsValue=\"0\">1 </Vector>\n</AlphaVector>\n");
+  POMDPPolicy shortPolicy(&shortXML[0]);
+  EXPECT_FALSE(shortPolicy.IsValid());
+}
@@ -0,0 +1,85 @@
+/*******************************************************************************
+TempFileTest.h
+
+Shared fixture for tests that write temporary files.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef TEMP_FILE_TEST_H_
+#define TEMP_FILE_TEST_H_
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Fixture for tests that read and write files. Temporary files and
+// directories, and any other paths handed to removeLater, are removed when
+// the test ends, newest first so directories are empty by then.
+class TempFileTest : public::testing::Test {
+protected:
+  // A new empty file under /tmp
+  std::string tempName() {
+    char name[] = "/tmp/aadil_test_XXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+    return removeLater(name);
+  }
+
+  // A new empty directory under /tmp
+  std::string tempDir() {
+    char name[] = "/tmp/aadil_test_XXXXXX";
+    EXPECT_TRUE(mkdtemp(name) != NULL);
+    return removeLater(name);
+  }
+
+  // A temporary file holding text
+  std::string writeFile(const std::string& text) {
+    std::string name = tempName();
+    writeFile(name, text);
+    return name;
+  }
+
+  void writeFile(const std::string& name, const std::string& text) {
+    std::ofstream out(name.c_str());
+    out << text;
+  }
+
+  std::string removeLater(const std::string& name) {
+    files.push_back(name);
+    return name;
+  }
+
+  virtual void TearDown() {
+    for (size_t i = files.size(); i > 0; i--)
+      std::remove(files[i-1].c_str());
+  }
+
+ private:
+  std::vector<std::string> files;
+};
+
+#endif // TEMP_FILE_TEST_H_
@@ -0,0 +1,114 @@
+/*******************************************************************************
+hnsw_index_test.cpp
+
+Unit tests for the approximate nearest neighbour index.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Utilities/HnswIndex.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Utilities.h"
+
+#include <cmath>
+#include <vector>
+
+class HnswIndexTest : public::testing::Test {
+protected:
+  size_t dim = 16;
+
+  std::vector<double> randomPoints(size_t n) {
+    std::vector<double> p;
+    for (size_t i = 0; i < n*dim; i++) {
+      p.push_back(easymath::rand_interval(-1.0, 1.0));
+    }
+    return p;
+  }
+};
+
+TEST_F(HnswIndexTest, testEmptyIndex) {
+  HnswIndex index(dim);
+  std::vector<double> q(dim, 0.0);
+  size_t id;
+  double d;
+  EXPECT_FALSE(index.Nearest(&q[0], id, d));
+  EXPECT_EQ(0, index.KNearest(&q[0], 3).size());
+}
+
+TEST_F(HnswIndexTest, testStoredPointsAreFound) {
+  easymath::seed_generator(1);
+  HnswIndex index(dim);
+  std::vector<double> points = randomPoints(500);
+  index.Build(points);
+  ASSERT_EQ(500, index.Size());
+  for (size_t i = 0; i < 500; i++) {
+    size_t id;
+    double d;
+    ASSERT_TRUE(index.Nearest(&points[i*dim], id, d));
+    EXPECT_EQ(0.0, d);
+  }
+}
+
+TEST_F(HnswIndexTest, testRecallImprovesWithSearchWidth) {
+  easymath::seed_generator(2);
+  HnswIndex index(dim, 12, 80);
+  index.Build(randomPoints(3000));
+  std::vector<double> queries = randomPoints(200);
+
+  index.SetEfSearch(1);
+  double narrow = index.RecallAtOne(queries);
+  index.SetEfSearch(100);
+  double wide = index.RecallAtOne(queries);
+  EXPECT_GE(wide, narrow);
+  EXPECT_GE(wide, 0.9);
+
+  // k nearest are returned closest first
+  std::vector<size_t> ids = index.KNearest(&queries[0], 10);
+  ASSERT_EQ(10, ids.size());
+  for (size_t k = 1; k < ids.size(); k++) {
+    double a = 0.0, b = 0.0;
+    for (size_t j = 0; j < dim; j++) {
+      a += std::pow(index.GetPoint(ids[k-1])[j] - queries[j], 2);
+      b += std::pow(index.GetPoint(ids[k])[j] - queries[j], 2);
+    }
+    EXPECT_LE(a, b);
+  }
+}
+
+TEST_F(HnswIndexTest, testConcurrentQueriesMatchSerial) {
+  easymath::seed_generator(3);
+  HnswIndex index(dim);
+  index.Build(randomPoints(1000));
+  std::vector<double> queries = randomPoints(100);
+
+  std::vector<size_t> serial(100), parallel(100);
+  for (size_t i = 0; i < 100; i++) {
+    double d;
+    index.Nearest(&queries[i*dim], serial[i], d);
+  }
+  ThreadPool pool(4);
+  pool.ParallelFor(100, [&](size_t i, size_t w) {
+    double d;
+    index.Nearest(&queries[i*dim], parallel[i], d);
+  });
+  EXPECT_EQ(serial, parallel);
+}
@@ -0,0 +1,165 @@
+/*******************************************************************************
+kd_tree_test.cpp
+
+Unit tests for the kd-tree.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Utilities/KdTree.h"
+#include "Utilities/Utilities.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class KdTreeTest : public::testing::Test {
+protected:
+  size_t dim = 3;
+
+  std::vector<double> randomPoints(size_t n) {
+    std::vector<double> p;
+    for (size_t i = 0; i < n*dim; i++) {
+      p.push_back(easymath::rand_interval(-1.0, 1.0));
+    }
+    return p;
+  }
+
+  double sqDist(const double* a, const double* b) {
+    double d = 0.0;
+    for (size_t i = 0; i < dim; i++) d += (a[i]-b[i])*(a[i]-b[i]);
+    return d;
+  }
+
+  // Ids of live points sorted by distance to q
+  std::vector<size_t> bruteForce(KdTree& tree, size_t n, const double* q) {
+    std::vector<size_t> ids;
+    for (size_t i = 0; i < n; i++) {
+      if (!tree.IsRemoved(i)) ids.push_back(i);
+    }
+    std::sort(ids.begin(), ids.end(), [&](size_t a, size_t b) {
+      return sqDist(q, tree.GetPoint(a)) < sqDist(q, tree.GetPoint(b));
+    });
+    return ids;
+  }
+};
+
+TEST_F(KdTreeTest, testBuildMatchesBruteForce) {
+  KdTree tree(dim);
+  tree.Build(randomPoints(500));
+  EXPECT_EQ(tree.Size(), 500);
+  for (int t = 0; t < 50; t++) {
+    std::vector<double> q = randomPoints(1);
+    std::vector<size_t> expected = bruteForce(tree, 500, &q[0]);
+
+    size_t id;
+    double d;
+    ASSERT_TRUE(tree.Nearest(&q[0], id, d));
+    EXPECT_EQ(id, expected[0]);
+
+    std::vector<size_t> knn = tree.KNearest(&q[0], 5);
+    ASSERT_EQ(knn.size(), 5);
+    for (size_t k = 0; k < 5; k++) EXPECT_EQ(knn[k], expected[k]);
+
+    std::vector<size_t> inside = tree.Radius(&q[0], 0.3);
+    size_t count = 0;
+    for (size_t i : expected) {
+      if (sqDist(&q[0], tree.GetPoint(i)) <= 0.09) count++;
+    }
+    EXPECT_EQ(inside.size(), count);
+  }
+}
+
+TEST_F(KdTreeTest, testInsertAndRemove) {
+  KdTree tree(dim);
+  size_t id;
+  double d;
+  std::vector<double> q = randomPoints(1);
+  EXPECT_FALSE(tree.Nearest(&q[0], id, d));
+
+  // Sorted insertions force rebuilds
+  for (size_t i = 0; i < 300; i++) {
+    double p[3] = {i*0.01, 0.0, -(double)i*0.01};
+    EXPECT_EQ(tree.Insert(p), i);
+  }
+  EXPECT_LT(tree.Depth(), 300);
+  for (size_t i = 0; i < 300; i += 2) tree.Remove(i);
+  EXPECT_EQ(tree.Size(), 150);
+
+  for (int t = 0; t < 20; t++) {
+    q = randomPoints(1);
+    std::vector<size_t> expected = bruteForce(tree, 300, &q[0]);
+    ASSERT_TRUE(tree.Nearest(&q[0], id, d));
+    EXPECT_EQ(id, expected[0]);
+    EXPECT_EQ(id % 2, 1);
+  }
+}
+
+TEST_F(KdTreeTest, testSortedInsertionKeepsDepthLogarithmic) {
+  // Sorted points, then a cluster of identical ones
+  KdTree tree(dim);
+  size_t n = 4000;
+  for (size_t i = 0; i < n; i++) {
+    double x = i < 3000 ? i*0.001 : 5.0;
+    double p[3] = {x, 2.0*x, -x};
+    tree.Insert(p);
+    double bound = std::log((double)(i+1))/std::log(1.0/0.7) + 2.0;
+    ASSERT_LE(tree.Depth(), bound) << "after " << i+1 << " insertions";
+  }
+
+  for (int t = 0; t < 20; t++) {
+    std::vector<double> q = randomPoints(1);
+    q[0] = easymath::rand_interval(0.0, 6.0);
+    std::vector<size_t> expected = bruteForce(tree, n, &q[0]);
+    size_t id;
+    double d;
+    ASSERT_TRUE(tree.Nearest(&q[0], id, d));
+    EXPECT_DOUBLE_EQ(d, sqDist(&q[0], tree.GetPoint(expected[0])));
+  }
+}
+
+TEST_F(KdTreeTest, testImplicitTreeMatchesBruteForce) {
+  easymath::seed_generator(9);
+  std::vector<double> original = randomPoints(400);
+  // Duplicate points must not confuse the split
+  original.insert(original.end(), original.begin(), original.begin() + 30*dim);
+  std::vector<double> sorted = original;
+  std::vector<unsigned int> axes;
+  std::vector<size_t> order = KdTree::BuildImplicit(sorted, dim, axes);
+  ASSERT_EQ(order.size(), 430);
+  for (size_t i = 0; i < order.size(); i++) {
+    EXPECT_EQ(0.0, sqDist(&sorted[i*dim], &original[order[i]*dim]));
+  }
+
+  for (int t = 0; t < 50; t++) {
+    std::vector<double> q = randomPoints(1);
+    double best = DBL_MAX;
+    for (size_t i = 0; i < 430; i++) {
+      best = std::min(best, sqDist(&q[0], &original[i*dim]));
+    }
+    size_t pos;
+    double d;
+    ASSERT_TRUE(KdTree::NearestImplicit(&sorted[0], &axes[0], 430, dim, &q[0], pos, d));
+    EXPECT_DOUBLE_EQ(best, d);
+    EXPECT_DOUBLE_EQ(d, sqDist(&q[0], &sorted[pos*dim]));
+  }
+}
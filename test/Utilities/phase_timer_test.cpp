@@ -0,0 +1,67 @@
+/*******************************************************************************
+phase_timer_test.cpp
+
+Unit tests for training phase timers.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Utilities/PhaseTimer.h"
+
+#include <string>
+
+class PhaseTimerTest : public::testing::Test {
+protected:
+  virtual void TearDown() {
+    easytime::enable(false);
+    easytime::reset();
+  }
+};
+
+TEST_F(PhaseTimerTest, testDisabledRecordsNothing) {
+  easytime::enable(false);
+  easytime::reset();
+  {
+    easytime::ScopedTimer timer(easytime::STEP);
+  }
+  easytime::totals t = easytime::snapshot();
+  EXPECT_EQ(t.calls[easytime::STEP], 0);
+  EXPECT_EQ(t.ns[easytime::STEP], 0);
+}
+
+TEST_F(PhaseTimerTest, testEnabledCountsCalls) {
+  easytime::enable(true);
+  easytime::reset();
+  for (int i = 0; i < 3; i++) {
+    easytime::ScopedTimer timer(easytime::SENSE);
+    timer.Stop();
+    timer.Stop(); // only the first stop is recorded
+  }
+  easytime::totals t = easytime::snapshot();
+  EXPECT_EQ(t.calls[easytime::SENSE], 3);
+  EXPECT_EQ(t.calls[easytime::POLICY], 0);
+
+  std::string json = easytime::to_json(t, 7);
+  EXPECT_EQ(json.find("{\"epoch\":7,"), 0);
+  EXPECT_NE(json.find("\"sense\":{\"ms\":"), std::string::npos);
+  EXPECT_NE(json.find("\"calls\":3}"), std::string::npos);
+}
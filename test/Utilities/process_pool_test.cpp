@@ -0,0 +1,117 @@
+/*******************************************************************************
+process_pool_test.cpp
+
+Unit tests for the forked process pool.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Utilities/ProcessPool.h"
+#include "Utilities/Utilities.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class ProcessPoolTest : public::testing::Test {};
+
+TEST_F(ProcessPoolTest, testExitStatusPerJob) {
+  ProcessPool pool(3);
+  EXPECT_EQ(pool.NumWorkers(), 3);
+  std::vector<size_t> order;
+  std::vector<ProcessResult> results = pool.Run(7, [](size_t i) { return (int) i + 1; },
+    [&](size_t i, const ProcessResult& r) {
+      EXPECT_EQ(r.status, (int) i + 1);
+      order.push_back(i);
+    });
+  ASSERT_EQ(results.size(), 7);
+  ASSERT_EQ(order.size(), 7);
+  for (size_t i = 0; i < results.size(); i++) {
+    EXPECT_EQ(results[i].status, (int) i + 1);
+    EXPECT_GE(results[i].seconds, 0.0);
+  }
+  EXPECT_TRUE(pool.Run(0, [](size_t i) { return 0; }).empty());
+}
+
+TEST_F(ProcessPoolTest, testWallTimeAndPeakMemory) {
+  // The second job touches 64MB and runs for at least 50ms
+  const size_t bytes = 64 << 20;
+  ProcessPool pool(2);
+  std::vector<ProcessResult> results = pool.Run(2, [&](size_t i) {
+    if (i == 1) {
+      std::vector<char> block(bytes, 1);
+      usleep(50000);
+      return (int) block[bytes - 1];
+    }
+    return 0;
+  });
+  EXPECT_EQ(results[0].status, 0);
+  EXPECT_EQ(results[1].status, 1);
+  EXPECT_GE(results[1].seconds, 0.05);
+  EXPECT_GE(results[1].peakRSS, (long) (bytes >> 10));
+  EXPECT_LT(results[0].peakRSS, results[1].peakRSS);
+}
+
+TEST_F(ProcessPoolTest, testKilledJobFails) {
+  ProcessPool pool(1);
+  std::vector<ProcessResult> results = pool.Run(1, [](size_t i) {
+    abort();
+    return 0;
+  });
+  EXPECT_EQ(results[0].status, -1);
+}
+
+TEST_F(ProcessPoolTest, testJobsDoNotShareState) {
+  // Each child seeds its own random stream and writes its first draw. The
+  //   parent's stream and memory are untouched.
+  std::string prefix = "process_pool_test_";
+  easymath::seed_generator(99);
+  unsigned expected = easymath::generator()();
+  easymath::seed_generator(99);
+  int counter = 0;
+
+  ProcessPool pool(2);
+  std::vector<ProcessResult> results = pool.Run(4, [&](size_t i) {
+    counter += 10;
+    easymath::seed_generator(100 + i);
+    std::ofstream out((prefix + std::to_string(i)).c_str());
+    out << easymath::generator()() << " " << counter;
+    return 0;
+  });
+
+  EXPECT_EQ(counter, 0);
+  EXPECT_EQ(easymath::generator()(), expected);
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(results[i].status, 0);
+    std::ifstream in((prefix + std::to_string(i)).c_str());
+    unsigned draw;
+    int childCounter;
+    ASSERT_TRUE(in >> draw >> childCounter);
+    easymath::seed_generator(100 + i);
+    EXPECT_EQ(draw, easymath::generator()());
+    EXPECT_EQ(childCounter, 10);
+    std::remove((prefix + std::to_string(i)).c_str());
+  }
+}
@@ -0,0 +1,61 @@
+/*******************************************************************************
+thread_pool_test.cpp
+
+Unit tests for the worker thread pool.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "Utilities/ThreadPool.h"
+
+#include <atomic>
+#include <vector>
+
+class ThreadPoolTest : public::testing::Test {};
+
+TEST_F(ThreadPoolTest, testEveryIndexRunsOnce) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.NumWorkers(), 4);
+  for (size_t n = 0; n < 50; n += 7) {
+    std::vector<std::atomic<int>> calls(n);
+    for (auto& c : calls) c = 0;
+    std::atomic<bool> badWorker(false);
+    pool.ParallelFor(n, [&](size_t i, size_t w) {
+      calls[i]++;
+      if (w >= pool.NumWorkers()) badWorker = true;
+    });
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_EQ(calls[i], 1);
+    }
+    EXPECT_FALSE(badWorker);
+  }
+}
+
+TEST_F(ThreadPoolTest, testSingleThreadRunsInOrder) {
+  ThreadPool pool(1);
+  std::vector<size_t> order;
+  pool.ParallelFor(5, [&](size_t i, size_t w) { order.push_back(i); });
+  ASSERT_EQ(order.size(), 5);
+  for (size_t i = 0; i < 5; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+}
@@ -0,0 +1,186 @@
+/*******************************************************************************
+trajectory_archive_test.cpp
+
+Unit tests for the compressed trajectory archive.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "Utilities/TrajectoryArchive.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+class TrajectoryArchiveTest : public TempFileTest {
+protected:
+  virtual void SetUp() {
+    fileName = tempName();
+    removeLater(fileName + ".bin");
+  }
+
+  // Unit steps from a random start, in recorder order (step then agent)
+  std::vector<TrajectoryRecord> randomWalk(unsigned int epoch, unsigned int team,
+					   size_t nAgents, size_t nSteps, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> unif(-1.0, 1.0);
+    std::vector<double> x(nAgents), y(nAgents), psi(nAgents);
+    for (size_t a = 0; a < nAgents; a++) {
+      x[a] = 10 + 5*unif(gen);
+      y[a] = 10 + 5*unif(gen);
+    }
+    std::vector<TrajectoryRecord> records;
+    for (unsigned int t = 0; t < nSteps; t++) {
+      for (unsigned int a = 0; a < nAgents; a++) {
+	double heading = 3.14159*unif(gen);
+	x[a] += std::cos(heading);
+	y[a] += std::sin(heading);
+	TrajectoryRecord r = {epoch, team, t, a, x[a], y[a], heading};
+	records.push_back(r);
+      }
+    }
+    return records;
+  }
+
+  void expectClose(const std::vector<TrajectoryRecord>& expected,
+		   const std::vector<TrajectoryRecord>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_EQ(expected[i].epoch, actual[i].epoch);
+      EXPECT_EQ(expected[i].team, actual[i].team);
+      EXPECT_EQ(expected[i].step, actual[i].step);
+      EXPECT_EQ(expected[i].agent, actual[i].agent);
+      EXPECT_NEAR(expected[i].x, actual[i].x, 0.5e-3 + 1e-12);
+      EXPECT_NEAR(expected[i].y, actual[i].y, 0.5e-3 + 1e-12);
+      EXPECT_NEAR(expected[i].psi, actual[i].psi, 0.5e-4 + 1e-12);
+    }
+  }
+
+  std::string fileName;
+};
+
+TEST_F(TrajectoryArchiveTest, testRandomAccess) {
+  std::vector< std::vector<TrajectoryRecord> > trajectories;
+  {
+    TrajectoryArchiveWriter writer;
+    ASSERT_TRUE(writer.Open(fileName));
+    for (unsigned int e = 0; e < 3; e++) {
+      for (unsigned int team = 0; team < 4; team++) {
+	trajectories.push_back(randomWalk(e, team, 3, 50, 10*e + team));
+	ASSERT_TRUE(writer.AddTrajectory(e, team, trajectories.back()));
+      }
+    }
+  }
+
+  TrajectoryArchiveReader reader;
+  ASSERT_TRUE(reader.Open(fileName));
+  EXPECT_EQ(12, reader.NumTrajectories());
+  EXPECT_DOUBLE_EQ(1e-3, reader.GetPositionQuantum());
+  EXPECT_TRUE(reader.Contains(2, 3));
+  EXPECT_FALSE(reader.Contains(3, 0));
+
+  std::vector<TrajectoryRecord> records;
+  ASSERT_TRUE(reader.ReadTrajectory(1, 2, records));
+  expectClose(trajectories[1*4 + 2], records);
+  ASSERT_TRUE(reader.ReadTrajectory(0, 0, records));
+  expectClose(trajectories[0], records);
+  EXPECT_FALSE(reader.ReadTrajectory(5, 5, records));
+}
+
+TEST_F(TrajectoryArchiveTest, testRecordOrderAndReplacement) {
+  std::vector<TrajectoryRecord> walk = randomWalk(0, 1, 2, 20, 3);
+  std::vector<TrajectoryRecord> reversed(walk.rbegin(), walk.rend());
+  std::vector<TrajectoryRecord> other = randomWalk(0, 1, 4, 5, 4);
+  {
+    TrajectoryArchiveWriter writer;
+    ASSERT_TRUE(writer.Open(fileName));
+    ASSERT_TRUE(writer.AddTrajectory(0, 0, reversed));
+    ASSERT_TRUE(writer.AddTrajectory(0, 1, walk));
+    ASSERT_TRUE(writer.AddTrajectory(0, 1, other));
+    walk.pop_back();
+    EXPECT_FALSE(writer.AddTrajectory(0, 2, walk)); // an agent is missing a step
+    walk.push_back(walk.back());
+    EXPECT_FALSE(writer.AddTrajectory(0, 2, walk)); // a record is repeated
+  }
+
+  TrajectoryArchiveReader reader;
+  ASSERT_TRUE(reader.Open(fileName));
+  EXPECT_EQ(2, reader.NumTrajectories());
+  std::vector<TrajectoryRecord> records;
+  ASSERT_TRUE(reader.ReadTrajectory(0, 1, records));
+  expectClose(other, records);
+  ASSERT_TRUE(reader.ReadTrajectory(0, 0, records));
+  std::vector<TrajectoryRecord> ordered = randomWalk(0, 1, 2, 20, 3);
+  for (auto& r : ordered) {
+    r.team = 0;
+  }
+  expectClose(ordered, records);
+}
+
+TEST_F(TrajectoryArchiveTest, testFromRecorderFile) {
+  std::vector<TrajectoryRecord> all;
+  {
+    TrajectoryRecorder recorder(64);
+    ASSERT_TRUE(recorder.Open(fileName + ".bin"));
+    for (unsigned int e = 0; e < 2; e++) {
+      for (unsigned int team = 0; team < 6; team++) {
+	std::vector<TrajectoryRecord> walk = randomWalk(e, team, 5, 100, 7*e + team);
+	for (const auto& r : walk) {
+	  recorder.Append(r);
+	}
+	all.insert(all.end(), walk.begin(), walk.end());
+      }
+    }
+  }
+  ASSERT_TRUE(TrajectoryArchiveWriter::FromRecorderFile(fileName + ".bin", fileName));
+
+  TrajectoryArchiveReader reader;
+  ASSERT_TRUE(reader.Open(fileName));
+  EXPECT_EQ(12, reader.NumTrajectories());
+  std::vector<TrajectoryRecord> records, decoded;
+  for (const auto& k : reader.GetKeys()) {
+    ASSERT_TRUE(reader.ReadTrajectory(k.first, k.second, records));
+    decoded.insert(decoded.end(), records.begin(), records.end());
+  }
+  expectClose(all, decoded);
+
+  std::ifstream bin((fileName + ".bin").c_str(), std::ios::binary | std::ios::ate);
+  std::ifstream archive(fileName.c_str(), std::ios::binary | std::ios::ate);
+  EXPECT_LT(4*archive.tellg(), bin.tellg());
+}
+
+TEST_F(TrajectoryArchiveTest, testUnclosedArchiveRejected) {
+  {
+    std::ofstream out(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    TrajectoryArchiveHeader header = {{'A','A','D','I','L','T','R','A'}, TRAJECTORY_ARCHIVE_VERSION, 0, 1e-3, 1e-4};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  TrajectoryArchiveReader reader;
+  EXPECT_FALSE(reader.Open(fileName));
+  std::string missing = fileName + ".missing";
+  EXPECT_FALSE(reader.Open(missing));
+}
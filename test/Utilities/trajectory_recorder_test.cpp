@@ -0,0 +1,148 @@
+/*******************************************************************************
+trajectory_recorder_test.cpp
+
+Unit tests for the binary trajectory recorder.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "Utilities/TrajectoryRecorder.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+class TrajectoryRecorderTest : public TempFileTest {
+protected:
+  virtual void SetUp() {
+    fileName = tempName();
+    removeLater(fileName + ".csv");
+  }
+
+  std::string fileName;
+};
+
+TEST_F(TrajectoryRecorderTest, testRecordsAcrossBlocks) {
+  std::vector<TrajectoryRecord> expected;
+  {
+    TrajectoryRecorder recorder(7);
+    ASSERT_TRUE(recorder.Open(fileName));
+    for (unsigned int step = 0; step < 10; step++) {
+      for (unsigned int agent = 0; agent < 3; agent++) {
+	TrajectoryRecord r = {2, 5, step, agent, step + 0.25*agent, -1.5*step, 0.1*agent};
+	recorder.Append(r);
+	expected.push_back(r);
+      }
+    }
+    recorder.Flush();
+
+    std::vector<TrajectoryRecord> flushed;
+    ASSERT_TRUE(TrajectoryRecorder::Read(fileName, flushed));
+    EXPECT_EQ(expected.size(), flushed.size());
+
+    recorder.Append(3, 0, 0, 1, 4.0, 5.0, 6.0);
+    TrajectoryRecord last = {3, 0, 0, 1, 4.0, 5.0, 6.0};
+    expected.push_back(last);
+  }
+
+  std::vector<TrajectoryRecord> records;
+  ASSERT_TRUE(TrajectoryRecorder::Read(fileName, records));
+  ASSERT_EQ(expected.size(), records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    EXPECT_EQ(expected[i].epoch, records[i].epoch);
+    EXPECT_EQ(expected[i].team, records[i].team);
+    EXPECT_EQ(expected[i].step, records[i].step);
+    EXPECT_EQ(expected[i].agent, records[i].agent);
+    EXPECT_EQ(expected[i].x, records[i].x);
+    EXPECT_EQ(expected[i].y, records[i].y);
+    EXPECT_EQ(expected[i].psi, records[i].psi);
+  }
+}
+
+TEST_F(TrajectoryRecorderTest, testWriteCSV) {
+  {
+    TrajectoryRecorder recorder;
+    ASSERT_TRUE(recorder.Open(fileName));
+    recorder.Append(1, 2, 3, 4, 0.5, -2.0, 1.25);
+  }
+  ASSERT_TRUE(TrajectoryRecorder::WriteCSV(fileName, fileName + ".csv"));
+  std::ifstream csv((fileName + ".csv").c_str());
+  std::string header, line;
+  std::getline(csv, header);
+  std::getline(csv, line);
+  EXPECT_EQ("epoch,team,step,agent,x,y,psi", header);
+  EXPECT_EQ("1,2,3,4,0.5,-2,1.25", line);
+}
+
+TEST_F(TrajectoryRecorderTest, testTruncatedBlockIgnored) {
+  {
+    TrajectoryRecorder recorder(4);
+    ASSERT_TRUE(recorder.Open(fileName));
+    for (unsigned int i = 0; i < 6; i++) {
+      recorder.Append(0, 0, i, 0, i, i, i);
+    }
+  }
+  std::ifstream in(fileName.c_str(), std::ios::binary | std::ios::ate);
+  long size = in.tellg();
+  in.close();
+  ASSERT_EQ(0, truncate(fileName.c_str(), size - 8));
+
+  std::vector<TrajectoryRecord> records;
+  ASSERT_TRUE(TrajectoryRecorder::Read(fileName, records));
+  EXPECT_EQ(4, records.size());
+
+  std::string missing = fileName + ".missing";
+  EXPECT_FALSE(TrajectoryRecorder::Read(missing, records));
+}
+
+TEST_F(TrajectoryRecorderTest, testReopenAfterClose) {
+  TrajectoryRecorder recorder(2);
+
+  // Nothing is buffered or written before a file is open
+  recorder.Append(0, 0, 0, 0, 1.0, 1.0, 1.0);
+  recorder.Flush();
+  recorder.Close();
+  EXPECT_FALSE(recorder.IsOpen());
+
+  std::string second = removeLater(fileName + ".second");
+  for (int pass = 0; pass < 2; pass++) {
+    std::string name = (pass == 0) ? fileName : second;
+    ASSERT_TRUE(recorder.Open(name));
+    for (unsigned int i = 0; i < 5; i++) {
+      recorder.Append(pass, 0, i, 0, i, i, i);
+    }
+    recorder.Close();
+    EXPECT_FALSE(recorder.IsOpen());
+    recorder.Append(9, 9, 9, 9, 9.0, 9.0, 9.0);
+
+    std::vector<TrajectoryRecord> records;
+    ASSERT_TRUE(TrajectoryRecorder::Read(name, records));
+    ASSERT_EQ(5, records.size());
+    for (unsigned int i = 0; i < 5; i++) {
+      EXPECT_EQ(pass, records[i].epoch);
+      EXPECT_EQ(i, records[i].step);
+    }
+  }
+}
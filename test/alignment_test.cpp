@@ -29,7 +29,20 @@ SOFTWARE.
 
 #include "gtest/gtest.h"
 #include "alignment.h"
+#include "alignments.h"
+#include "alignmentDB.h"
+#include "Domains/G.h"
+#include "Domains/TeamForming.h"
+#include "Utilities/Utilities.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
 
 class AlignmentTest : public::testing::Test {};
 
@@ -81,3 +94,489 @@ TEST_F(AlignmentTest, testMappend) {
     EXPECT_DOUBLE_EQ(z.alignMag(), c.alignMag());
   }
 }
+
+class AlignmentsTest : public::testing::Test {
+protected:
+  size_t dim = 4;
+  G g = G(1, 100, 1);
+  TeamForming t = TeamForming(2, 2, 1);
+  std::vector<Objective*> objs = {&g, &t};
+
+  std::vector<double> randomKeys(size_t n) {
+    std::vector<double> k;
+    for (size_t i = 0; i < n*dim; i++) {
+      k.push_back(easymath::rand_interval(-1.0, 1.0));
+    }
+    return k;
+  }
+
+  // One alignment per key that identifies it
+  std::vector< std::vector<Alignment> > labels(size_t n, size_t first) {
+    std::vector< std::vector<Alignment> > v;
+    for (size_t i = 0; i < n; i++) {
+      v.push_back(std::vector<Alignment>(1, Alignment::fromParts(1, first + i)));
+    }
+    return v;
+  }
+
+  std::vector<double> key(const std::vector<double>& keys, size_t i) {
+    return std::vector<double>(keys.begin()+i*dim, keys.begin()+(i+1)*dim);
+  }
+
+  // Label of the stored key nearest to q
+  double bruteForce(const std::vector<double>& keys, const std::vector<double>& q) {
+    size_t best = 0;
+    double bestDist = -1;
+    for (size_t i = 0; i*dim < keys.size(); i++) {
+      double d = 0.0;
+      for (size_t j = 0; j < dim; j++) d += (keys[i*dim+j]-q[j])*(keys[i*dim+j]-q[j]);
+      if (bestDist < 0 || d < bestDist) {
+	best = i;
+	bestDist = d;
+      }
+    }
+    return best;
+  }
+
+  std::string readFile(const std::string& name) {
+    std::ifstream in(name.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+};
+
+TEST_F(AlignmentsTest, testNearestMatchesBruteForce) {
+  std::string name = "alignments_test_nn.db";
+  std::remove(name.c_str());
+  easymath::seed_generator(3);
+  std::vector<double> keys = randomKeys(1000);
+  ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, keys, labels(1000, 0)));
+
+  Alignments a(objs, 4);
+  EXPECT_TRUE(a.getAlignmentsNN(key(keys, 0)).empty());
+  ASSERT_TRUE(a.readDatabase(name.c_str()));
+  ASSERT_EQ(1000, a.size());
+
+  for (int trial = 0; trial < 200; trial++) {
+    std::vector<double> q = key(randomKeys(1), 0);
+    std::vector<Alignment> r = a.getAlignmentsNN(q);
+    ASSERT_EQ(1, r.size());
+    EXPECT_EQ(bruteForce(keys, q), r[0].alignMag());
+  }
+  EXPECT_TRUE(a.getAlignmentsNN(std::vector<double>(dim+1, 0.0)).empty());
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testDuplicateKeysKeepFirstAlignments) {
+  std::string first = "alignments_test_dup1.db";
+  std::string second = "alignments_test_dup2.db";
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+  easymath::seed_generator(4);
+  std::vector<double> keys = randomKeys(100);
+
+  // Duplicates inside one bulk build, and against keys already stored
+  std::vector<double> half(keys.begin(), keys.begin()+50*dim);
+  ASSERT_TRUE(AlignmentDB::appendShard(first.c_str(), dim, keys, labels(100, 0)));
+  ASSERT_TRUE(AlignmentDB::appendShard(first.c_str(), dim, half, labels(50, 100)));
+  ASSERT_TRUE(AlignmentDB::appendShard(second.c_str(), dim, keys, labels(100, 1000)));
+
+  Alignments a(objs, 4);
+  ASSERT_TRUE(a.readDatabase(first.c_str()));
+  EXPECT_EQ(100, a.size());
+  ASSERT_TRUE(a.readDatabase(second.c_str()));
+  EXPECT_EQ(100, a.size());
+  for (size_t i = 0; i < 100; i++) {
+    std::vector<Alignment> r = a.getAlignmentsNN(key(keys, i));
+    ASSERT_EQ(1, r.size());
+    EXPECT_EQ(i, r[0].alignMag());
+  }
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+}
+
+TEST_F(AlignmentsTest, testApproximateIndex) {
+  std::string name = "alignments_test_hnsw.db";
+  std::remove(name.c_str());
+  easymath::seed_generator(5);
+  std::vector<double> keys = randomKeys(2000);
+  ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, keys, labels(2000, 0)));
+
+  Alignments a(objs, 4);
+  ASSERT_TRUE(a.readDatabase(name.c_str()));
+  EXPECT_FALSE(a.isApproximate());
+  a.useApproximateIndex(16, 100, 50);
+  ASSERT_TRUE(a.isApproximate());
+  EXPECT_EQ(2000, a.size());
+
+  // Stored states are found exactly
+  size_t found = 0;
+  for (size_t i = 0; i < 2000; i++) {
+    std::vector<Alignment> r = a.getAlignmentsNN(key(keys, i));
+    if (r.size() == 1 && r[0].alignMag() == i) found++;
+  }
+  EXPECT_GE(found, 1980);
+
+  std::vector< std::vector<double> > queries;
+  size_t agree = 0;
+  for (int i = 0; i < 200; i++) {
+    queries.push_back(key(randomKeys(1), 0));
+    if (a.getAlignmentsNN(queries.back())[0].alignMag() == bruteForce(keys, queries.back())) agree++;
+  }
+  double recall = a.approximateRecall(queries);
+  EXPECT_GE(recall, 0.9);
+  EXPECT_EQ(agree, (size_t) (recall*queries.size() + 0.5));
+
+  a.setApproximateSearchWidth(1);
+  EXPECT_LE(a.approximateRecall(queries), recall);
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testParallelSamplesDoNotDependOnThreads) {
+  std::string one = "alignments_test_one.db";
+  std::string three = "alignments_test_three.db";
+  std::string other = "alignments_test_other.db";
+  std::remove(one.c_str());
+  std::remove(three.c_str());
+  std::remove(other.c_str());
+
+  easymath::seed_generator(6);
+  std::string state = easymath::get_generator_state();
+  Alignments a(objs, 3);
+  a.addAlignments(20, 1, 77);
+  EXPECT_EQ(state, easymath::get_generator_state());
+  Alignments b(objs, 3);
+  b.addAlignments(20, 3, 77);
+  Alignments c(objs, 3);
+  c.addAlignments(20, 3, 78);
+
+  ASSERT_GT(a.size(), 0);
+  EXPECT_EQ(a.size(), b.size());
+  ASSERT_TRUE(a.writeDatabase(one.c_str()));
+  ASSERT_TRUE(b.writeDatabase(three.c_str()));
+  ASSERT_TRUE(c.writeDatabase(other.c_str()));
+  EXPECT_EQ(readFile(one), readFile(three));
+  EXPECT_NE(readFile(one), readFile(other));
+  std::remove(one.c_str());
+  std::remove(three.c_str());
+  std::remove(other.c_str());
+}
+
+TEST_F(AlignmentsTest, testDatabaseRoundTrip) {
+  std::string name = "alignments_test_round_trip.db";
+  std::remove(name.c_str());
+  easymath::seed_generator(7);
+  Alignments a(objs, 3);
+  a.addAlignments(10);
+  ASSERT_TRUE(a.writeDatabase(name.c_str()));
+  a.addAlignments(10);
+  ASSERT_TRUE(a.writeDatabase(name.c_str()));
+
+  AlignmentDB file;
+  ASSERT_TRUE(file.open(name.c_str()));
+  EXPECT_EQ(2, file.numShards());
+  EXPECT_EQ(a.size(), file.size());
+
+  Alignments copied(objs, 3);
+  ASSERT_TRUE(copied.readDatabase(name.c_str()));
+  Alignments mapped(objs, 3);
+  ASSERT_TRUE(mapped.openDatabase(name.c_str()));
+  EXPECT_TRUE(mapped.isReadOnly());
+  EXPECT_FALSE(copied.isReadOnly());
+  EXPECT_EQ(a.size(), copied.size());
+  EXPECT_EQ(a.size(), mapped.size());
+
+  // Stored states and nearby states get the same alignments from every table
+  std::vector< std::vector<double> > queries;
+  for (size_t s = 0; s < file.numShards(); s++) {
+    for (size_t i = 0; i < file.shardSize(s); i += 5) {
+      std::vector<double> q(file.getKey(s, i), file.getKey(s, i)+file.dim());
+      queries.push_back(q);
+      for (auto& x : q) x += easymath::rand_interval(-0.01, 0.01);
+      queries.push_back(q);
+    }
+  }
+  for (const auto& q : queries) {
+    std::vector<Alignment> expected = a.getAlignmentsNN(q);
+    std::vector<Alignment> c = copied.getAlignmentsNN(q);
+    std::vector<Alignment> m = mapped.getAlignmentsNN(q);
+    ASSERT_EQ(expected.size(), c.size());
+    ASSERT_EQ(expected.size(), m.size());
+    for (size_t k = 0; k < expected.size(); k++) {
+      EXPECT_EQ(expected[k].alignScore(), c[k].alignScore());
+      EXPECT_EQ(expected[k].alignMag(), c[k].alignMag());
+      EXPECT_EQ(expected[k].alignScore(), m[k].alignScore());
+      EXPECT_EQ(expected[k].alignMag(), m[k].alignMag());
+    }
+  }
+
+  // The mapped table is read only
+  mapped.addAlignments(1);
+  EXPECT_EQ(a.size(), mapped.size());
+  EXPECT_FALSE(mapped.readDatabase(name.c_str()));
+  EXPECT_FALSE(mapped.writeDatabase(name.c_str()));
+  EXPECT_FALSE(copied.openDatabase(name.c_str()));
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testStreamingMergesWithinEpsilon) {
+  std::string first = "alignments_test_merge1.db";
+  std::string second = "alignments_test_merge2.db";
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+  std::vector<double> keys = {0, 0, 0, 0,  1, 0, 0, 0,  0, 1, 0, 0};
+  std::vector<double> near = {0.01, 0, 0, 0,  1, 0.01, 0, 0,  0.5, 0.5, 0, 0};
+  std::vector< std::vector<Alignment> > worse(3, std::vector<Alignment>(1, Alignment::fromParts(4, 1.0)));
+  std::vector< std::vector<Alignment> > better(3, std::vector<Alignment>(1, Alignment::fromParts(1, 2.0)));
+  ASSERT_TRUE(AlignmentDB::appendShard(first.c_str(), dim, keys, worse));
+  ASSERT_TRUE(AlignmentDB::appendShard(second.c_str(), dim, near, better));
+
+  Alignments a(objs, 4);
+  a.setStreaming(10, 0.1);
+  ASSERT_TRUE(a.isStreaming());
+  ASSERT_TRUE(a.readDatabase(first.c_str()));
+  ASSERT_TRUE(a.readDatabase(second.c_str()));
+
+  // Two of the new samples merge, the third is too far from every stored one
+  AlignmentStats s = a.getStats();
+  EXPECT_EQ(4, s.live);
+  EXPECT_EQ(10, s.budget);
+  EXPECT_EQ(4, s.seen);
+  EXPECT_EQ(2, s.merged);
+  EXPECT_EQ(0, s.evicted);
+  EXPECT_EQ(0, s.dropped);
+  std::vector<Alignment> r = a.getAlignmentsNN(key(keys, 0));
+  ASSERT_EQ(1, r.size());
+  EXPECT_EQ(1, r[0].alignScore());
+  EXPECT_EQ(2.0, r[0].alignMag());
+  EXPECT_EQ(4, a.getAlignmentsNN(key(keys, 2))[0].alignScore());
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+}
+
+TEST_F(AlignmentsTest, testReservoirEviction) {
+  std::string name = "alignments_test_reservoir.db";
+  std::remove(name.c_str());
+  easymath::seed_generator(8);
+  std::vector<double> keys = randomKeys(1000);
+  ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, keys, labels(1000, 0)));
+
+  Alignments a(objs, 4);
+  a.setStreaming(100, 0.0, RESERVOIR);
+  ASSERT_TRUE(a.readDatabase(name.c_str()));
+  AlignmentStats s = a.getStats();
+  EXPECT_EQ(100, s.live);
+  EXPECT_EQ(1000, s.seen);
+  EXPECT_EQ(0, s.merged);
+  EXPECT_EQ(900, s.evicted + s.dropped);
+  EXPECT_GT(s.evicted, 0);
+  EXPECT_GT(s.dropped, 0);
+
+  // Every sample seen is equally likely to be kept, so the survivors are
+  // spread over the whole stream rather than the most recent samples
+  size_t kept = 0;
+  double meanPos = 0.0;
+  AlignmentDB file;
+  ASSERT_TRUE(file.open(name.c_str()));
+  for (size_t i = 0; i < 1000; i++) {
+    std::vector<double> k(file.getKey(0, i), file.getKey(0, i)+dim);
+    if (a.getAlignmentsNN(k)[0].alignMag() == file.getAlignments(0, i)[0].alignMag()) {
+      kept++;
+      meanPos += i;
+    }
+  }
+  EXPECT_EQ(100, kept);
+  EXPECT_NEAR(500, meanPos/kept, 150);
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testLeastRecentlyQueriedEviction) {
+  std::string first = "alignments_test_lrq1.db";
+  std::string second = "alignments_test_lrq2.db";
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+  easymath::seed_generator(9);
+  std::vector<double> keys = randomKeys(50);
+  std::vector<double> later = randomKeys(25);
+  ASSERT_TRUE(AlignmentDB::appendShard(first.c_str(), dim, keys, labels(50, 0)));
+  ASSERT_TRUE(AlignmentDB::appendShard(second.c_str(), dim, later, labels(25, 100)));
+
+  Alignments a(objs, 4);
+  a.setStreaming(50, 0.0, LEAST_RECENTLY_QUERIED);
+  ASSERT_TRUE(a.readDatabase(first.c_str()));
+  for (size_t i = 0; i < 25; i++) {
+    a.getAlignmentsNN(key(keys, i));
+  }
+  ASSERT_TRUE(a.readDatabase(second.c_str()));
+
+  // The new samples replace the samples that were never queried
+  EXPECT_EQ(50, a.size());
+  EXPECT_EQ(25, a.getStats().evicted);
+  EXPECT_EQ(0, a.getStats().dropped);
+  for (size_t i = 0; i < 25; i++) {
+    EXPECT_EQ(i, a.getAlignmentsNN(key(keys, i))[0].alignMag());
+    EXPECT_EQ(100 + i, a.getAlignmentsNN(key(later, i))[0].alignMag());
+  }
+  for (size_t i = 25; i < 50; i++) {
+    EXPECT_NE(i, a.getAlignmentsNN(key(keys, i))[0].alignMag());
+  }
+  std::remove(first.c_str());
+  std::remove(second.c_str());
+}
+
+TEST_F(AlignmentsTest, testCompactionKeepsSamples) {
+  std::string name = "alignments_test_compact.db";
+  std::remove(name.c_str());
+  easymath::seed_generator(10);
+  std::vector<double> keys = randomKeys(200);
+  ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, keys, labels(200, 0)));
+
+  // Removed samples are compacted away every budget evictions, and the
+  // samples left keep their states and alignments
+  Alignments a(objs, 4);
+  a.setStreaming(10, 0.0, LEAST_RECENTLY_QUERIED);
+  ASSERT_TRUE(a.readDatabase(name.c_str()));
+  EXPECT_EQ(10, a.size());
+  EXPECT_EQ(190, a.getStats().evicted);
+
+  AlignmentDB file;
+  ASSERT_TRUE(file.open(name.c_str()));
+  size_t kept = 0;
+  for (size_t i = 0; i < 200; i++) {
+    std::vector<double> k(file.getKey(0, i), file.getKey(0, i)+dim);
+    if (a.getAlignmentsNN(k)[0].alignMag() == file.getAlignments(0, i)[0].alignMag()) kept++;
+  }
+  EXPECT_EQ(10, kept);
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testStreamingDatabaseRoundTrip) {
+  std::string source = "alignments_test_stream_source.db";
+  std::string name = "alignments_test_stream.db";
+  std::remove(source.c_str());
+  std::remove(name.c_str());
+  easymath::seed_generator(11);
+  std::vector<double> keys = randomKeys(300);
+  std::vector<double> first(keys.begin(), keys.begin()+150*dim);
+  std::vector<double> rest(keys.begin()+150*dim, keys.end());
+  ASSERT_TRUE(AlignmentDB::appendShard(source.c_str(), dim, first, labels(150, 0)));
+
+  // Each write replaces the file with the current samples, even after
+  // merges and evictions have changed samples that were already written
+  Alignments a(objs, 4);
+  a.setStreaming(100, 0.05, RESERVOIR);
+  ASSERT_TRUE(a.readDatabase(source.c_str()));
+  ASSERT_TRUE(a.writeDatabase(name.c_str()));
+  std::remove(source.c_str());
+  ASSERT_TRUE(AlignmentDB::appendShard(source.c_str(), dim, rest, labels(150, 150)));
+  ASSERT_TRUE(a.readDatabase(source.c_str()));
+  ASSERT_TRUE(a.writeDatabase(name.c_str()));
+
+  AlignmentDB file;
+  ASSERT_TRUE(file.open(name.c_str()));
+  EXPECT_EQ(1, file.numShards());
+  EXPECT_EQ(a.size(), file.size());
+
+  // Loading the file into another streaming table merges nothing twice
+  Alignments b(objs, 4);
+  b.setStreaming(100, 0.05, RESERVOIR);
+  ASSERT_TRUE(b.readDatabase(name.c_str()));
+  EXPECT_EQ(a.size(), b.size());
+  EXPECT_EQ(0, b.getStats().merged);
+  EXPECT_EQ(0, b.getStats().evicted);
+  for (size_t i = 0; i < file.size(); i++) {
+    std::vector<double> k(file.getKey(0, i), file.getKey(0, i)+dim);
+    std::vector<Alignment> expected = a.getAlignmentsNN(k);
+    std::vector<Alignment> r = b.getAlignmentsNN(k);
+    ASSERT_EQ(1, r.size());
+    EXPECT_EQ(expected[0].alignScore(), r[0].alignScore());
+    EXPECT_EQ(expected[0].alignMag(), r[0].alignMag());
+  }
+  std::remove(source.c_str());
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testAppendAfterCutShortShard) {
+  std::string name = "alignments_test_cut.db";
+  std::remove(name.c_str());
+  easymath::seed_generator(12);
+  std::vector<double> keys = randomKeys(30);
+  std::vector<double> first(keys.begin(), keys.begin()+10*dim);
+  std::vector<double> cut(keys.begin()+10*dim, keys.begin()+20*dim);
+  std::vector<double> last(keys.begin()+20*dim, keys.end());
+  ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, first, labels(10, 0)));
+  ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, cut, labels(10, 10)));
+  std::string bytes = readFile(name);
+  ASSERT_EQ(0, truncate(name.c_str(), bytes.size() - 8));
+
+  // The cut short shard is dropped, so the next shard can be reached
+  ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, last, labels(10, 20)));
+  AlignmentDB file;
+  ASSERT_TRUE(file.open(name.c_str()));
+  ASSERT_EQ(2, file.numShards());
+  EXPECT_EQ(20, file.size());
+  for (size_t i = 0; i < 10; i++) {
+    std::vector<Alignment> r = file.getAlignmentsNN(key(last, i));
+    ASSERT_EQ(1, r.size());
+    EXPECT_EQ(20 + i, r[0].alignMag());
+    EXPECT_EQ(i, file.getAlignmentsNN(key(first, i))[0].alignMag());
+  }
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testCorruptShardIsIgnored) {
+  std::string name = "alignments_test_corrupt.db";
+  easymath::seed_generator(13);
+  std::vector<double> keys = randomKeys(10);
+  size_t shardStart = sizeof(AlignmentDBHeader);
+  size_t axesStart = shardStart + sizeof(AlignmentDBShard) + 10*dim*sizeof(double);
+
+  // A key count whose section sizes overflow, and a split axis past the key
+  for (int corruption = 0; corruption < 2; corruption++) {
+    std::remove(name.c_str());
+    ASSERT_TRUE(AlignmentDB::appendShard(name.c_str(), dim, keys, labels(10, 0)));
+    std::fstream f(name.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (corruption == 0) {
+      unsigned long long n = (1ULL << 61) + 10;
+      f.seekp(shardStart + offsetof(AlignmentDBShard, numKeys));
+      f.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    } else {
+      unsigned int axis = dim;
+      f.seekp(axesStart);
+      f.write(reinterpret_cast<const char*>(&axis), sizeof(axis));
+    }
+    f.close();
+
+    AlignmentDB file;
+    ASSERT_TRUE(file.open(name.c_str()));
+    EXPECT_EQ(0, file.numShards());
+    EXPECT_TRUE(file.getAlignmentsNN(key(keys, 0)).empty());
+  }
+  std::remove(name.c_str());
+}
+
+TEST_F(AlignmentsTest, testParallelStreamingDoesNotDependOnThreads) {
+  std::string one = "alignments_test_stream_one.db";
+  std::string four = "alignments_test_stream_four.db";
+
+  // Reservoir draws must not come from the generators the workers reseed
+  Alignments a(objs, 3);
+  a.setStreaming(40, 0.5, RESERVOIR);
+  a.addAlignments(30, 1, 21);
+  Alignments b(objs, 3);
+  b.setStreaming(40, 0.5, RESERVOIR);
+  b.addAlignments(30, 4, 21);
+
+  AlignmentStats sa = a.getStats();
+  AlignmentStats sb = b.getStats();
+  ASSERT_GT(sa.evicted + sa.dropped, 0);
+  EXPECT_EQ(sa.live, sb.live);
+  EXPECT_EQ(sa.seen, sb.seen);
+  EXPECT_EQ(sa.merged, sb.merged);
+  EXPECT_EQ(sa.evicted, sb.evicted);
+  EXPECT_EQ(sa.dropped, sb.dropped);
+  ASSERT_TRUE(a.writeDatabase(one.c_str()));
+  ASSERT_TRUE(b.writeDatabase(four.c_str()));
+  EXPECT_TRUE(readFile(one) == readFile(four));
+  std::remove(one.c_str());
+  std::remove(four.c_str());
+}
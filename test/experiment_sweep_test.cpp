@@ -0,0 +1,166 @@
+/*******************************************************************************
+experiment_sweep_test.cpp
+
+Unit tests for expanding and resuming parameter sweeps.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "gtest/gtest.h"
+#include "TempFileTest.h"
+#include "experimentSweep.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class ExperimentSweepTest : public TempFileTest {
+protected:
+  YAML::Node config(const std::string& sweep) {
+    return YAML::Load("base:\n  nRovs: 3\n  nPOIs: 1\n  coupling: 1\n"
+		      "  ccea_pop: 15\n  nSteps: 10\n"
+		      "sweep:\n  base: base\n" + sweep);
+  }
+
+  std::vector<std::string> names(const std::vector<SweepJob>& jobs) {
+    std::vector<std::string> n;
+    for (auto& job : jobs) n.push_back(job.name);
+    return n;
+  }
+
+  std::vector<std::string> lines(const std::string& fileName) {
+    std::ifstream in(fileName.c_str());
+    std::vector<std::string> l;
+    std::string line;
+    while (std::getline(in, line)) l.push_back(line);
+    return l;
+  }
+};
+
+TEST_F(ExperimentSweepTest, testGridExpansion) {
+  std::vector<SweepJob> jobs = expandSweep(config("  nRovs: [2, 3]\n  coupling: [1, 2]\n"), 1);
+  std::vector<std::string> expected = {"base_nRovs2_coupling1", "base_nRovs2_coupling2",
+				       "base_nRovs3_coupling1", "base_nRovs3_coupling2"};
+  EXPECT_EQ(expected, names(jobs));
+
+  // Every parameter is listed, swept or not, and the job node holds them
+  std::vector<std::string> values = {"3", "1", "2", "15", "10"};
+  EXPECT_EQ(values, jobs[3].values);
+  EXPECT_EQ(3, jobs[3].node[nRovsS].as<int>());
+  EXPECT_EQ(2, jobs[3].node[couplingS].as<int>());
+  EXPECT_EQ(15, jobs[3].node[cceaPopS].as<int>());
+  EXPECT_EQ(2, jobs[0].node[nRovsS].as<int>());
+
+  // Grid mode ignores the seed
+  EXPECT_EQ(names(jobs), names(expandSweep(config("  nRovs: [2, 3]\n  coupling: [1, 2]\n"), 9)));
+}
+
+TEST_F(ExperimentSweepTest, testRandomExpansion) {
+  std::string sweep = "  mode: random\n  samples: 3\n  nRovs: [2, 3, 4]\n  nPOIs: [1, 5]\n";
+  std::vector<std::string> grid = names(expandSweep(config("  nRovs: [2, 3, 4]\n  nPOIs: [1, 5]\n"), 0));
+  ASSERT_EQ(6, grid.size());
+
+  // Distinct combinations in grid order, the same for the same seed
+  bool varies = false;
+  std::vector<std::string> first = names(expandSweep(config(sweep), 1));
+  for (unsigned seed = 1; seed < 10; seed++) {
+    std::vector<std::string> drawn = names(expandSweep(config(sweep), seed));
+    ASSERT_EQ(3, drawn.size());
+    EXPECT_EQ(drawn, names(expandSweep(config(sweep), seed)));
+    size_t last = 0;
+    for (size_t i = 0; i < drawn.size(); i++) {
+      size_t at = std::find(grid.begin(), grid.end(), drawn[i]) - grid.begin();
+      ASSERT_LT(at, grid.size());
+      if (i > 0) {
+	EXPECT_GT(at, last);
+      }
+      last = at;
+    }
+    varies = varies || drawn != first;
+  }
+  EXPECT_TRUE(varies);
+
+  // More samples than combinations gives the whole grid
+  EXPECT_EQ(grid, names(expandSweep(config("  mode: random\n  samples: 50\n  nRovs: [2, 3, 4]\n  nPOIs: [1, 5]\n"), 3)));
+}
+
+TEST_F(ExperimentSweepTest, testMalformedSweepRejected) {
+  EXPECT_TRUE(expandSweep(config("  world: [1, 2]\n"), 1).empty());
+  EXPECT_TRUE(expandSweep(config("  mode: spiral\n  nRovs: [2]\n"), 1).empty());
+  EXPECT_TRUE(expandSweep(config("  nRovs: []\n"), 1).empty());
+  EXPECT_TRUE(expandSweep(YAML::Load("sweep:\n  base: missing\n  nRovs: [2]\n"), 1).empty());
+}
+
+TEST_F(ExperimentSweepTest, testResumeFromLog) {
+  std::string top = tempDir();
+  std::vector<SweepJob> jobs = expandSweep(config("  nRovs: [2, 3, 4]\n"), 1);
+  ASSERT_EQ(3, jobs.size());
+  removeLater(top + "/sweep_jobs.csv");
+  removeLater(top + "/sweep_summary.csv");
+  for (auto& job : jobs) {
+    removeLater(top + "/" + job.name);
+    removeLater(top + "/" + job.name + "/" + job.name + "_fitness");
+  }
+
+  // The first job finished and the second failed in an earlier run
+  {
+    std::ofstream log((top + "/sweep_jobs.csv").c_str());
+    log << "job,status,seconds,peakRSS_kB\n"
+	<< jobs[0].name << ",0,1.5,100\n"
+	<< jobs[1].name << ",3,0.5,90\n";
+  }
+
+  // Each job writes a fitness curve ending in its seed, or fails
+  SweepRunner run = [&top](const SweepJob& job, unsigned seed) {
+    std::string jobDir = top + "/" + job.name;
+    mkdir(jobDir.c_str(), 0755);
+    std::ofstream out((jobDir + "/" + job.name + "_fitness").c_str());
+    out << "1\n" << seed << "\n";
+    return job.values[0] == "4" ? 2 : 0;
+  };
+  EXPECT_EQ(1, runSweep(jobs, top, 100, 2, run));
+
+  std::ifstream skipped((top + "/" + jobs[0].name + "/" + jobs[0].name + "_fitness").c_str());
+  EXPECT_FALSE(skipped.good());
+  std::vector<std::string> log = lines(top + "/sweep_jobs.csv");
+  ASSERT_EQ(5, log.size());
+  // The reruns finish in either order
+  std::vector<std::string> reruns = {log[3].substr(0, log[3].find(',', log[3].find(',') + 1)),
+				     log[4].substr(0, log[4].find(',', log[4].find(',') + 1))};
+  std::sort(reruns.begin(), reruns.end());
+  std::vector<std::string> expected = {jobs[1].name + ",0", jobs[2].name + ",2"};
+  EXPECT_EQ(expected, reruns);
+
+  // One row per job: parameters, accounting, final and best fitness, curve
+  std::vector<std::string> summary = lines(top + "/sweep_summary.csv");
+  ASSERT_EQ(4, summary.size());
+  EXPECT_EQ("job,nRovs,nPOIs,coupling,ccea_pop,nSteps,status,seconds,peakRSS_kB,final,best,epoch_0,epoch_1",
+	    summary[0]);
+  EXPECT_EQ(jobs[0].name + ",2,1,1,15,10,0,1.5,100,,,,", summary[1]);
+  EXPECT_EQ(0, summary[2].find(jobs[1].name + ",3,1,1,15,10,0,"));
+  EXPECT_NE(std::string::npos, summary[2].find(",101,101,1,101"));
+  EXPECT_EQ(0, summary[3].find(jobs[2].name + ",4,1,1,15,10,2,"));
+  EXPECT_NE(std::string::npos, summary[3].find(",102,102,1,102"));
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+trajectoryToCSV.cpp
+
+Converts a binary trajectory file written by TrajectoryRecorder, or
+trajectories from a compressed trajectory archive, to CSV.
+
+Authors: Eric Klinkhammer
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of 
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, 
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+SOFTWARE.
+*******************************************************************************/
+
+#include "Utilities/TrajectoryRecorder.h"
+#include "Utilities/TrajectoryArchive.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+bool isArchive(const char* fileName) {
+  char magic[8] = {0};
+  std::ifstream in(fileName, std::ios::binary);
+  in.read(magic, sizeof(magic));
+  return in && std::memcmp(magic, "AADILTRA", 8) == 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 5) {
+    std::cout << "Usage: " << argv[0] << " <trajectory file or archive> <output.csv> [epoch team]" << std::endl;
+    return 1;
+  }
+  if (!isArchive(argv[1])) {
+    return TrajectoryRecorder::WriteCSV(argv[1], argv[2]) ? 0 : 1;
+  }
+
+  // Archives are read one trajectory at a time, or only the one requested
+  TrajectoryArchiveReader reader;
+  if (!reader.Open(argv[1])) {
+    return 1;
+  }
+  std::vector< std::pair<unsigned int, unsigned int> > keys;
+  if (argc == 5) {
+    keys.push_back(std::make_pair(atoi(argv[3]), atoi(argv[4])));
+  } else {
+    keys = reader.GetKeys();
+  }
+
+  std::vector<TrajectoryRecord> all, records;
+  for (const auto& k : keys) {
+    if (!reader.ReadTrajectory(k.first, k.second, records)) {
+      std::cout << "Error: no trajectory for epoch " << k.first << " team " << k.second << "!" << std::endl;
+      return 1;
+    }
+    all.insert(all.end(), records.begin(), records.end());
+  }
+  return TrajectoryRecorder::WriteCSV(all, argv[2]) ? 0 : 1;
+}